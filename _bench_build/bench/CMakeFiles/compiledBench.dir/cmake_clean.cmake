@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/compiledBench.dir/compiledBench.cpp.o"
+  "CMakeFiles/compiledBench.dir/compiledBench.cpp.o.d"
+  "compiledBench"
+  "compiledBench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/compiledBench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
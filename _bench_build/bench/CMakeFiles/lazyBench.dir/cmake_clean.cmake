@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/lazyBench.dir/lazyBench.cpp.o"
+  "CMakeFiles/lazyBench.dir/lazyBench.cpp.o.d"
+  "lazyBench"
+  "lazyBench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/lazyBench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
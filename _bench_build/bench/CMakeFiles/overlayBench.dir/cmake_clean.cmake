@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/overlayBench.dir/overlayBench.cpp.o"
+  "CMakeFiles/overlayBench.dir/overlayBench.cpp.o.d"
+  "overlayBench"
+  "overlayBench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/overlayBench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
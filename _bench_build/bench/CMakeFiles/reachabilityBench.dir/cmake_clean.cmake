@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/reachabilityBench.dir/reachabilityBench.cpp.o"
+  "CMakeFiles/reachabilityBench.dir/reachabilityBench.cpp.o.d"
+  "reachabilityBench"
+  "reachabilityBench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/reachabilityBench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
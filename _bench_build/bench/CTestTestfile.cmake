@@ -0,0 +1,16 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/bench
+# Build directory: /root/repo/_bench_build/bench
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test(reachabilityCheck "/root/repo/_bench_build/bench/reachabilityBench" "check")
+set_tests_properties(reachabilityCheck PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/bench/CMakeLists.txt;19;add_test;/root/repo/bench/CMakeLists.txt;0;")
+add_test(compiledCheck "/root/repo/_bench_build/bench/compiledBench" "check")
+set_tests_properties(compiledCheck PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/bench/CMakeLists.txt;22;add_test;/root/repo/bench/CMakeLists.txt;0;")
+add_test(overlayCheck "/root/repo/_bench_build/bench/overlayBench" "check")
+set_tests_properties(overlayCheck PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/bench/CMakeLists.txt;25;add_test;/root/repo/bench/CMakeLists.txt;0;")
+add_test(presetsCheck "/root/repo/_bench_build/bench/overlayBench" "presets")
+set_tests_properties(presetsCheck PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/bench/CMakeLists.txt;28;add_test;/root/repo/bench/CMakeLists.txt;0;")
+add_test(lazyCheck "/root/repo/_bench_build/bench/lazyBench" "check")
+set_tests_properties(lazyCheck PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/bench/CMakeLists.txt;31;add_test;/root/repo/bench/CMakeLists.txt;0;")
@@ -0,0 +1,9 @@
+file(REMOVE_RECURSE
+  "libinstGraph.pdb"
+  "libinstGraph.so"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/instGraph-shared.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
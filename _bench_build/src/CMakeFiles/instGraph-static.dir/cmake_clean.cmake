@@ -0,0 +1,9 @@
+file(REMOVE_RECURSE
+  "libinstGraph.a"
+  "libinstGraph.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/instGraph-static.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
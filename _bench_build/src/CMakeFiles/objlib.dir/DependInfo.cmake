@@ -0,0 +1,42 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/instBeam.cpp" "src/CMakeFiles/objlib.dir/instBeam.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instBeam.cpp.o.d"
+  "/root/repo/src/instBlame.cpp" "src/CMakeFiles/objlib.dir/instBlame.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instBlame.cpp.o.d"
+  "/root/repo/src/instChanges.cpp" "src/CMakeFiles/objlib.dir/instChanges.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instChanges.cpp.o.d"
+  "/root/repo/src/instCompiled.cpp" "src/CMakeFiles/objlib.dir/instCompiled.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instCompiled.cpp.o.d"
+  "/root/repo/src/instDiagnostics.cpp" "src/CMakeFiles/objlib.dir/instDiagnostics.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instDiagnostics.cpp.o.d"
+  "/root/repo/src/instDominators.cpp" "src/CMakeFiles/objlib.dir/instDominators.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instDominators.cpp.o.d"
+  "/root/repo/src/instDwell.cpp" "src/CMakeFiles/objlib.dir/instDwell.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instDwell.cpp.o.d"
+  "/root/repo/src/instGraph.cpp" "src/CMakeFiles/objlib.dir/instGraph.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instGraph.cpp.o.d"
+  "/root/repo/src/instGraphBuilder.cpp" "src/CMakeFiles/objlib.dir/instGraphBuilder.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instGraphBuilder.cpp.o.d"
+  "/root/repo/src/instGraphTOML.cpp" "src/CMakeFiles/objlib.dir/instGraphTOML.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instGraphTOML.cpp.o.d"
+  "/root/repo/src/instGraphXML.cpp" "src/CMakeFiles/objlib.dir/instGraphXML.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instGraphXML.cpp.o.d"
+  "/root/repo/src/instGraphXMLSink.cpp" "src/CMakeFiles/objlib.dir/instGraphXMLSink.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instGraphXMLSink.cpp.o.d"
+  "/root/repo/src/instHistory.cpp" "src/CMakeFiles/objlib.dir/instHistory.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instHistory.cpp.o.d"
+  "/root/repo/src/instIOPut.cpp" "src/CMakeFiles/objlib.dir/instIOPut.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instIOPut.cpp.o.d"
+  "/root/repo/src/instJournal.cpp" "src/CMakeFiles/objlib.dir/instJournal.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instJournal.cpp.o.d"
+  "/root/repo/src/instLazy.cpp" "src/CMakeFiles/objlib.dir/instLazy.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instLazy.cpp.o.d"
+  "/root/repo/src/instMetrics.cpp" "src/CMakeFiles/objlib.dir/instMetrics.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instMetrics.cpp.o.d"
+  "/root/repo/src/instNode.cpp" "src/CMakeFiles/objlib.dir/instNode.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instNode.cpp.o.d"
+  "/root/repo/src/instOverlay.cpp" "src/CMakeFiles/objlib.dir/instOverlay.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instOverlay.cpp.o.d"
+  "/root/repo/src/instPathIndex.cpp" "src/CMakeFiles/objlib.dir/instPathIndex.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instPathIndex.cpp.o.d"
+  "/root/repo/src/instPlanner.cpp" "src/CMakeFiles/objlib.dir/instPlanner.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instPlanner.cpp.o.d"
+  "/root/repo/src/instPresets.cpp" "src/CMakeFiles/objlib.dir/instPresets.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instPresets.cpp.o.d"
+  "/root/repo/src/instReachability.cpp" "src/CMakeFiles/objlib.dir/instReachability.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instReachability.cpp.o.d"
+  "/root/repo/src/instTrace.cpp" "src/CMakeFiles/objlib.dir/instTrace.cpp.o" "gcc" "src/CMakeFiles/objlib.dir/instTrace.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
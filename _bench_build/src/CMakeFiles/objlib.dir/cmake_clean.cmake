@@ -0,0 +1,55 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/objlib.dir/instBeam.cpp.o"
+  "CMakeFiles/objlib.dir/instBeam.cpp.o.d"
+  "CMakeFiles/objlib.dir/instBlame.cpp.o"
+  "CMakeFiles/objlib.dir/instBlame.cpp.o.d"
+  "CMakeFiles/objlib.dir/instChanges.cpp.o"
+  "CMakeFiles/objlib.dir/instChanges.cpp.o.d"
+  "CMakeFiles/objlib.dir/instCompiled.cpp.o"
+  "CMakeFiles/objlib.dir/instCompiled.cpp.o.d"
+  "CMakeFiles/objlib.dir/instDiagnostics.cpp.o"
+  "CMakeFiles/objlib.dir/instDiagnostics.cpp.o.d"
+  "CMakeFiles/objlib.dir/instDominators.cpp.o"
+  "CMakeFiles/objlib.dir/instDominators.cpp.o.d"
+  "CMakeFiles/objlib.dir/instDwell.cpp.o"
+  "CMakeFiles/objlib.dir/instDwell.cpp.o.d"
+  "CMakeFiles/objlib.dir/instGraph.cpp.o"
+  "CMakeFiles/objlib.dir/instGraph.cpp.o.d"
+  "CMakeFiles/objlib.dir/instGraphBuilder.cpp.o"
+  "CMakeFiles/objlib.dir/instGraphBuilder.cpp.o.d"
+  "CMakeFiles/objlib.dir/instGraphTOML.cpp.o"
+  "CMakeFiles/objlib.dir/instGraphTOML.cpp.o.d"
+  "CMakeFiles/objlib.dir/instGraphXML.cpp.o"
+  "CMakeFiles/objlib.dir/instGraphXML.cpp.o.d"
+  "CMakeFiles/objlib.dir/instGraphXMLSink.cpp.o"
+  "CMakeFiles/objlib.dir/instGraphXMLSink.cpp.o.d"
+  "CMakeFiles/objlib.dir/instHistory.cpp.o"
+  "CMakeFiles/objlib.dir/instHistory.cpp.o.d"
+  "CMakeFiles/objlib.dir/instIOPut.cpp.o"
+  "CMakeFiles/objlib.dir/instIOPut.cpp.o.d"
+  "CMakeFiles/objlib.dir/instJournal.cpp.o"
+  "CMakeFiles/objlib.dir/instJournal.cpp.o.d"
+  "CMakeFiles/objlib.dir/instLazy.cpp.o"
+  "CMakeFiles/objlib.dir/instLazy.cpp.o.d"
+  "CMakeFiles/objlib.dir/instMetrics.cpp.o"
+  "CMakeFiles/objlib.dir/instMetrics.cpp.o.d"
+  "CMakeFiles/objlib.dir/instNode.cpp.o"
+  "CMakeFiles/objlib.dir/instNode.cpp.o.d"
+  "CMakeFiles/objlib.dir/instOverlay.cpp.o"
+  "CMakeFiles/objlib.dir/instOverlay.cpp.o.d"
+  "CMakeFiles/objlib.dir/instPathIndex.cpp.o"
+  "CMakeFiles/objlib.dir/instPathIndex.cpp.o.d"
+  "CMakeFiles/objlib.dir/instPlanner.cpp.o"
+  "CMakeFiles/objlib.dir/instPlanner.cpp.o.d"
+  "CMakeFiles/objlib.dir/instPresets.cpp.o"
+  "CMakeFiles/objlib.dir/instPresets.cpp.o.d"
+  "CMakeFiles/objlib.dir/instReachability.cpp.o"
+  "CMakeFiles/objlib.dir/instReachability.cpp.o.d"
+  "CMakeFiles/objlib.dir/instTrace.cpp.o"
+  "CMakeFiles/objlib.dir/instTrace.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/objlib.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
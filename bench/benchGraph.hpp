@@ -0,0 +1,148 @@
+/** \file
+ *
+ * \brief Random graphs and timing for the benchmarks
+ */
+
+#ifndef benchGraph_hpp
+#define benchGraph_hpp
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "instGraph.hpp"
+#include "instGraphBuilder.hpp"
+
+namespace ingr
+{
+namespace bench
+{
+
+/// Build a random graph of light paths
+/** Nodes are named `n<k>`.  Each node has two inputs and two outputs, with each input linked to the output
+ * of the same index and sometimes also to the first output.  Its inputs are fed by beams from random free
+ * outputs of earlier nodes.  A fraction \p relayFrac of the nodes are relays, with one input linked to one
+ * output and fed from one of the two most recent free outputs, which makes pass-through chains.  The first
+ * two nodes are sources: their inputs are not connected and their outputs are not linked.
+ *
+ * \returns 0 on success
+ * \returns -1 on error, with \p emsg set
+ */
+inline int randomGraph( std::string &emsg,   /**< [out] the error message, if any */
+                        instGraph &graph,    /**< [in/out] the graph to build in */
+                        size_t nNodes,       /**< [in] the number of nodes */
+                        unsigned seed,       /**< [in] the seed of the random generator */
+                        double relayFrac = 0 /**< [in] [optional] the fraction of nodes which are relays */
+)
+{
+    std::mt19937 rng( seed );
+
+    instGraphBuilder bld;
+    std::vector<std::string> freeOut;
+
+    for( size_t k = 0; k < nNodes; ++k )
+    {
+        std::string nn = "n" + std::to_string( k );
+        bld.addNode( nn );
+
+        bool relay = k >= 2 && ( rng() % 1000 ) < relayFrac * 1000;
+        int nPuts = relay ? 1 : 2;
+
+        for( int j = 0; j < nPuts; ++j )
+        {
+            std::string beam;
+
+            if( k >= 2 && !freeOut.empty() && ( relay || rng() % 4 != 0 ) )
+            {
+                size_t i = relay ? freeOut.size() - 1 - ( rng() % std::min<size_t>( 2, freeOut.size() ) )
+                                 : rng() % freeOut.size();
+                beam = freeOut[i];
+                freeOut.erase( freeOut.begin() + i );
+            }
+
+            bld.addPut( nn, ioDir::input, "in" + std::to_string( j ), putType::light, beam );
+        }
+
+        for( int j = 0; j < nPuts; ++j )
+        {
+            std::string beam = "b" + std::to_string( k ) + "_" + std::to_string( j );
+            bld.addPut( nn, ioDir::output, "o" + std::to_string( j ), putType::light, beam );
+            freeOut.push_back( beam );
+        }
+
+        if( k >= 2 )
+        {
+            bld.addOutputLink( nn, "in0", "o0" );
+
+            if( !relay )
+            {
+                bld.addOutputLink( nn, "in1", "o1" );
+
+                if( rng() % 3 == 0 )
+                {
+                    bld.addOutputLink( nn, "in1", "o0" );
+                }
+            }
+        }
+    }
+
+    if( bld.build( emsg, graph ) < 0 )
+    {
+        return -1;
+    }
+
+    graph.assignHandles();
+
+    return 0;
+}
+
+/// Turn on every input and the outputs of the source nodes, so light can reach the whole graph
+inline void lightGraph( instGraph &graph /**< [in/out] a graph made by randomGraph */ )
+{
+    for( auto &&nd : graph.nodes() )
+    {
+        for( auto &&ip : nd.second->inputs() )
+        {
+            ip.second->state( putState::on );
+        }
+    }
+
+    for( auto &&src : { "n0", "n1" } )
+    {
+        for( auto &&op : graph.node( src )->outputs() )
+        {
+            op.second->state( putState::on );
+        }
+    }
+}
+
+/// Get the puts and beams of a graph by handle
+inline void handles( std::vector<uint32_t> &puts,  /**< [out] the handles of the puts */
+                     std::vector<uint32_t> &beams, /**< [out] the handles of the beams */
+                     instGraph &graph              /**< [in] the graph, with handles assigned */
+)
+{
+    puts.clear();
+    beams.clear();
+
+    for( uint32_t h = 0; h < graph.nHandles(); ++h )
+    {
+        ( graph.handlePut( h ) ? puts : beams ).push_back( h );
+    }
+}
+
+/// Get the time elapsed since a start time
+/**
+ * \returns the elapsed time in ms
+ */
+inline double msSince( std::chrono::steady_clock::time_point t0 /**< [in] the start time */ )
+{
+    return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - t0 ).count();
+}
+
+} // namespace bench
+} // namespace ingr
+
+#endif // benchGraph_hpp
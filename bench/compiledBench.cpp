@@ -0,0 +1,200 @@
+/** \file
+ *
+ * \brief Benchmark and differential check of the compiled evaluation against the live graph
+ *
+ * With no arguments, toggles the source of a long line of relays in the live graph and in an instCompiled,
+ * and prints the time per change for each.  With the argument `check`, makes random state and enabled
+ * changes on small graphs with many relays in both, and compares every put and beam after each change,
+ * returning non-zero if any differs.
+ */
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+#include "instCompiled.hpp"
+
+#include "benchGraph.hpp"
+
+using namespace ingr;
+using namespace ingr::bench;
+
+// Get the state of a put or beam in the live graph
+static int liveState( instGraph &graph, uint32_t h )
+{
+    if( instIOPut *put = graph.handlePut( h ) )
+    {
+        return static_cast<int>( put->state() );
+    }
+
+    return static_cast<int>( graph.handleBeam( h )->state() );
+}
+
+// Get the state of a put or beam from the compiled evaluation
+static int compiledState( instGraph &graph, instCompiled &comp, uint32_t h )
+{
+    if( instIOPut *put = graph.handlePut( h ) )
+    {
+        return static_cast<int>( comp.state( put ) );
+    }
+
+    return static_cast<int>( comp.state( graph.handleBeam( h ) ) );
+}
+
+// Random state and enabled changes on small graphs, comparing every entity with the live graph after each
+static int check()
+{
+    size_t bad = 0;
+
+    for( unsigned trial = 0; trial < 6; ++trial )
+    {
+        instGraph graph;
+        std::string emsg;
+
+        if( randomGraph( emsg, graph, trial < 4 ? 80 : 400, trial, trial % 2 ? 0.95 : 0.8 ) < 0 )
+        {
+            std::cerr << emsg << "\n";
+            return -1;
+        }
+
+        instCompiled comp( graph );
+
+        std::vector<uint32_t> puts, beams;
+        handles( puts, beams, graph );
+
+        std::mt19937 rng( 100 + trial );
+
+        for( int n = 0; n < 4000 && bad == 0; ++n )
+        {
+            instIOPut *put = graph.handlePut( puts[rng() % puts.size()] );
+
+            int r = rng() % ( trial % 2 ? 20 : 10 );
+
+            if( r == 0 )
+            {
+                bool en = rng() % 4 != 0;
+                put->enabled( en );
+                comp.enabled( put, en );
+            }
+            else
+            {
+                putState ns = r < 6 ? putState::on : static_cast<putState>( rng() % 2 );
+                put->state( ns );
+                comp.state( put, ns );
+            }
+
+            for( uint32_t h = 0; h < graph.nHandles(); ++h )
+            {
+                if( liveState( graph, h ) != compiledState( graph, comp, h ) )
+                {
+                    std::cerr << "trial " << trial << " change " << n << ": " << graph.handleName( h ) << " differs\n";
+                    ++bad;
+                }
+            }
+        }
+
+        std::cout << "trial " << trial << ": " << comp.nChains() << " chains, " << comp.nCompressed()
+                  << " compressed, " << comp.jumps() << " jumps\n";
+    }
+
+    std::cout << "compiled check: " << bad << " differences\n";
+
+    return bad == 0 ? 0 : -1;
+}
+
+// Time toggling the source of a line of relays in the live graph and in the compiled evaluation
+static int line()
+{
+    // Live propagation recurses once per relay, so the line is kept within the default stack
+    constexpr size_t nRelays = 2000;
+    constexpr int nChanges = 200;
+
+    instGraphBuilder bld;
+
+    for( size_t k = 0; k < nRelays; ++k )
+    {
+        std::string nn = "r" + std::to_string( k );
+        bld.addNode( nn );
+
+        if( k > 0 )
+        {
+            bld.addPut( nn, ioDir::input, "in", putType::light, "b" + std::to_string( k - 1 ) );
+            bld.addOutputLink( nn, "in", "out" );
+        }
+
+        bld.addPut( nn, ioDir::output, "out", putType::light, "b" + std::to_string( k ) );
+    }
+
+    bld.addNode( "end" );
+    bld.addPut( "end", ioDir::input, "in", putType::light, "b" + std::to_string( nRelays - 1 ) );
+
+    instGraph graph;
+    std::string emsg;
+
+    if( bld.build( emsg, graph ) < 0 )
+    {
+        std::cerr << emsg << "\n";
+        return -1;
+    }
+
+    graph.assignHandles();
+
+    for( auto &&nd : graph.nodes() )
+    {
+        for( auto &&ip : nd.second->inputs() )
+        {
+            ip.second->state( putState::on );
+        }
+    }
+
+    instIOPut *src = graph.node( "r0" )->output( "out" );
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    for( int n = 0; n < nChanges; ++n )
+    {
+        src->state( n % 2 ? putState::on : putState::off );
+    }
+
+    double liveMs = msSince( t0 );
+
+    instCompiled comp( graph );
+
+    t0 = std::chrono::steady_clock::now();
+
+    for( int n = 0; n < nChanges; ++n )
+    {
+        comp.state( src, n % 2 ? putState::on : putState::off );
+    }
+
+    double compiledMs = msSince( t0 );
+
+    size_t bad = 0;
+    for( uint32_t h = 0; h < graph.nHandles(); ++h )
+    {
+        if( liveState( graph, h ) != compiledState( graph, comp, h ) )
+        {
+            ++bad;
+        }
+    }
+
+    std::cout << std::setw( 8 ) << nRelays << std::setw( 12 ) << comp.nCompressed() << std::setw( 14 )
+              << liveMs / nChanges << std::setw( 14 ) << compiledMs / nChanges
+              << ( bad == 0 ? "" : "  states differ" ) << "\n";
+
+    return bad == 0 ? 0 : -1;
+}
+
+int main( int argc, char **argv )
+{
+    if( argc > 1 && strcmp( argv[1], "check" ) == 0 )
+    {
+        return check();
+    }
+
+    std::cout << std::setw( 8 ) << "relays" << std::setw( 12 ) << "compressed" << std::setw( 14 ) << "live ms"
+              << std::setw( 14 ) << "compiled ms" << "\n";
+
+    return line();
+}
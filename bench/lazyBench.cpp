@@ -0,0 +1,245 @@
+/** \file
+ *
+ * \brief Benchmark and differential check of lazy evaluation against eager propagation
+ *
+ * With no arguments, drives an instLazy and the live graph with the same stream of writes and reads, for a
+ * write-heavy and a read-heavy workload, and prints the time each takes.  With the argument `check`, runs
+ * random writes and reads on small graphs and compares every state read from the instLazy with the live
+ * graph, returning non-zero if any differs.
+ */
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+#include "instLazy.hpp"
+
+#include "benchGraph.hpp"
+
+using namespace ingr;
+using namespace ingr::bench;
+
+// One operation of a stream: a write of a put's state or a read of a beam's state
+struct operation
+{
+    bool read;
+    uint32_t handle;
+    putState state;
+};
+
+// Get the state of a put or beam in the live graph
+static int liveState( instGraph &graph, uint32_t h )
+{
+    if( instIOPut *put = graph.handlePut( h ) )
+    {
+        return static_cast<int>( put->state() );
+    }
+
+    return static_cast<int>( graph.handleBeam( h )->state() );
+}
+
+// Get the state of a put or beam from the lazy evaluation
+static int lazyState( instGraph &graph, instLazy &lazy, uint32_t h )
+{
+    if( instIOPut *put = graph.handlePut( h ) )
+    {
+        return static_cast<int>( lazy.state( put ) );
+    }
+
+    return static_cast<int>( lazy.state( graph.handleBeam( h ) ) );
+}
+
+// Random writes, enabled changes and reads on small graphs, comparing each read with the live graph
+static int check()
+{
+    size_t bad = 0;
+
+    for( unsigned trial = 0; trial < 6; ++trial )
+    {
+        instGraph graph;
+        std::string emsg;
+
+        if( randomGraph( emsg, graph, trial < 4 ? 80 : 400, trial, trial % 2 ? 0.9 : 0.5 ) < 0 )
+        {
+            std::cerr << emsg << "\n";
+            return -1;
+        }
+
+        instLazy lazy( graph );
+
+        // A short queue has its oldest groups applied early
+        if( trial % 3 == 2 )
+        {
+            lazy.maxQueued( 16 );
+        }
+
+        std::vector<uint32_t> puts, beams;
+        handles( puts, beams, graph );
+
+        std::mt19937 rng( 200 + trial );
+
+        for( int n = 0; n < 20000; ++n )
+        {
+            int r = rng() % 20;
+
+            if( r < 8 )
+            {
+                uint32_t h = rng() % graph.nHandles();
+
+                if( liveState( graph, h ) != lazyState( graph, lazy, h ) )
+                {
+                    std::cerr << "trial " << trial << " op " << n << ": " << graph.handleName( h ) << " differs\n";
+                    ++bad;
+                }
+
+                continue;
+            }
+
+            instIOPut *put = graph.handlePut( puts[rng() % puts.size()] );
+
+            if( r == 8 )
+            {
+                bool en = rng() % 4 != 0;
+                put->enabled( en );
+                lazy.enabled( put, en );
+            }
+            else
+            {
+                putState ns = r < 14 ? putState::on : static_cast<putState>( rng() % 3 );
+                put->state( ns );
+                lazy.state( put, ns );
+            }
+
+            if( lazy.pending() > lazy.maxQueued() )
+            {
+                std::cerr << "trial " << trial << " op " << n << ": " << lazy.pending() << " writes queued\n";
+                ++bad;
+            }
+        }
+
+        lazy.flush();
+
+        for( uint32_t h = 0; h < graph.nHandles(); ++h )
+        {
+            if( liveState( graph, h ) != lazyState( graph, lazy, h ) )
+            {
+                std::cerr << "trial " << trial << " after flush: " << graph.handleName( h ) << " differs\n";
+                ++bad;
+            }
+        }
+    }
+
+    std::cout << "lazy check: " << bad << " differences\n";
+
+    return bad == 0 ? 0 : -1;
+}
+
+// Time one stream of operations on the live graph and on an instLazy of an identical graph
+static int workload( const char *name, size_t nWrites, size_t nReads )
+{
+    constexpr size_t nNodes = 5000;
+    constexpr double relayFrac = 0.7;
+
+    instGraph eager, lazyGraph;
+    std::string emsg;
+
+    if( randomGraph( emsg, eager, nNodes, 7, relayFrac ) < 0 ||
+        randomGraph( emsg, lazyGraph, nNodes, 7, relayFrac ) < 0 )
+    {
+        std::cerr << emsg << "\n";
+        return -1;
+    }
+
+    lightGraph( eager );
+    lightGraph( lazyGraph );
+
+    std::vector<uint32_t> puts, beams;
+    handles( puts, beams, eager );
+
+    // The writes are spread over the graph, with every fourth at a source, and the reads are spread evenly
+    // between them over a few beams
+    std::mt19937 rng( 9 );
+
+    std::vector<uint32_t> readBeams( 8 );
+    for( auto &&h : readBeams )
+    {
+        h = beams[rng() % beams.size()];
+    }
+
+    std::vector<operation> ops;
+    ops.reserve( nWrites + nReads );
+
+    for( size_t n = 0; n < nWrites; ++n )
+    {
+        uint32_t h = ( n % 4 == 0 ) ? eager.node( n % 8 ? "n0" : "n1" )->output( "o0" )->handle()
+                                    : puts[rng() % puts.size()];
+
+        ops.push_back( { false, h, rng() % 2 ? putState::on : putState::off } );
+
+        for( size_t r = n * nReads / nWrites; r < ( n + 1 ) * nReads / nWrites; ++r )
+        {
+            ops.push_back( { true, readBeams[r % readBeams.size()], putState::off } );
+        }
+    }
+
+    long eagerSum = 0;
+    auto t0 = std::chrono::steady_clock::now();
+
+    for( auto &&op : ops )
+    {
+        if( op.read )
+        {
+            eagerSum += static_cast<int>( eager.handleBeam( op.handle )->state() );
+        }
+        else
+        {
+            eager.handlePut( op.handle )->state( op.state );
+        }
+    }
+
+    double eagerMs = msSince( t0 );
+
+    instLazy lazy( lazyGraph );
+
+    long lazySum = 0;
+    t0 = std::chrono::steady_clock::now();
+
+    for( auto &&op : ops )
+    {
+        if( op.read )
+        {
+            lazySum += static_cast<int>( lazy.state( lazyGraph.handleBeam( op.handle ) ) );
+        }
+        else
+        {
+            lazy.state( lazyGraph.handlePut( op.handle ), op.state );
+        }
+    }
+
+    double lazyMs = msSince( t0 );
+
+    std::cout << std::setw( 12 ) << name << std::setw( 10 ) << nWrites << std::setw( 10 ) << nReads
+              << std::setw( 12 ) << eagerMs << std::setw( 12 ) << lazyMs << std::setw( 12 ) << lazy.applied()
+              << ( eagerSum == lazySum ? "" : "  reads differ" ) << "\n";
+
+    return eagerSum == lazySum ? 0 : -1;
+}
+
+int main( int argc, char **argv )
+{
+    if( argc > 1 && strcmp( argv[1], "check" ) == 0 )
+    {
+        return check();
+    }
+
+    std::cout << std::setw( 12 ) << "workload" << std::setw( 10 ) << "writes" << std::setw( 10 ) << "reads"
+              << std::setw( 12 ) << "eager ms" << std::setw( 12 ) << "lazy ms" << std::setw( 12 ) << "applied" << "\n";
+
+    if( workload( "write-heavy", 20000, 20 ) < 0 || workload( "read-heavy", 200, 2000000 ) < 0 )
+    {
+        return -1;
+    }
+
+    return 0;
+}
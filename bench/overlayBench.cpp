@@ -0,0 +1,420 @@
+/** \file
+ *
+ * \brief Benchmark and differential check of what-if overlays against the live graph
+ *
+ * With no arguments, times a what-if query, turning on a source and listing the differences, in an
+ * instOverlay and by changing the live graph and changing it back.  With the argument `check`, makes random
+ * changes in an overlay and the same changes in a live copy of its base graph, compares every put and beam
+ * and the differences listed, and checks that the base graph is unchanged, returning non-zero if anything
+ * differs.  With the argument `presets`, applies random presets to a graph and makes their settings one by
+ * one in a copy, and compares every put and beam and the number of notifications in the same way.
+ */
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+#include "toml++/toml.h"
+
+#include "instOverlay.hpp"
+#include "instPresets.hpp"
+
+#include "benchGraph.hpp"
+
+using namespace ingr;
+using namespace ingr::bench;
+
+// One change of a put: of its enabled flag or of its state
+struct change
+{
+    uint32_t handle;
+    bool setEnabled;
+    bool enabled;
+    putState state;
+};
+
+// Get the state of a put or beam in the live graph
+static int liveState( instGraph &graph, uint32_t h )
+{
+    if( instIOPut *put = graph.handlePut( h ) )
+    {
+        return static_cast<int>( put->state() );
+    }
+
+    return static_cast<int>( graph.handleBeam( h )->state() );
+}
+
+// Get the state of a put or beam in an overlay
+static int overlayState( instGraph &graph, instOverlay &ov, uint32_t h )
+{
+    if( instIOPut *put = graph.handlePut( h ) )
+    {
+        return static_cast<int>( ov.state( put ) );
+    }
+
+    return static_cast<int>( ov.state( graph.handleBeam( h ) ) );
+}
+
+// Make random changes to the puts
+static void randomChanges( std::vector<change> &changes,
+                           const std::vector<uint32_t> &puts,
+                           std::mt19937 &rng,
+                           size_t nChanges )
+{
+    changes.clear();
+
+    for( size_t n = 0; n < nChanges; ++n )
+    {
+        uint32_t h = puts[rng() % puts.size()];
+
+        if( rng() % 5 == 0 )
+        {
+            changes.push_back( { h, true, rng() % 2 == 0, putState::off } );
+        }
+        else
+        {
+            changes.push_back( { h, false, true, static_cast<putState>( rng() % 3 ) } );
+        }
+    }
+}
+
+// Make changes in the live graph
+static void makeChanges( instGraph &graph, const std::vector<change> &changes )
+{
+    for( auto &&c : changes )
+    {
+        if( c.setEnabled )
+        {
+            graph.handlePut( c.handle )->enabled( c.enabled );
+        }
+        else
+        {
+            graph.handlePut( c.handle )->state( c.state );
+        }
+    }
+}
+
+// Random changes in overlays over lit graphs, comparing each with the same changes made to a live copy
+static int check()
+{
+    size_t bad = 0;
+
+    for( unsigned trial = 0; trial < 4; ++trial )
+    {
+        size_t nNodes = trial < 3 ? 80 : 300;
+        double relayFrac = trial % 2 ? 0.8 : 0.3;
+
+        instGraph base;
+        std::string emsg;
+
+        if( randomGraph( emsg, base, nNodes, trial, relayFrac ) < 0 )
+        {
+            std::cerr << emsg << "\n";
+            return -1;
+        }
+
+        std::vector<uint32_t> puts, beams;
+        handles( puts, beams, base );
+
+        std::mt19937 rng( 400 + trial );
+
+        // The base starts lit, with some changes made to it
+        std::vector<change> prefix;
+        randomChanges( prefix, puts, rng, 20 );
+
+        lightGraph( base );
+        makeChanges( base, prefix );
+
+        std::vector<int> baseStates( base.nHandles() );
+        for( uint32_t h = 0; h < base.nHandles(); ++h )
+        {
+            baseStates[h] = liveState( base, h );
+        }
+
+        instOverlay ov( base );
+        overlayDiff d;
+        std::vector<change> changes;
+        std::vector<uint8_t> listed;
+
+        for( int q = 0; q < 300; ++q )
+        {
+            randomChanges( changes, puts, rng, 1 + rng() % 6 );
+
+            instGraph live;
+            randomGraph( emsg, live, nNodes, trial, relayFrac );
+            lightGraph( live );
+            makeChanges( live, prefix );
+            makeChanges( live, changes );
+
+            ov.clear();
+
+            for( auto &&c : changes )
+            {
+                if( c.setEnabled )
+                {
+                    ov.enabled( base.handlePut( c.handle ), c.enabled );
+                }
+                else
+                {
+                    ov.state( base.handlePut( c.handle ), c.state );
+                }
+            }
+
+            // The differences listed must be exactly the entities whose states differ from the base
+            ov.diff( d );
+
+            listed.assign( base.nHandles(), 0 );
+
+            for( auto &&p : d.puts )
+            {
+                listed[p.first->handle()] = 1;
+            }
+
+            for( auto &&b : d.beams )
+            {
+                listed[b.first->handle()] = 1;
+            }
+
+            for( uint32_t h = 0; h < base.nHandles(); ++h )
+            {
+                int st = liveState( live, h );
+
+                if( overlayState( base, ov, h ) != st || static_cast<bool>( listed[h] ) != ( st != baseStates[h] ) )
+                {
+                    std::cerr << "trial " << trial << " query " << q << ": " << base.handleName( h ) << " differs\n";
+                    ++bad;
+                }
+            }
+        }
+
+        for( uint32_t h = 0; h < base.nHandles(); ++h )
+        {
+            if( liveState( base, h ) != baseStates[h] )
+            {
+                std::cerr << "trial " << trial << ": base " << base.handleName( h ) << " changed\n";
+                ++bad;
+            }
+        }
+    }
+
+    std::cout << "overlay check: " << bad << " differences\n";
+
+    return bad == 0 ? 0 : -1;
+}
+
+// Get the number of notifications of a graph
+static uint64_t notifications( instGraph &graph )
+{
+    metricsSnapshot snap;
+    graph.metrics().snapshot( snap );
+
+    return snap.counters[static_cast<int>( metricCounter::graphNotifications )];
+}
+
+// Write random presets as TOML
+static void randomPresets( std::string &text, instGraph &graph, std::mt19937 &rng, size_t nPresets )
+{
+    std::vector<uint32_t> puts, beams;
+    handles( puts, beams, graph );
+
+    static const char *states[] = { "off", "waiting", "on" };
+
+    text.clear();
+
+    for( size_t p = 0; p < nPresets; ++p )
+    {
+        text += "[[presets]]\nname=\"p" + std::to_string( p ) + "\"\n";
+
+        for( size_t n = 0, nPuts = 30 + rng() % 50; n < nPuts; ++n )
+        {
+            instIOPut *put = graph.handlePut( puts[rng() % puts.size()] );
+
+            text += "[[presets.puts]]\nnode=\"" + put->node()->name() + "\"\n";
+            text += ( put->io() == ioDir::input ? "input=\"" : "output=\"" ) + put->name() + "\"\n";
+
+            bool setEnabled = rng() % 4 == 0;
+
+            if( !setEnabled || rng() % 2 == 0 )
+            {
+                text += std::string( "state=\"" ) + states[rng() % 3] + "\"\n";
+            }
+
+            if( setEnabled )
+            {
+                text += rng() % 3 ? "enabled=true\n" : "enabled=false\n";
+            }
+        }
+    }
+}
+
+// Make the settings of a preset one by one in the live graph, the enabled flags first
+static void makeSettings( instGraph &graph, const std::vector<presetSetting> &settings )
+{
+    for( auto &&ps : settings )
+    {
+        if( ps.setEnabled )
+        {
+            instNode *nd = graph.node( ps.node );
+            ( ps.io == ioDir::input ? nd->input( ps.put ) : nd->output( ps.put ) )->enabled( ps.enabled );
+        }
+    }
+
+    for( auto &&ps : settings )
+    {
+        if( ps.setState )
+        {
+            instNode *nd = graph.node( ps.node );
+            ( ps.io == ioDir::input ? nd->input( ps.put ) : nd->output( ps.put ) )->state( ps.state );
+        }
+    }
+}
+
+// Random presets applied to lit graphs, comparing each with the same settings made one by one to a copy
+static int checkPresets()
+{
+    size_t bad = 0;
+    size_t nChanges = 0;
+
+    for( unsigned trial = 0; trial < 6; ++trial )
+    {
+        instGraph graph, live;
+        std::string emsg;
+
+        if( randomGraph( emsg, graph, 300, trial, 0.6 ) < 0 || randomGraph( emsg, live, 300, trial, 0.6 ) < 0 )
+        {
+            std::cerr << emsg << "\n";
+            return -1;
+        }
+
+        lightGraph( graph );
+        lightGraph( live );
+
+        std::mt19937 rng( 500 + trial );
+
+        std::string text;
+        randomPresets( text, graph, rng, 5 );
+
+        instPresets presets( graph );
+
+        toml::table tbl = toml::parse( text );
+        if( presets.parseTOMLTable( tbl ) < 0 )
+        {
+            std::cerr << "trial " << trial << ": presets did not load\n";
+            return -1;
+        }
+
+        overlayDiff d;
+
+        for( int n = 0; n < 20; ++n )
+        {
+            std::string name = "p" + std::to_string( rng() % 5 );
+
+            // Staging must give the change set applied, without notifying the graph
+            uint64_t n0 = notifications( graph );
+            presets.stage( d, name );
+            size_t staged = d.puts.size() + d.beams.size();
+            uint64_t stageNotes = notifications( graph ) - n0;
+
+            presets.apply( d, name );
+            uint64_t nNotes = notifications( graph ) - n0;
+            nChanges += d.puts.size() + d.beams.size();
+
+            makeSettings( live, presets.presets().at( name ) );
+
+            if( d.puts.size() + d.beams.size() != staged || stageNotes != 0 || nNotes != ( d.empty() ? 0 : 1 ) )
+            {
+                std::cerr << "trial " << trial << " preset " << n << ": " << staged << " staged, "
+                          << d.puts.size() + d.beams.size() << " applied, " << nNotes << " notifications\n";
+                ++bad;
+            }
+
+            for( uint32_t h = 0; h < graph.nHandles(); ++h )
+            {
+                instIOPut *put = graph.handlePut( h );
+
+                if( liveState( graph, h ) != liveState( live, h ) ||
+                    ( put && put->enabled() != live.handlePut( h )->enabled() ) )
+                {
+                    std::cerr << "trial " << trial << " preset " << n << ": " << graph.handleName( h )
+                              << " differs\n";
+                    ++bad;
+                }
+            }
+        }
+    }
+
+    std::cout << "presets check: " << nChanges << " changes, " << bad << " differences\n";
+
+    return bad == 0 ? 0 : -1;
+}
+
+// Time what-if queries in an overlay and by changing the live graph and changing it back
+static int query()
+{
+    constexpr size_t nNodes = 2000;
+    constexpr int nQueries = 2000;
+
+    instGraph graph;
+    std::string emsg;
+
+    if( randomGraph( emsg, graph, nNodes, 11, 0.7 ) < 0 )
+    {
+        std::cerr << emsg << "\n";
+        return -1;
+    }
+
+    lightGraph( graph );
+
+    instIOPut *src = graph.node( "n0" )->output( "o0" );
+    src->state( putState::off );
+
+    instOverlay ov( graph );
+    overlayDiff d;
+    size_t nDiff = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    for( int q = 0; q < nQueries; ++q )
+    {
+        ov.clear();
+        ov.state( src, putState::on );
+        ov.diff( d );
+        nDiff += d.puts.size() + d.beams.size();
+    }
+
+    double overlayMs = msSince( t0 );
+
+    t0 = std::chrono::steady_clock::now();
+
+    for( int q = 0; q < nQueries; ++q )
+    {
+        src->state( putState::on );
+        src->state( putState::off );
+    }
+
+    double liveMs = msSince( t0 );
+
+    std::cout << std::setw( 8 ) << nNodes << std::setw( 10 ) << nDiff / nQueries << std::setw( 14 )
+              << overlayMs / nQueries << std::setw( 14 ) << liveMs / nQueries << "\n";
+
+    return 0;
+}
+
+int main( int argc, char **argv )
+{
+    if( argc > 1 && strcmp( argv[1], "check" ) == 0 )
+    {
+        return check();
+    }
+
+    if( argc > 1 && strcmp( argv[1], "presets" ) == 0 )
+    {
+        return checkPresets();
+    }
+
+    std::cout << std::setw( 8 ) << "nodes" << std::setw( 10 ) << "changes" << std::setw( 14 ) << "overlay ms"
+              << std::setw( 14 ) << "live ms" << "\n";
+
+    return query();
+}
@@ -0,0 +1,206 @@
+/** \file
+ *
+ * \brief Benchmark of building and updating the reachability between puts
+ *
+ * For random graphs of about 1k, 10k and 50k puts, prints the memory of the rows, the time to build them,
+ * and the mean number of rows recomputed and the mean time per enabled change.  With the argument `check`,
+ * makes random enabled changes on small graphs, including one with a loop, and compares every pair of puts
+ * with a search of the live graph, returning non-zero if any differs.
+ */
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+#include "instReachability.hpp"
+
+#include "benchGraph.hpp"
+
+using namespace ingr;
+using namespace ingr::bench;
+
+// Find the puts reached from a put through enabled puts, by a depth first search of the live graph
+static void search( std::vector<uint8_t> &reached, instGraph &graph, uint32_t a )
+{
+    reached.assign( graph.nHandles(), 0 );
+
+    if( !graph.handlePut( a )->enabled() )
+    {
+        return;
+    }
+
+    std::vector<instIOPut *> stack{ graph.handlePut( a ) };
+    reached[a] = 1;
+
+    while( !stack.empty() )
+    {
+        instIOPut *put = stack.back();
+        stack.pop_back();
+
+        std::vector<instIOPut *> next;
+
+        if( put->io() == ioDir::output )
+        {
+            if( put->beamValid() && put->beam()->destValid() )
+            {
+                next.push_back( put->beam()->dest() );
+            }
+        }
+        else
+        {
+            for( auto &&ol : put->outputLinks() )
+            {
+                next.push_back( put->node()->output( ol ) );
+            }
+        }
+
+        for( auto &&np : next )
+        {
+            if( !reached[np->handle()] && np->enabled() )
+            {
+                reached[np->handle()] = 1;
+                stack.push_back( np );
+            }
+        }
+    }
+}
+
+// Build a line of relays whose last output feeds back into the first, with a branch out of each
+static int loopGraph( std::string &emsg, instGraph &graph, size_t nNodes )
+{
+    instGraphBuilder bld;
+
+    for( size_t k = 0; k < nNodes; ++k )
+    {
+        std::string nn = "r" + std::to_string( k );
+        bld.addNode( nn );
+
+        bld.addPut( nn, ioDir::input, "in", putType::light, k > 0 ? "b" + std::to_string( k - 1 ) : "" );
+        bld.addPut( nn, ioDir::output, "out", putType::light, "b" + std::to_string( k ) );
+        bld.addPut( nn, ioDir::output, "branch", putType::light, "" );
+        bld.addOutputLink( nn, "in", "out" );
+        bld.addOutputLink( nn, "in", "branch" );
+    }
+
+    bld.addPut( "r0", ioDir::input, "loop", putType::light, "b" + std::to_string( nNodes - 1 ) );
+    bld.addOutputLink( "r0", "loop", "out" );
+
+    if( bld.build( emsg, graph ) < 0 )
+    {
+        return -1;
+    }
+
+    graph.assignHandles();
+
+    return 0;
+}
+
+// Random enabled changes on small graphs, comparing the reachability of every pair of puts with a search
+static int check()
+{
+    size_t bad = 0;
+
+    for( unsigned trial = 0; trial < 4; ++trial )
+    {
+        instGraph graph;
+        std::string emsg;
+
+        if( ( trial < 3 ? randomGraph( emsg, graph, 150, trial, trial * 0.4 ) : loopGraph( emsg, graph, 40 ) ) < 0 )
+        {
+            std::cerr << emsg << "\n";
+            return -1;
+        }
+
+        instReachability reach;
+        reach.build( graph );
+
+        std::vector<uint32_t> puts, beams;
+        handles( puts, beams, graph );
+
+        std::mt19937 rng( 300 + trial );
+        std::vector<uint8_t> reached;
+
+        for( int n = 0; n < 60; ++n )
+        {
+            instIOPut *put = graph.handlePut( puts[rng() % puts.size()] );
+            put->enabled( !put->enabled() );
+
+            for( auto &&a : puts )
+            {
+                search( reached, graph, a );
+
+                for( auto &&b : puts )
+                {
+                    if( reach.reaches( a, b ) != static_cast<bool>( reached[b] ) )
+                    {
+                        std::cerr << "trial " << trial << " change " << n << ": " << graph.handleName( a ) << " to "
+                                  << graph.handleName( b ) << " differs\n";
+                        ++bad;
+                    }
+                }
+            }
+        }
+    }
+
+    std::cout << "reachability check: " << bad << " differences\n";
+
+    return bad == 0 ? 0 : -1;
+}
+
+int main( int argc, char **argv )
+{
+    if( argc > 1 && strcmp( argv[1], "check" ) == 0 )
+    {
+        return check();
+    }
+
+    constexpr int nChanges = 200;
+
+    std::cout << std::setw( 8 ) << "puts" << std::setw( 14 ) << "memoryBytes" << std::setw( 12 ) << "build ms"
+              << std::setw( 14 ) << "updatedRows" << std::setw( 14 ) << "ms/change" << "\n";
+
+    for( size_t nPuts : { 1000, 10000, 50000 } )
+    {
+        instGraph graph;
+        std::string emsg;
+
+        if( randomGraph( emsg, graph, nPuts / 4, 1 ) < 0 )
+        {
+            std::cerr << emsg << "\n";
+            return -1;
+        }
+
+        std::vector<uint32_t> puts, beams;
+        handles( puts, beams, graph );
+
+        instReachability reach;
+
+        auto t0 = std::chrono::steady_clock::now();
+        reach.build( graph );
+        double buildMs = msSince( t0 );
+
+        // Each change toggles a random put, through the graph, which updates the rows
+        std::mt19937 rng( 2 );
+        size_t rows = 0;
+        double changeMs = 0;
+
+        for( int n = 0; n < nChanges; ++n )
+        {
+            instIOPut *put = graph.handlePut( puts[rng() % puts.size()] );
+            bool en = !put->enabled();
+
+            t0 = std::chrono::steady_clock::now();
+            put->enabled( en );
+            changeMs += msSince( t0 );
+
+            rows += reach.updatedRows();
+        }
+
+        std::cout << std::setw( 8 ) << puts.size() << std::setw( 14 ) << reach.memoryBytes() << std::setw( 12 )
+                  << buildMs << std::setw( 14 ) << static_cast<double>( rows ) / nChanges << std::setw( 14 )
+                  << changeMs / nChanges << "\n";
+    }
+
+    return 0;
+}
@@ -8,7 +8,9 @@
 #ifndef ingr_basicTypes_hpp
 #define ingr_basicTypes_hpp
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace ingr
 {
@@ -54,6 +56,20 @@ enum class beamState
     on            ///< The beam is on
 };
 
+/// The kinds of entity which have a state
+/** \ingroup basic_types
+ */
+enum class entityKind : uint8_t
+{
+    put, ///< an instIOPut
+    beam ///< an instBeam
+};
+
+/// The handle of a put or beam which has not been assigned one by instGraph::assignHandles
+/** \ingroup basic_types
+ */
+constexpr uint32_t invalidHandle = 0xFFFFFFFF;
+
 /** \defgroup state_string String Representations of Types and States
  * \ingroup basic_types
  * @{
@@ -103,6 +119,27 @@ inline std::string putState2String( putState state /**< [in] the IOPut state*/ )
         return "unk";
 }
 
+/// Get an IOPut state from its string representation
+/**
+ * \returns 0 on success, with \p state set
+ * \returns -1 if \p str is not "off", "waiting", or "on"
+ */
+inline int string2PutState( putState &state,     /**< [out] the IOPut state */
+                            std::string_view str /**< [in] the string representation */
+)
+{
+    if( str == "off" )
+        state = putState::off;
+    else if( str == "waiting" )
+        state = putState::waiting;
+    else if( str == "on" )
+        state = putState::on;
+    else
+        return -1;
+
+    return 0;
+}
+
 /// Get a string representation of an IOPut's type
 /**
  * \returns a string with value "light", "data", "power", or "mechanical"
@@ -123,6 +160,31 @@ inline std::string putType2String( putType type /**< [in] the IOPut type*/ )
         return "unknown";
 }
 
+/// Get an IOPut type from its string representation
+/**
+ * \returns 0 on success, with \p type set
+ * \returns -1 if \p str is not "light", "data", "power", "mechanical", or "fluid"
+ */
+inline int string2PutType( putType &type,       /**< [out] the IOPut type */
+                           std::string_view str /**< [in] the string representation */
+)
+{
+    if( str == "light" )
+        type = putType::light;
+    else if( str == "data" )
+        type = putType::data;
+    else if( str == "power" )
+        type = putType::power;
+    else if( str == "mechanical" )
+        type = putType::mechanical;
+    else if( str == "fluid" )
+        type = putType::fluid;
+    else
+        return -1;
+
+    return 0;
+}
+
 /// Get a character representation of an IOPut's type
 /**
  * \returns a character with value l, d, p, or m.
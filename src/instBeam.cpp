@@ -1,7 +1,8 @@
 #include "instBeam.hpp"
 #include "instGraph.hpp"
+#include "instTrace.hpp"
 
-#include <iostream>
+#include <stdexcept>
 
 namespace ingr
 {
@@ -73,6 +74,16 @@ beamState instBeam::state()
     return m_state;
 }
 
+uint32_t instBeam::handle() const
+{
+    return m_handle;
+}
+
+void instBeam::handle( uint32_t h )
+{
+    m_handle = h;
+}
+
 void instBeam::parentGraph( instGraph *ig )
 {
     m_parentGraph = ig;
@@ -103,8 +114,38 @@ std::string instBeam::key()
     return m_name;
 }
 
+void instBeam::notifyTransition( beamState from )
+{
+    if( m_parentGraph )
+    {
+        // A beam without a dest which stays intermediate is not a transition, but still notifies as it always has
+        if( from == m_state )
+        {
+            m_parentGraph->notifyStateChange();
+            return;
+        }
+
+        m_parentGraph->metrics().count( metricCounter::beamTransitions );
+        m_parentGraph->recordTransition( entityKind::beam,
+                                         m_handle,
+                                         static_cast<int>( from ),
+                                         static_cast<int>( m_state ),
+                                         journalCause::propagation );
+        m_parentGraph->notifyStateChange();
+    }
+}
+
 void instBeam::stateChange()
 {
+    INGR_TRACE_STATE_SCOPE( beamStateChange, this, m_state );
+
+    if( m_parentGraph )
+    {
+        m_parentGraph->metrics().count( metricCounter::beamStateChanges );
+    }
+
+    beamState from = m_state;
+
     // First handle cases where source or dest are null pointers
 
     // if m_source is null, then nothing else matters
@@ -115,6 +156,9 @@ void instBeam::stateChange()
 
         m_state = beamState::off;
 
+        // Record the beam before the change it causes in its dest
+        notifyTransition( from );
+
         if( m_dest )
         {
             if( m_dest->state() == putState::on )
@@ -123,9 +167,6 @@ void instBeam::stateChange()
             }
         }
 
-        if( m_parentGraph )
-            m_parentGraph->stateChange();
-
         return;
     }
 
@@ -145,8 +186,7 @@ void instBeam::stateChange()
             m_state = beamState::off;
         }
 
-        if( m_parentGraph )
-            m_parentGraph->stateChange();
+        notifyTransition( from );
 
         return;
     }
@@ -158,14 +198,13 @@ void instBeam::stateChange()
             return;
         m_state = beamState::off;
 
+        notifyTransition( from );
+
         if( m_dest->state() == putState::on )
         {
             m_dest->state( putState::waiting, true );
         }
 
-        if( m_parentGraph )
-            m_parentGraph->stateChange();
-
         return;
     }
     else if( m_source->state() == putState::on )
@@ -178,19 +217,20 @@ void instBeam::stateChange()
             }
             m_state = beamState::on;
 
+            notifyTransition( from );
+
             m_dest->state( putState::on, true );
+
+            return;
         }
-        else
+
+        if( m_state == beamState::intermediate )
         {
-            if( m_state == beamState::intermediate )
-            {
-                return;
-            }
-            m_state = beamState::intermediate;
+            return;
         }
+        m_state = beamState::intermediate;
 
-        if( m_parentGraph )
-            m_parentGraph->stateChange();
+        notifyTransition( from );
 
         return;
     }
@@ -203,13 +243,13 @@ void instBeam::stateChange()
 
         m_state = beamState::off;
 
+        notifyTransition( from );
+
         if( m_dest->state() == putState::on )
         {
             m_dest->state( putState::waiting, true );
         }
 
-        if( m_parentGraph )
-            m_parentGraph->stateChange();
         return;
     }
 }
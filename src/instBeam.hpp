@@ -20,6 +20,7 @@ class instGraph;
  */
 class instBeam
 {
+    friend class instOverlay;
 
   protected:
     std::string m_name;                  ///< The name of this beam, must be unique.
@@ -28,7 +29,7 @@ class instBeam
 
     instIOPut *m_dest{ nullptr };        ///< The output
 
-    beamState m_state;                   /**< The current state of the beam, calculated on
+    beamState m_state{ beamState::off }; /**< The current state of the beam, calculated on
                                               a call to stateChange() from the states of the
                                               inputs.  Will have one of the values of
                                               beamState::off (default), beamState::intermediate,
@@ -38,6 +39,8 @@ class instBeam
 
     void *m_auxData{ nullptr };          ///< Auxilliary data for this beam, i.e. for GUI support.
 
+    uint32_t m_handle{ invalidHandle };  ///< Compact identifier within the parent graph, see instGraph::assignHandles
+
   public:
     /// Default c'tor
     instBeam();
@@ -97,6 +100,15 @@ class instBeam
      */
     beamState state();
 
+    /// Get the handle of this beam
+    /**
+     * \returns the current value of m_handle
+     */
+    uint32_t handle() const;
+
+    /// Set the handle of this beam
+    void handle( uint32_t h /**< [in] the new handle */ );
+
     /// Set the parent instGraph
     void parentGraph( instGraph *ig /**< [in] pointer to the parent instGraph */ );
 
@@ -128,6 +140,10 @@ class instBeam
     /** Re-calculates the beam state based on the states of the input and output.
      */
     void stateChange();
+
+  protected:
+    /// Count and journal a change of the beam's state, if it changed, and notify the parent graph, if set
+    void notifyTransition( beamState from /**< [in] the state before the change */ );
 };
 
 } // namespace ingr
@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "instBlame.hpp"
+#include "instGraph.hpp"
+
+namespace ingr
+{
+
+std::string blameReason2String( blameReason reason )
+{
+    if( reason == blameReason::on )
+        return "on";
+    else if( reason == blameReason::disabled )
+        return "disabled";
+    else if( reason == blameReason::off )
+        return "off";
+    else if( reason == blameReason::unconnected )
+        return "unconnected";
+    else if( reason == blameReason::stuck )
+        return "stuck";
+    else if( reason == blameReason::loop )
+        return "loop";
+    else
+        return "unknown";
+}
+
+// The value of putState::on and beamState::on
+static constexpr int stateOn = static_cast<int>( putState::on );
+
+static_assert( static_cast<int>( beamState::on ) == stateOn );
+
+instBlame::instBlame( instGraph &graph ) : m_graph{ &graph }
+{
+    compile();
+}
+
+void instBlame::compile()
+{
+    size_t nHandles = m_graph->assignHandles();
+
+    m_nPuts = 0;
+    while( m_nPuts < nHandles && m_graph->handlePut( m_nPuts ) != nullptr )
+    {
+        ++m_nPuts;
+    }
+
+    m_linkStart.assign( m_nPuts + 1, 0 );
+    m_links.clear();
+
+    for( uint32_t h = 0; h < m_nPuts; ++h )
+    {
+        instIOPut *put = m_graph->handlePut( h );
+
+        m_linkStart[h] = m_links.size();
+
+        if( put->io() == ioDir::output && put->outputLinked() && put->nodeValid() )
+        {
+            for( auto &&ip : put->node()->inputs() )
+            {
+                if( ip.second != nullptr && ip.second->outputLinks().count( put->name() ) > 0 )
+                {
+                    m_links.push_back( ip.second->handle() );
+                }
+            }
+        }
+    }
+
+    m_linkStart[m_nPuts] = m_links.size();
+
+    m_cache.assign( nHandles, {} );
+    m_parent.assign( nHandles, invalidHandle );
+    m_seen.assign( nHandles, 0 );
+    m_walk = 0;
+}
+
+blameStep instBlame::step( uint32_t h )
+{
+    if( h < m_nPuts )
+    {
+        instIOPut *put = m_graph->handlePut( h );
+
+        return { entityKind::put, h, static_cast<int>( put->state() ), put->enabled() };
+    }
+
+    return { entityKind::beam, h, static_cast<int>( m_graph->handleBeam( h )->state() ), true };
+}
+
+blameReason instBlame::upstream( uint32_t h )
+{
+    m_up.clear();
+
+    if( h < m_nPuts )
+    {
+        instIOPut *put = m_graph->handlePut( h );
+
+        if( !put->enabled() )
+        {
+            return blameReason::disabled;
+        }
+
+        if( put->io() == ioDir::input )
+        {
+            // An input which is off was not set on, and one which is waiting is waiting for its beam
+            if( put->state() == putState::off )
+            {
+                return blameReason::off;
+            }
+
+            if( !put->beamValid() )
+            {
+                return blameReason::unconnected;
+            }
+
+            // A waiting input only turns on when its beam turns on, so one behind a beam which is already on
+            // must be set on
+            if( put->beam()->state() == beamState::on )
+            {
+                return blameReason::stuck;
+            }
+
+            m_up.push_back( put->beam()->handle() );
+        }
+        else if( put->outputLinked() )
+        {
+            for( uint32_t n = m_linkStart[h]; n < m_linkStart[h + 1]; ++n )
+            {
+                if( m_graph->handlePut( m_links[n] )->state() != putState::on )
+                {
+                    m_up.push_back( m_links[n] );
+                }
+            }
+        }
+    }
+    else
+    {
+        instBeam *beam = m_graph->handleBeam( h );
+
+        if( !beam->sourceValid() )
+        {
+            return blameReason::unconnected;
+        }
+
+        if( beam->source()->state() != putState::on )
+        {
+            m_up.push_back( beam->source()->handle() );
+        }
+        else if( !beam->destValid() )
+        {
+            return blameReason::unconnected;
+        }
+        else if( beam->dest()->state() == putState::off )
+        {
+            m_up.push_back( beam->dest()->handle() );
+        }
+    }
+
+    return m_up.empty() ? blameReason::off : blameReason::on;
+}
+
+void instBlame::walk( blameChain &chain, uint32_t h )
+{
+    chain.steps.clear();
+
+    blameStep first = step( h );
+
+    if( first.state == stateOn )
+    {
+        chain.steps.push_back( first );
+        chain.reason = blameReason::on;
+        return;
+    }
+
+    if( ++m_walk == 0 )
+    {
+        std::fill( m_seen.begin(), m_seen.end(), 0 );
+        m_walk = 1;
+    }
+
+    m_queue.clear();
+    m_queue.push_back( h );
+    m_seen[h] = m_walk;
+    m_parent[h] = invalidHandle;
+
+    for( size_t q = 0; q < m_queue.size(); ++q )
+    {
+        uint32_t v = m_queue[q];
+
+        blameReason reason = upstream( v );
+
+        if( reason != blameReason::on )
+        {
+            // Found a root cause, so read the chain back through the parents
+            for( uint32_t x = v; x != invalidHandle; x = m_parent[x] )
+            {
+                chain.steps.push_back( step( x ) );
+            }
+
+            std::reverse( chain.steps.begin(), chain.steps.end() );
+
+            chain.reason = reason;
+            return;
+        }
+
+        for( auto &&u : m_up )
+        {
+            if( m_seen[u] != m_walk )
+            {
+                m_seen[u] = m_walk;
+                m_parent[u] = v;
+                m_queue.push_back( u );
+            }
+        }
+    }
+
+    chain.steps.push_back( first );
+    chain.reason = blameReason::loop;
+}
+
+const blameChain &instBlame::explain( uint32_t h )
+{
+    if( h >= m_cache.size() )
+    {
+        throw std::out_of_range( "instBlame::explain: invalid handle" );
+    }
+
+    entry &e = m_cache[h];
+
+    if( e.valid )
+    {
+        // Still valid if nothing in the chain has changed
+        auto it = e.chain.steps.begin();
+        for( ; it != e.chain.steps.end(); ++it )
+        {
+            blameStep now = step( it->handle );
+
+            if( now.state != it->state || now.enabled != it->enabled )
+            {
+                break;
+            }
+        }
+
+        if( it == e.chain.steps.end() )
+        {
+            return e.chain;
+        }
+    }
+
+    // A loop has no root cause to watch, so it is found again each time
+    walk( e.chain, h );
+    e.valid = ( e.chain.reason != blameReason::loop );
+
+    return e.chain;
+}
+
+const blameChain &instBlame::explain( instIOPut *put )
+{
+    return explain( put->handle() );
+}
+
+const blameChain &instBlame::explain( instBeam *beam )
+{
+    return explain( beam->handle() );
+}
+
+} // namespace ingr
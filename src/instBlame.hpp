@@ -0,0 +1,153 @@
+/** \file
+ *
+ * \brief Explaining why a put or beam is not on
+ */
+
+#ifndef instBlame_hpp
+#define instBlame_hpp
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "basicTypes.hpp"
+
+namespace ingr
+{
+
+class instGraph;
+class instIOPut;
+class instBeam;
+
+/// The root causes of a put or beam not being on
+/**
+ * \ingroup explainer
+ */
+enum class blameReason : uint8_t
+{
+    on,          ///< The entity is on, so there is nothing to explain
+    disabled,    ///< The last entity in the chain is a disabled put
+    off,         ///< The last entity in the chain is a put which is off and is not fed by anything upstream
+    unconnected, ///< The last entity in the chain is a beam without a source or dest, or a waiting input without a beam
+    stuck,       ///< The last entity in the chain is a waiting input whose beam is already on, so it must be set on
+    loop         ///< Every path upstream loops back, so there is no root cause
+};
+
+/// Get a string representation of a blame reason
+/**
+ * \returns a string with value "on", "disabled", "off", "unconnected", "stuck", or "loop"
+ */
+std::string blameReason2String( blameReason reason /**< [in] the reason */ );
+
+/// One entity in a blame chain, with the state it was in when the chain was found
+/**
+ * \ingroup explainer
+ */
+struct blameStep
+{
+    entityKind kind;  ///< Whether this is a put or a beam
+    uint32_t handle;  ///< The handle of the entity
+    int state;        ///< The state, as the value of a putState or beamState
+    bool enabled;     ///< Whether the put is enabled, always true for a beam
+};
+
+/// The chain of entities responsible for a put or beam not being on
+/**
+ * \ingroup explainer
+ */
+struct blameChain
+{
+    std::vector<blameStep> steps;          ///< From the entity asked about, upstream to the root cause
+    blameReason reason{ blameReason::on }; ///< Why the last step is not on
+};
+
+/// Upstream blame queries, with cached explanations
+/** explain() walks upstream from a put or beam which is not on, following only entities which are not on: a
+ * waiting input to its beam, a beam to its source, or to its dest if the source is on, and an output-linked
+ * output to its linked inputs.  The walk is breadth first, so the chain found is a shortest one, read back
+ * through the parent recorded for each entity reached.
+ *
+ * Each explanation is cached with the states and enabled flags of the entities in its chain.  It stays
+ * valid until one of those changes, which is checked at each query at a cost proportional to the length of
+ * the chain, so explanations for many puts can be shown continuously without walking the graph again.
+ * Since only the entities in the chain are checked, a cached chain is still a valid explanation after an
+ * entity outside it changes, but it may no longer be a shortest one.
+ *
+ * Call compile() after changing the topology.
+ *
+ * \ingroup explainer
+ */
+class instBlame
+{
+  protected:
+    /// A cached explanation
+    struct entry
+    {
+        bool valid{ false };
+        blameChain chain;
+    };
+
+    instGraph *m_graph{ nullptr }; ///< The graph
+
+    uint32_t m_nPuts{ 0 };            ///< The number of puts, whose handles come first
+
+    std::vector<uint32_t> m_linkStart; ///< For outputs, the start of the linked inputs in m_links
+    std::vector<uint32_t> m_links;     ///< The handles of the inputs linked to each output-linked output
+
+    std::vector<entry> m_cache;       ///< The cached explanations, indexed by handle
+
+    std::vector<uint32_t> m_parent;   ///< The entity downstream of each entity reached by the walk
+    std::vector<uint32_t> m_seen;     ///< The walk in which each entity was last reached
+    uint32_t m_walk{ 0 };             ///< The number of the current walk
+    std::vector<uint32_t> m_queue;    ///< The walk's queue
+    std::vector<uint32_t> m_up;       ///< The entities upstream of the one being expanded
+
+  public:
+    /// Construct for a graph, compiling its topology
+    explicit instBlame( instGraph &graph /**< [in] the graph, which must outlive the queries */ );
+
+    /// Compile the topology of the graph and clear the cache
+    /** Assigns handles in the graph.
+     */
+    void compile();
+
+    /// Explain why an entity is not on
+    /**
+     * \returns a reference to the cached explanation, valid until the next call
+     *
+     * \throws std::out_of_range if \p h is not a valid handle
+     */
+    const blameChain &explain( uint32_t h /**< [in] the handle of the put or beam */ );
+
+    /// Explain why a put is not on
+    /**
+     * \returns a reference to the cached explanation, valid until the next call
+     */
+    const blameChain &explain( instIOPut *put /**< [in] the put */ );
+
+    /// Explain why a beam is not on
+    /**
+     * \returns a reference to the cached explanation, valid until the next call
+     */
+    const blameChain &explain( instBeam *beam /**< [in] the beam */ );
+
+  protected:
+    /// Get the current state of an entity as a step
+    blameStep step( uint32_t h /**< [in] the handle */ );
+
+    /// Find the entities upstream which are responsible for an entity not being on
+    /**
+     * \returns blameReason::on if there are entities upstream, in m_up, otherwise the reason the entity is
+     *          the root cause
+     */
+    blameReason upstream( uint32_t h /**< [in] the handle */ );
+
+    /// Walk upstream and fill a chain
+    void walk( blameChain &chain, /**< [out] the chain */
+               uint32_t h         /**< [in] the handle to start from */
+    );
+};
+
+} // namespace ingr
+
+#endif // instBlame_hpp
@@ -0,0 +1,75 @@
+#include "instChanges.hpp"
+#include "instGraph.hpp"
+
+namespace ingr
+{
+
+void instChanges::start( instGraph &graph, size_t logSize )
+{
+    stop();
+
+    graph.assignHandles();
+
+    m_lastChanged.assign( graph.nHandles(), 0 );
+    m_log.assign( logSize > 0 ? logSize : 1, invalidHandle );
+
+    m_startGeneration = m_generation;
+    m_active = true;
+}
+
+void instChanges::stop()
+{
+    m_active = false;
+
+    m_lastChanged.clear();
+    m_lastChanged.shrink_to_fit();
+    m_log.clear();
+    m_log.shrink_to_fit();
+}
+
+uint64_t instChanges::generation() const
+{
+    return m_generation;
+}
+
+uint64_t instChanges::lastChanged( uint32_t h ) const
+{
+    if( h >= m_lastChanged.size() )
+    {
+        return 0;
+    }
+
+    return m_lastChanged[h];
+}
+
+void instChanges::changesSince( changeSet &cs, uint64_t gen ) const
+{
+    cs.generation = m_generation;
+    cs.snapshot = false;
+    cs.handles.clear();
+
+    if( gen >= m_generation )
+    {
+        return;
+    }
+
+    // The log holds the generations after m_generation - m_log.size(), and nothing from before start()
+    if( !m_active || gen < m_startGeneration || m_generation - gen > m_log.size() )
+    {
+        cs.snapshot = true;
+        return;
+    }
+
+    // An entity is listed at its last change only
+    for( uint64_t g = gen + 1; g <= m_generation; ++g )
+    {
+        uint32_t h = m_log[g % m_log.size()];
+
+        if( h < m_lastChanged.size() && m_lastChanged[h] == g )
+        {
+            cs.handles.push_back( h );
+        }
+    }
+}
+
+} // namespace ingr
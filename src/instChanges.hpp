@@ -0,0 +1,119 @@
+/** \file
+ *
+ * \brief Generation counters and a bounded change log for polling clients
+ */
+
+#ifndef instChanges_hpp
+#define instChanges_hpp
+
+#include <cstdint>
+#include <vector>
+
+#include "basicTypes.hpp"
+
+namespace ingr
+{
+
+class instGraph;
+
+/// The puts and beams changed since a generation
+/**
+ * \ingroup explainer
+ */
+struct changeSet
+{
+    uint64_t generation{ 0 };      ///< The generation the set is complete up to, to pass to the next query
+    bool snapshot{ false };        ///< True if the log did not reach back far enough, so every entity must be read
+    std::vector<uint32_t> handles; ///< The handles of the changed puts and beams, each once, empty for a snapshot
+};
+
+/// A graph generation, the generation each put and beam last changed in, and a log of recent changes
+/** The graph reports each transition with transition(), which advances the generation by one, so the
+ * generation of a graph never decreases.  Once started with start(), the generation each entity last
+ * changed in is kept, and the handles of the entities which changed in the most recent generations are kept
+ * in a ring buffer.  A client which polls with changesSince() is then given only the entities which changed
+ * since its last poll, at a cost proportional to the number of changes.  If the client is further behind
+ * than the log reaches, it is told to read every entity instead.
+ *
+ * Entities are identified by the handles assigned by instGraph::assignHandles, so call start() again after
+ * changing the topology.  Must only be used from the thread which changes the graph.
+ *
+ * \ingroup explainer
+ */
+class instChanges
+{
+  protected:
+    bool m_active{ false };                ///< Whether changes are being logged
+
+    uint64_t m_generation{ 0 };            ///< The generation of the last transition
+
+    uint64_t m_startGeneration{ 0 };       ///< The generation at start()
+
+    std::vector<uint64_t> m_lastChanged;   ///< The generation of the last transition of each entity, by handle
+
+    std::vector<uint32_t> m_log;           ///< The handles of recent transitions, by generation modulo the size
+
+  public:
+    /// Start logging changes
+    /** Assigns handles in the graph.  The generation continues from its current value.
+     */
+    void start( instGraph &graph,         /**< [in] the graph */
+                size_t logSize = 65536    /**< [in] [optional] the number of transitions kept in the log */
+    );
+
+    /// Stop logging changes and release the memory
+    /** The generation is kept.
+     */
+    void stop();
+
+    /// Check if changes are being logged
+    /**
+     * \returns the current value of m_active
+     */
+    bool active() const
+    {
+        return m_active;
+    }
+
+    /// Account for a transition.  Called by the graph.
+    void transition( uint32_t h /**< [in] the handle of the entity */ )
+    {
+        ++m_generation;
+
+        if( !m_active )
+        {
+            return;
+        }
+
+        if( h < m_lastChanged.size() )
+        {
+            m_lastChanged[h] = m_generation;
+        }
+
+        m_log[m_generation % m_log.size()] = h;
+    }
+
+    /// Get the generation of the last transition
+    /**
+     * \returns the current value of m_generation
+     */
+    uint64_t generation() const;
+
+    /// Get the generation an entity last changed in
+    /**
+     * \returns the generation, or 0 if it has not changed since start() or \p h is not a valid handle
+     */
+    uint64_t lastChanged( uint32_t h /**< [in] the handle of the entity */ ) const;
+
+    /// Get the entities which changed after a generation
+    /** Each entity is listed once, however many times it changed.  If \p gen is older than the log reaches, is
+     * from before start(), or changes are not being logged, the set is a snapshot.
+     */
+    void changesSince( changeSet &cs,   /**< [out] the changes, with the generation to pass next time */
+                       uint64_t gen     /**< [in] the generation of the client's last poll */
+    ) const;
+};
+
+} // namespace ingr
+
+#endif // instChanges_hpp
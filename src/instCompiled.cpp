@@ -0,0 +1,599 @@
+#include "instCompiled.hpp"
+#include "instGraph.hpp"
+
+namespace ingr
+{
+
+// The put and beam states as stored
+static constexpr uint8_t putOff = static_cast<uint8_t>( putState::off );
+static constexpr uint8_t putWaiting = static_cast<uint8_t>( putState::waiting );
+static constexpr uint8_t putOn = static_cast<uint8_t>( putState::on );
+static constexpr uint8_t beamOff = static_cast<uint8_t>( beamState::off );
+static constexpr uint8_t beamIntermediate = static_cast<uint8_t>( beamState::intermediate );
+static constexpr uint8_t beamOn = static_cast<uint8_t>( beamState::on );
+
+instCompiled::instCompiled( instGraph &graph ) : m_graph{ &graph }
+{
+    compile();
+}
+
+void instCompiled::compile()
+{
+    size_t nHandles = m_graph->assignHandles();
+
+    m_nPuts = 0;
+    while( m_nPuts < nHandles && m_graph->handlePut( m_nPuts ) != nullptr )
+    {
+        ++m_nPuts;
+    }
+
+    size_t nBeams = nHandles - m_nPuts;
+
+    m_state.assign( nHandles, 0 );
+    m_enabled.assign( m_nPuts, 1 );
+    m_isInput.assign( m_nPuts, 0 );
+    m_linked.assign( m_nPuts, 0 );
+    m_beamOf.assign( m_nPuts, invalidHandle );
+    m_beamSource.assign( nBeams, invalidHandle );
+    m_beamDest.assign( nBeams, invalidHandle );
+    m_linkStart.assign( m_nPuts + 1, 0 );
+    m_links.clear();
+
+    for( uint32_t h = 0; h < m_nPuts; ++h )
+    {
+        instIOPut *put = m_graph->handlePut( h );
+
+        m_isInput[h] = ( put->io() == ioDir::input );
+        m_linked[h] = ( put->io() == ioDir::output && put->outputLinked() );
+
+        if( put->beamValid() )
+        {
+            m_beamOf[h] = put->beam()->handle();
+        }
+
+        m_linkStart[h] = m_links.size();
+
+        if( put->nodeValid() )
+        {
+            if( m_isInput[h] )
+            {
+                for( auto &&ol : put->outputLinks() )
+                {
+                    if( put->node()->outputValid( ol ) )
+                    {
+                        m_links.push_back( put->node()->output( ol )->handle() );
+                    }
+                }
+            }
+            else if( m_linked[h] )
+            {
+                for( auto &&ip : put->node()->inputs() )
+                {
+                    if( ip.second != nullptr && ip.second->outputLinks().count( put->name() ) > 0 )
+                    {
+                        m_links.push_back( ip.second->handle() );
+                    }
+                }
+            }
+        }
+    }
+    m_linkStart[m_nPuts] = m_links.size();
+
+    for( uint32_t b = 0; b < nBeams; ++b )
+    {
+        instBeam *beam = m_graph->handleBeam( m_nPuts + b );
+
+        if( beam->sourceValid() )
+        {
+            m_beamSource[b] = beam->source()->handle();
+        }
+
+        if( beam->destValid() )
+        {
+            m_beamDest[b] = beam->dest()->handle();
+        }
+    }
+
+    // The input of each pass-through node, which has one input linked to its only output
+    std::vector<uint32_t> passOut( m_nPuts, invalidHandle ); // by input, the output of a pass-through node
+
+    for( auto &&node : m_graph->nodes() )
+    {
+        if( node.second->inputs().size() != 1 || node.second->outputs().size() != 1 )
+        {
+            continue;
+        }
+
+        instIOPut *ip = node.second->inputs().begin()->second;
+        instIOPut *op = node.second->outputs().begin()->second;
+
+        if( ip->outputLinks().size() == 1 && ip->outputLinks().count( op->name() ) == 1 )
+        {
+            passOut[ip->handle()] = op->handle();
+        }
+    }
+
+    // The next pass-through input along the beam from each pass-through node
+    auto nextPass = [&]( uint32_t in ) -> uint32_t
+    {
+        uint32_t b = m_beamOf[passOut[in]];
+
+        if( b == invalidHandle )
+        {
+            return invalidHandle;
+        }
+
+        uint32_t dest = m_beamDest[b - m_nPuts];
+
+        return ( dest != invalidHandle && passOut[dest] != invalidHandle ) ? dest : invalidHandle;
+    };
+
+    std::vector<uint8_t> hasPrev( m_nPuts, 0 );
+    for( uint32_t h = 0; h < m_nPuts; ++h )
+    {
+        if( passOut[h] != invalidHandle )
+        {
+            uint32_t n = nextPass( h );
+            if( n != invalidHandle )
+            {
+                hasPrev[n] = 1;
+            }
+        }
+    }
+
+    m_chains.clear();
+    m_chainOf.assign( nHandles, invalidHandle );
+    m_chainPos.assign( nHandles, 0 );
+    m_chainHead.assign( m_nPuts, invalidHandle );
+
+    // Chains start at a pass-through node with no pass-through node before it, so rings are left alone
+    for( uint32_t h = 0; h < m_nPuts; ++h )
+    {
+        if( passOut[h] == invalidHandle || hasPrev[h] || nextPass( h ) == invalidHandle )
+        {
+            continue;
+        }
+
+        chain ch;
+
+        for( uint32_t in = h; in != invalidHandle; in = nextPass( in ) )
+        {
+            ch.ins.push_back( in );
+            ch.outs.push_back( passOut[in] );
+        }
+
+        for( size_t i = 0; i + 1 < ch.outs.size(); ++i )
+        {
+            ch.beams.push_back( m_beamOf[ch.outs[i]] );
+        }
+
+        uint32_t c = m_chains.size();
+
+        for( uint32_t i = 0; i < ch.outs.size(); ++i )
+        {
+            m_chainOf[ch.outs[i]] = c;
+            m_chainPos[ch.outs[i]] = i;
+        }
+
+        for( uint32_t i = 1; i < ch.ins.size(); ++i )
+        {
+            m_chainOf[ch.ins[i]] = c;
+            m_chainPos[ch.ins[i]] = i;
+        }
+
+        for( uint32_t i = 0; i < ch.beams.size(); ++i )
+        {
+            m_chainOf[ch.beams[i]] = c;
+            m_chainPos[ch.beams[i]] = i;
+        }
+
+        m_chainHead[ch.outs[0]] = c;
+
+        m_chains.push_back( std::move( ch ) );
+    }
+
+    load();
+}
+
+void instCompiled::load()
+{
+    for( uint32_t h = 0; h < m_nPuts; ++h )
+    {
+        instIOPut *put = m_graph->handlePut( h );
+
+        m_state[h] = static_cast<uint8_t>( put->state() );
+        m_enabled[h] = put->enabled();
+    }
+
+    for( uint32_t h = m_nPuts; h < m_state.size(); ++h )
+    {
+        m_state[h] = static_cast<uint8_t>( m_graph->handleBeam( h )->state() );
+    }
+
+    for( uint32_t c = 0; c < m_chains.size(); ++c )
+    {
+        m_chains[c].compressed = false;
+        m_chains[c].touched = false;
+        tryCompress( c );
+    }
+
+    m_touched.clear();
+}
+
+uint8_t instCompiled::stateOf( uint32_t h )
+{
+    uint32_t c = m_chainOf[h];
+
+    if( c == invalidHandle || !m_chains[c].compressed )
+    {
+        return m_state[h];
+    }
+
+    const chain &ch = m_chains[c];
+
+    if( h >= m_nPuts )
+    {
+        return ch.lit ? beamOn : beamOff;
+    }
+
+    if( !m_isInput[h] && m_chainPos[h] == 0 )
+    {
+        return ch.out1;
+    }
+
+    return ch.lit ? putOn : putWaiting;
+}
+
+void instCompiled::store( uint32_t h, uint8_t st )
+{
+    m_state[h] = st;
+
+    uint32_t c = m_chainOf[h];
+
+    if( c != invalidHandle && !m_chains[c].touched )
+    {
+        m_chains[c].touched = true;
+        m_touched.push_back( c );
+    }
+}
+
+putState instCompiled::state( const instIOPut *put )
+{
+    return static_cast<putState>( stateOf( put->handle() ) );
+}
+
+beamState instCompiled::state( const instBeam *beam )
+{
+    return static_cast<beamState>( stateOf( beam->handle() ) );
+}
+
+bool instCompiled::enabled( const instIOPut *put )
+{
+    return m_enabled[put->handle()];
+}
+
+void instCompiled::state( const instIOPut *put, putState ns )
+{
+    uint32_t h = put->handle();
+    uint32_t c = m_chainOf[h];
+
+    if( c != invalidHandle && m_chains[c].compressed )
+    {
+        expand( c );
+    }
+
+    putChange( h, ns, false, false );
+
+    endEvent();
+}
+
+void instCompiled::enabled( const instIOPut *put, bool en )
+{
+    uint32_t h = put->handle();
+    uint32_t c = m_chainOf[h];
+
+    if( c != invalidHandle && m_chains[c].compressed )
+    {
+        expand( c );
+    }
+
+    m_enabled[h] = en;
+
+    // A chain with a disabled put can't be compressed, and one enabled again may be
+    if( c != invalidHandle )
+    {
+        store( h, m_state[h] );
+    }
+
+    endEvent();
+}
+
+void instCompiled::putChange( uint32_t h, putState ns, bool nobeam, bool byOutputLink )
+{
+    if( !m_enabled[h] && ns != putState::off )
+    {
+        return;
+    }
+
+    uint32_t beam = m_beamOf[h];
+
+    if( m_isInput[h] && ns == putState::on && beam != invalidHandle && stateOf( beam ) == beamOff )
+    {
+        ns = putState::waiting;
+    }
+
+    if( m_linked[h] && !byOutputLink && m_enabled[h] )
+    {
+        checkOutputLinks( h );
+        return;
+    }
+
+    store( h, static_cast<uint8_t>( ns ) );
+
+    if( m_isInput[h] )
+    {
+        for( uint32_t n = m_linkStart[h]; n < m_linkStart[h + 1]; ++n )
+        {
+            checkOutputLinks( m_links[n] );
+        }
+    }
+
+    if( beam != invalidHandle && !nobeam )
+    {
+        beamStateChange( beam );
+    }
+}
+
+void instCompiled::checkOutputLinks( uint32_t h )
+{
+    // The first output of a compressed chain passes the change straight to the end of the chain
+    uint32_t c = m_chainHead[h];
+
+    if( c != invalidHandle && m_chains[c].compressed )
+    {
+        jump( c, stateOf( m_chains[c].ins[0] ) );
+        return;
+    }
+
+    putState ps = putState::off;
+
+    for( uint32_t n = m_linkStart[h]; n < m_linkStart[h + 1]; ++n )
+    {
+        uint8_t ips = stateOf( m_links[n] );
+
+        if( ips == putOn )
+        {
+            ps = putState::on;
+        }
+        else if( ps == putState::off && ips == putWaiting )
+        {
+            ps = putState::waiting;
+        }
+    }
+
+    putChange( h, ps, false, true );
+}
+
+void instCompiled::beamStateChange( uint32_t h )
+{
+    uint32_t source = m_beamSource[h - m_nPuts];
+    uint32_t dest = m_beamDest[h - m_nPuts];
+
+    uint8_t bs = stateOf( h );
+
+    if( source == invalidHandle )
+    {
+        if( bs == beamOff )
+        {
+            return;
+        }
+
+        store( h, beamOff );
+
+        if( dest != invalidHandle && stateOf( dest ) == putOn )
+        {
+            putChange( dest, putState::waiting, true, false );
+        }
+
+        return;
+    }
+
+    uint8_t ss = stateOf( source );
+
+    if( dest == invalidHandle )
+    {
+        if( ss == putOn )
+        {
+            store( h, beamIntermediate );
+        }
+        else if( bs != beamOff )
+        {
+            store( h, beamOff );
+        }
+
+        return;
+    }
+
+    uint8_t ds = stateOf( dest );
+
+    if( ss == putOn )
+    {
+        if( ds == putOn || ds == putWaiting )
+        {
+            if( bs == beamOn )
+            {
+                return;
+            }
+
+            store( h, beamOn );
+            putChange( dest, putState::on, true, false );
+        }
+        else if( bs != beamIntermediate )
+        {
+            store( h, beamIntermediate );
+        }
+
+        return;
+    }
+
+    // The source is waiting or off
+    if( bs == beamOff )
+    {
+        return;
+    }
+
+    store( h, beamOff );
+
+    if( ds == putOn )
+    {
+        putChange( dest, putState::waiting, true, false );
+    }
+}
+
+void instCompiled::jump( uint32_t c, uint8_t v )
+{
+    chain &ch = m_chains[c];
+
+    // A lit chain stays lit while its entry is on, and a dark one stays dark until its entry turns on
+    if( ch.lit )
+    {
+        if( v == putOn )
+        {
+            return;
+        }
+
+        ch.out1 = v;
+        ch.lit = false;
+    }
+    else
+    {
+        ch.out1 = v;
+
+        if( v != putOn )
+        {
+            return;
+        }
+
+        ch.lit = true;
+    }
+
+    ++m_jumps;
+
+    uint32_t exitBeam = m_beamOf[ch.outs.back()];
+
+    if( exitBeam != invalidHandle )
+    {
+        beamStateChange( exitBeam );
+    }
+}
+
+void instCompiled::expand( uint32_t c )
+{
+    chain &ch = m_chains[c];
+
+    for( auto &&h : ch.outs )
+    {
+        m_state[h] = stateOf( h );
+    }
+
+    for( size_t i = 1; i < ch.ins.size(); ++i )
+    {
+        m_state[ch.ins[i]] = stateOf( ch.ins[i] );
+    }
+
+    for( auto &&h : ch.beams )
+    {
+        m_state[h] = stateOf( h );
+    }
+
+    ch.compressed = false;
+
+    if( !ch.touched )
+    {
+        ch.touched = true;
+        m_touched.push_back( c );
+    }
+}
+
+void instCompiled::tryCompress( uint32_t c )
+{
+    chain &ch = m_chains[c];
+
+    if( ch.compressed )
+    {
+        return;
+    }
+
+    bool lit = true;
+    bool dark = ( m_state[ch.outs[0]] != putOn );
+
+    for( size_t i = 0; i < ch.outs.size(); ++i )
+    {
+        uint32_t op = ch.outs[i];
+
+        if( !m_enabled[op] )
+        {
+            return;
+        }
+
+        lit = lit && m_state[op] == putOn;
+
+        if( i > 0 )
+        {
+            uint32_t ip = ch.ins[i];
+
+            if( !m_enabled[ip] )
+            {
+                return;
+            }
+
+            lit = lit && m_state[ip] == putOn && m_state[ch.beams[i - 1]] == beamOn;
+            dark = dark && m_state[op] == putWaiting && m_state[ip] == putWaiting
+                   && m_state[ch.beams[i - 1]] == beamOff;
+        }
+    }
+
+    if( !lit && !dark )
+    {
+        return;
+    }
+
+    ch.lit = lit;
+    ch.out1 = m_state[ch.outs[0]];
+    ch.compressed = true;
+}
+
+void instCompiled::endEvent()
+{
+    for( auto &&c : m_touched )
+    {
+        m_chains[c].touched = false;
+        tryCompress( c );
+    }
+
+    m_touched.clear();
+}
+
+size_t instCompiled::nChains() const
+{
+    return m_chains.size();
+}
+
+size_t instCompiled::nCompressed() const
+{
+    size_t n = 0;
+
+    for( auto &&ch : m_chains )
+    {
+        n += ch.compressed;
+    }
+
+    return n;
+}
+
+uint64_t instCompiled::jumps() const
+{
+    return m_jumps;
+}
+
+} // namespace ingr
@@ -0,0 +1,175 @@
+/** \file
+ *
+ * \brief A compiled evaluation of a graph, with chains of pass-through nodes collapsed
+ */
+
+#ifndef instCompiled_hpp
+#define instCompiled_hpp
+
+#include <cstdint>
+#include <vector>
+
+#include "basicTypes.hpp"
+
+namespace ingr
+{
+
+class instGraph;
+class instIOPut;
+class instBeam;
+
+/// A compiled evaluation of a graph's propagation, with chains of pass-through nodes collapsed
+/** The states and enabled flags of the puts and beams are copied into arrays indexed by handle, and state()
+ * and enabled() propagate changes through the arrays by the same rules as instIOPut::state,
+ * instBeam::stateChange and instNode::checkOutputLinks.  The graph itself is not changed.
+ *
+ * A pass-through node has exactly one input, linked to its only output.  A maximal run of two or more
+ * pass-through nodes joined by beams is a chain.  When every put in a chain is enabled, and its puts and
+ * beams are all lit, or are all dark with the inputs waiting, the chain is compressed: a change arriving at
+ * its first output jumps to its last output in one step, and the states inside the chain are not stored
+ * but derived from the chain when asked for.  Any change made directly to a put inside a compressed chain
+ * expands the chain first, and a chain is compressed again when a change leaves it uniform.
+ *
+ * Call compile() again after changing the topology of the graph.
+ *
+ * \ingroup explainer
+ */
+class instCompiled
+{
+  protected:
+    /// A chain of pass-through nodes
+    struct chain
+    {
+        std::vector<uint32_t> ins;   ///< The inputs, the first being the chain's entry which it does not own
+        std::vector<uint32_t> outs;  ///< The outputs
+        std::vector<uint32_t> beams; ///< The beams joining each output to the next input
+
+        bool compressed{ false };    ///< Whether the states are derived rather than stored
+        bool lit{ false };           ///< When compressed, whether the chain is lit
+        uint8_t out1{ 0 };           ///< When compressed, the state of the first output
+        bool touched{ false };       ///< Whether the chain was changed during the current event
+    };
+
+    instGraph *m_graph{ nullptr }; ///< The graph
+
+    uint32_t m_nPuts{ 0 };         ///< The number of puts, whose handles come first
+
+    std::vector<uint8_t> m_state;    ///< The state of each put and beam, by handle
+    std::vector<uint8_t> m_enabled;  ///< Whether each put is enabled
+    std::vector<uint8_t> m_isInput;  ///< Whether each put is an input
+    std::vector<uint8_t> m_linked;   ///< Whether each put is an output-linked output
+
+    std::vector<uint32_t> m_beamOf;     ///< The beam of each put, or invalidHandle
+    std::vector<uint32_t> m_beamSource; ///< The source of each beam, by beam handle less m_nPuts, or invalidHandle
+    std::vector<uint32_t> m_beamDest;   ///< The dest of each beam, by beam handle less m_nPuts, or invalidHandle
+
+    std::vector<uint32_t> m_linkStart;  ///< For each put, the start of its links in m_links
+    std::vector<uint32_t> m_links;      ///< The linked outputs of each input and the linked inputs of each output
+
+    std::vector<chain> m_chains;          ///< The chains
+    std::vector<uint32_t> m_chainOf;      ///< The chain owning each put or beam, or invalidHandle
+    std::vector<uint32_t> m_chainPos;     ///< The position of each owned put or beam in its chain's list
+    std::vector<uint32_t> m_chainHead;    ///< For each output, the chain it is the first output of, or invalidHandle
+
+    std::vector<uint32_t> m_touched;      ///< The chains changed during the current event
+
+    uint64_t m_jumps{ 0 };                ///< The number of changes which jumped across a chain
+
+  public:
+    /// Construct for a graph, compiling it
+    explicit instCompiled( instGraph &graph /**< [in] the graph, which must outlive the evaluation */ );
+
+    /// Compile the topology of the graph and load its states
+    /** Assigns handles in the graph.
+     */
+    void compile();
+
+    /// Load the states and enabled flags from the graph
+    void load();
+
+    /// Get the state of a put
+    /**
+     * \returns the state, derived from its chain if it is inside a compressed chain
+     */
+    putState state( const instIOPut *put /**< [in] the put */ );
+
+    /// Get the state of a beam
+    /**
+     * \returns the state, derived from its chain if it is inside a compressed chain
+     */
+    beamState state( const instBeam *beam /**< [in] the beam */ );
+
+    /// Get whether a put is enabled
+    /**
+     * \returns the enabled flag
+     */
+    bool enabled( const instIOPut *put /**< [in] the put */ );
+
+    /// Set the state of a put and propagate, as instIOPut::state
+    void state( const instIOPut *put, /**< [in] the put */
+                putState ns           /**< [in] the new state */
+    );
+
+    /// Set whether a put is enabled, as instIOPut::enabled
+    void enabled( const instIOPut *put, /**< [in] the put */
+                  bool en               /**< [in] the new enabled flag */
+    );
+
+    /// Get the number of chains
+    /**
+     * \returns the size of m_chains
+     */
+    size_t nChains() const;
+
+    /// Get the number of chains which are compressed
+    /**
+     * \returns the number of chains whose states are derived
+     */
+    size_t nCompressed() const;
+
+    /// Get the number of changes which jumped across a chain
+    /**
+     * \returns the current value of m_jumps
+     */
+    uint64_t jumps() const;
+
+  protected:
+    /// Get the state of a put or beam by handle, deriving it if in a compressed chain
+    uint8_t stateOf( uint32_t h /**< [in] the handle */ );
+
+    /// Store the state of a put or beam by handle, noting the chain as touched
+    void store( uint32_t h,  /**< [in] the handle */
+                uint8_t st   /**< [in] the state */
+    );
+
+    /// Propagate a put state change, as instIOPut::state
+    void putChange( uint32_t h,         /**< [in] the handle of the put */
+                    putState ns,        /**< [in] the new state */
+                    bool nobeam,        /**< [in] as for instIOPut::state */
+                    bool byOutputLink   /**< [in] as for instIOPut::state */
+    );
+
+    /// Recalculate an output from its linked inputs, as instNode::checkOutputLinks
+    void checkOutputLinks( uint32_t h /**< [in] the handle of the output */ );
+
+    /// Recalculate a beam, as instBeam::stateChange
+    void beamStateChange( uint32_t h /**< [in] the handle of the beam */ );
+
+    /// Apply a change of the entry of a compressed chain in one step
+    void jump( uint32_t c,   /**< [in] the chain */
+               uint8_t v     /**< [in] the state of the chain's entry input */
+    );
+
+    /// Store the derived states of a compressed chain so it can be changed step by step
+    void expand( uint32_t c /**< [in] the chain */ );
+
+    /// Compress a chain if it is uniform
+    void tryCompress( uint32_t c /**< [in] the chain */ );
+
+    /// Compress the chains touched by an event
+    void endEvent();
+};
+
+} // namespace ingr
+
+#endif // instCompiled_hpp
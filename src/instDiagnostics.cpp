@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "instDiagnostics.hpp"
+
+namespace ingr
+{
+
+instDiagnostics::instDiagnostics( severity level ) : m_level{ level }
+{
+}
+
+instDiagnostics::~instDiagnostics()
+{
+}
+
+severity instDiagnostics::level() const
+{
+    return m_level.load( std::memory_order_relaxed );
+}
+
+void instDiagnostics::level( severity lvl )
+{
+    m_level.store( lvl, std::memory_order_relaxed );
+}
+
+// The default global destination
+instDiagnostics *defaultDiagnostics()
+{
+    static streamDiagnostics diag( &std::cerr, severity::warning );
+
+    return &diag;
+}
+
+std::atomic<instDiagnostics *> g_diagnostics{ nullptr };
+
+instDiagnostics *globalDiagnostics()
+{
+    instDiagnostics *diag = g_diagnostics.load( std::memory_order_acquire );
+
+    if( diag == nullptr )
+    {
+        return defaultDiagnostics();
+    }
+
+    return diag;
+}
+
+void globalDiagnostics( instDiagnostics *diag )
+{
+    g_diagnostics.store( diag, std::memory_order_release );
+}
+
+streamDiagnostics::streamDiagnostics( std::ostream *os, severity level ) : instDiagnostics( level ), m_os{ os }
+{
+    if( m_os == nullptr )
+    {
+        throw std::invalid_argument( "streamDiagnostics: stream is null" );
+    }
+}
+
+void streamDiagnostics::report( const diagnostic &d )
+{
+    std::string line = d.source;
+    line += ": " + severity2String( d.level ) + ": " + d.message;
+
+    if( d.count > 0 )
+    {
+        line += " [" + std::to_string( d.count ) + "]";
+    }
+
+    if( d.line > 0 )
+    {
+        line += " (line " + std::to_string( d.line ) + ", column " + std::to_string( d.column ) + ")";
+    }
+
+    line += '\n';
+
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_os->write( line.data(), line.size() );
+}
+
+ringDiagnostics::ringDiagnostics( size_t capacity, severity level ) : instDiagnostics( level )
+{
+    size_t cap = 1;
+    while( cap < capacity )
+    {
+        cap <<= 1;
+    }
+
+    m_slots.reset( new slot[cap] );
+    m_mask = cap - 1;
+
+    for( size_t n = 0; n < cap; ++n )
+    {
+        m_slots[n].sequence.store( n, std::memory_order_relaxed );
+    }
+}
+
+void ringDiagnostics::report( const diagnostic &d )
+{
+    uint64_t n = m_head.load( std::memory_order_relaxed );
+    slot *s;
+
+    for( ;; )
+    {
+        s = &m_slots[n & m_mask];
+
+        int64_t dif = static_cast<int64_t>( s->sequence.load( std::memory_order_acquire ) - n );
+
+        if( dif == 0 )
+        {
+            // The slot is free for record n, try to claim it
+            if( m_head.compare_exchange_weak( n, n + 1, std::memory_order_relaxed ) )
+            {
+                break;
+            }
+        }
+        else if( dif < 0 )
+        {
+            // The slot still holds the record from the previous lap, so the buffer is full
+            m_dropped.fetch_add( 1, std::memory_order_relaxed );
+            return;
+        }
+        else
+        {
+            n = m_head.load( std::memory_order_relaxed );
+        }
+    }
+
+    s->level = d.level;
+    s->source = d.source;
+    s->line = d.line;
+    s->column = d.column;
+    s->count = d.count;
+    s->length = std::min( d.message.size(), maxMessage );
+    memcpy( s->message, d.message.data(), s->length );
+
+    s->sequence.store( n + 1, std::memory_order_release );
+}
+
+size_t ringDiagnostics::drain( std::vector<diagnostic> &out )
+{
+    size_t nd = 0;
+
+    for( ;; )
+    {
+        slot &s = m_slots[m_tail & m_mask];
+
+        if( s.sequence.load( std::memory_order_acquire ) != m_tail + 1 )
+        {
+            break; // empty, or not yet complete
+        }
+
+        diagnostic d;
+        d.level = s.level;
+        d.source = s.source;
+        d.line = s.line;
+        d.column = s.column;
+        d.count = s.count;
+        d.message.assign( s.message, s.length );
+        out.push_back( std::move( d ) );
+        ++nd;
+
+        // Free the slot for the record one lap ahead
+        s.sequence.store( m_tail + m_mask + 1, std::memory_order_release );
+        ++m_tail;
+    }
+
+    return nd;
+}
+
+uint64_t ringDiagnostics::dropped() const
+{
+    return m_dropped.load( std::memory_order_relaxed );
+}
+
+} // namespace ingr
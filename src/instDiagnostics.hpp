@@ -0,0 +1,228 @@
+/** \file
+ *
+ * \brief Reporting of errors, warnings, and other diagnostics
+ */
+
+#ifndef instDiagnostics_hpp
+#define instDiagnostics_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ingr
+{
+
+/// The severity of a diagnostic, in increasing order
+/** \ingroup basic_types
+ */
+enum class severity
+{
+    debug,   ///< Detail only useful when debugging
+    info,    ///< Normal events, such as the counts of entities loaded
+    warning, ///< Something was ignored or is suspect, but processing continued
+    error    ///< Processing failed
+};
+
+/// Get a string representation of a severity
+/**
+ * \returns a string with value "debug", "info", "warning", or "error"
+ */
+inline std::string severity2String( severity sev /**< [in] the severity */ )
+{
+    if( sev == severity::debug )
+        return "debug";
+    else if( sev == severity::info )
+        return "info";
+    else if( sev == severity::warning )
+        return "warning";
+    else if( sev == severity::error )
+        return "error";
+    else
+        return "unknown";
+}
+
+/// A single diagnostic
+/**
+ * \ingroup explainer
+ */
+struct diagnostic
+{
+    severity level{ severity::info }; ///< The severity
+
+    const char *source{ "" };         ///< The reporting component, e.g. "instGraphTOML".  Must have static storage.
+
+    uint32_t line{ 0 };               ///< The line in the input being parsed, 0 if not applicable
+
+    uint32_t column{ 0 };             ///< The column in the input being parsed, 0 if not applicable
+
+    uint64_t count{ 0 };              ///< A count associated with the diagnostic, e.g. of entities loaded
+
+    std::string message;              ///< The message
+};
+
+/// Interface for a destination of diagnostics
+/** Diagnostics below the level are discarded.  Use the templated report() so that the message is only
+ * formatted if the level is enabled, which makes disabled levels cost a single comparison.
+ *
+ * \ingroup explainer
+ */
+class instDiagnostics
+{
+  protected:
+    std::atomic<severity> m_level{ severity::warning }; ///< The minimum severity reported
+
+  public:
+    /// Construct with the level set
+    explicit instDiagnostics( severity level = severity::warning /**< [in] [optional] the minimum severity */ );
+
+    virtual ~instDiagnostics();
+
+    /// Get the minimum severity reported
+    /**
+     * \returns the current value of m_level
+     */
+    severity level() const;
+
+    /// Set the minimum severity reported
+    void level( severity lvl /**< [in] the new minimum severity */ );
+
+    /// Check if a severity will be reported
+    /**
+     * \returns true if \p sev is at or above the level
+     * \returns false otherwise
+     */
+    bool enabled( severity sev /**< [in] the severity to check */ ) const
+    {
+        return sev >= m_level.load( std::memory_order_relaxed );
+    }
+
+    /// Report a diagnostic.  The level has already been checked.
+    virtual void report( const diagnostic &d /**< [in] the diagnostic */ ) = 0;
+
+    /// Report a diagnostic, calling \p format to create the message only if \p sev is enabled
+    template <typename formatT>
+    void report( severity sev,          /**< [in] the severity */
+                 const char *source,    /**< [in] the reporting component, must have static storage */
+                 uint32_t line,         /**< [in] the line in the input, 0 if not applicable */
+                 uint32_t column,       /**< [in] the column in the input, 0 if not applicable */
+                 uint64_t count,        /**< [in] a count associated with the diagnostic, or 0 */
+                 formatT &&format       /**< [in] callable returning the message as a std::string */
+    )
+    {
+        if( !enabled( sev ) )
+        {
+            return;
+        }
+
+        report( diagnostic{ sev, source, line, column, count, format() } );
+    }
+};
+
+/// Get the global diagnostics destination
+/** This is used by anything without its own destination.  The default writes warnings and errors to
+ * std::cerr.
+ *
+ * \returns the current global destination, never nullptr
+ */
+instDiagnostics *globalDiagnostics();
+
+/// Set the global diagnostics destination
+void globalDiagnostics( instDiagnostics *diag /**< [in] the new destination, not owned.  nullptr restores the default. */ );
+
+/// Diagnostics destination which formats each diagnostic as a line on a stream
+/** Lines are formatted as `source: severity: message [count] (line L, column C)`, where the count and the
+ * position are only included if non-zero.
+ *
+ * \ingroup explainer
+ */
+class streamDiagnostics : public instDiagnostics
+{
+  protected:
+    std::ostream *m_os{ nullptr }; ///< The stream, not owned
+
+    std::mutex m_mutex;            ///< Serializes writes to the stream
+
+  public:
+    /// Construct with the stream and level
+    explicit streamDiagnostics( std::ostream *os,                     /**< [in] the stream, must outlive this */
+                                severity level = severity::warning    /**< [in] [optional] the minimum severity */
+    );
+
+    using instDiagnostics::report;
+
+    virtual void report( const diagnostic &d );
+};
+
+/// Diagnostics destination which stores fixed-size records in a lock-free ring buffer
+/** Any number of threads can report without blocking: a report claims a slot with a compare-and-swap and
+ * never waits on another thread.  If the buffer is full the new record is dropped and counted.  Messages
+ * longer than \ref maxMessage are truncated.  A single consumer retrieves records with drain().
+ *
+ * \ingroup explainer
+ */
+class ringDiagnostics : public instDiagnostics
+{
+  public:
+    /// The maximum length of a stored message
+    static constexpr size_t maxMessage = 111;
+
+  protected:
+    /// A record in the ring buffer
+    struct slot
+    {
+        /// Equal to the record number when free for it to be written, and the record number + 1 once written.
+        std::atomic<uint64_t> sequence{ 0 };
+
+        severity level;
+        const char *source;
+        uint32_t line;
+        uint32_t column;
+        uint64_t count;
+        uint8_t length;
+        char message[maxMessage];
+    };
+
+    std::unique_ptr<slot[]> m_slots;      ///< The ring buffer
+
+    size_t m_mask{ 0 };                   ///< The capacity minus 1, the capacity being a power of 2
+
+    std::atomic<uint64_t> m_head{ 0 };    ///< The next record number to be written
+
+    uint64_t m_tail{ 0 };                 ///< The next record number to drain
+
+    std::atomic<uint64_t> m_dropped{ 0 }; ///< The number of records dropped because the buffer was full
+
+  public:
+    /// Construct with the capacity and level
+    explicit ringDiagnostics( size_t capacity,                    /**< [in] the number of records, rounded up to a
+                                                                           power of 2 */
+                              severity level = severity::warning  /**< [in] [optional] the minimum severity */
+    );
+
+    using instDiagnostics::report;
+
+    virtual void report( const diagnostic &d );
+
+    /// Move the completed records into a vector, in the order they were claimed
+    /** Only one thread may drain at a time.  A record still being written stops the drain, and is
+     * returned by the next one.
+     *
+     * \returns the number of records appended to \p out
+     */
+    size_t drain( std::vector<diagnostic> &out /**< [out] the records are appended to this vector */ );
+
+    /// Get the number of records dropped because the buffer was full
+    /**
+     * \returns the current value of m_dropped
+     */
+    uint64_t dropped() const;
+};
+
+} // namespace ingr
+
+#endif // instDiagnostics_hpp
@@ -0,0 +1,351 @@
+#include <algorithm>
+
+#include "instDominators.hpp"
+#include "instGraph.hpp"
+
+namespace ingr
+{
+
+instDominators::instDominators( instGraph &graph ) : m_graph{ &graph }
+{
+    compile();
+}
+
+void instDominators::compile()
+{
+    size_t nHandles = m_graph->assignHandles();
+
+    m_nPuts = 0;
+    while( m_nPuts < nHandles && m_graph->handlePut( m_nPuts ) != nullptr )
+    {
+        ++m_nPuts;
+    }
+
+    m_puts.resize( m_nPuts );
+    for( uint32_t h = 0; h < m_nPuts; ++h )
+    {
+        m_puts[h] = m_graph->handlePut( h );
+    }
+
+    m_nVerts = nHandles + 1;
+    uint32_t root = m_nVerts - 1;
+
+    m_edgeFrom.clear();
+    m_edgeTo.clear();
+
+    auto addEdge = [this]( uint32_t from, uint32_t to )
+    {
+        m_edgeFrom.push_back( from );
+        m_edgeTo.push_back( to );
+    };
+
+    for( uint32_t h = 0; h < m_nPuts; ++h )
+    {
+        instIOPut *put = m_puts[h];
+
+        if( put->io() == ioDir::output )
+        {
+            if( !put->outputLinked() )
+            {
+                addEdge( root, h );
+            }
+
+            if( put->beamValid() )
+            {
+                addEdge( h, put->beam()->handle() );
+            }
+        }
+        else
+        {
+            if( !put->beamValid() )
+            {
+                addEdge( root, h );
+            }
+
+            if( put->nodeValid() )
+            {
+                for( auto &&ol : put->outputLinks() )
+                {
+                    if( put->node()->outputValid( ol ) )
+                    {
+                        addEdge( h, put->node()->output( ol )->handle() );
+                    }
+                }
+            }
+        }
+    }
+
+    for( uint32_t h = m_nPuts; h < nHandles; ++h )
+    {
+        instBeam *beam = m_graph->handleBeam( h );
+
+        if( beam->destValid() )
+        {
+            addEdge( h, beam->dest()->handle() );
+        }
+    }
+
+    m_valid = false;
+}
+
+void instDominators::invalidate()
+{
+    m_valid = false;
+}
+
+void instDominators::update()
+{
+    if( m_valid && m_enabledGen == m_graph->enabledGeneration() )
+    {
+        return;
+    }
+
+    compute();
+}
+
+void instDominators::compute()
+{
+    uint32_t n = m_nVerts;
+    uint32_t root = n - 1;
+
+    m_enabledGen = m_graph->enabledGeneration();
+
+    m_enabled.resize( m_nPuts );
+    for( uint32_t h = 0; h < m_nPuts; ++h )
+    {
+        m_enabled[h] = m_puts[h]->enabled();
+    }
+
+    // Build the successor and predecessor lists, leaving out disabled puts
+    m_succStart.assign( n + 1, 0 );
+    m_predStart.assign( n + 1, 0 );
+
+    auto live = [this, root]( uint32_t v ) { return v == root || v >= m_nPuts || m_enabled[v]; };
+
+    for( size_t e = 0; e < m_edgeFrom.size(); ++e )
+    {
+        if( live( m_edgeFrom[e] ) && live( m_edgeTo[e] ) )
+        {
+            ++m_succStart[m_edgeFrom[e] + 1];
+            ++m_predStart[m_edgeTo[e] + 1];
+        }
+    }
+
+    for( uint32_t v = 0; v < n; ++v )
+    {
+        m_succStart[v + 1] += m_succStart[v];
+        m_predStart[v + 1] += m_predStart[v];
+    }
+
+    m_succ.resize( m_succStart[n] );
+    m_pred.resize( m_predStart[n] );
+
+    // Fill using the starts of the next vertex as cursors, then shift them back
+    for( size_t e = 0; e < m_edgeFrom.size(); ++e )
+    {
+        if( live( m_edgeFrom[e] ) && live( m_edgeTo[e] ) )
+        {
+            m_succ[m_succStart[m_edgeFrom[e]]++] = m_edgeTo[e];
+            m_pred[m_predStart[m_edgeTo[e]]++] = m_edgeFrom[e];
+        }
+    }
+
+    for( uint32_t v = n; v > 0; --v )
+    {
+        m_succStart[v] = m_succStart[v - 1];
+        m_predStart[v] = m_predStart[v - 1];
+    }
+    m_succStart[0] = 0;
+    m_predStart[0] = 0;
+
+    m_semi.assign( n, -1 );
+    m_vertex.assign( n, 0 );
+    m_parent.assign( n, invalidHandle );
+    m_ancestor.assign( n, invalidHandle );
+    m_label.assign( n, 0 );
+    m_idom.assign( n, invalidHandle );
+    m_bucketHead.assign( n, invalidHandle );
+    m_bucketNext.assign( n, invalidHandle );
+
+    // Number the vertices in depth-first order from the root
+    std::vector<uint32_t> next( n, 0 ); // the next successor to visit of each vertex on the stack
+
+    int32_t nReached = 0;
+
+    m_stack.clear();
+    m_stack.push_back( root );
+    m_semi[root] = nReached;
+    m_vertex[nReached++] = root;
+    m_label[root] = root;
+    next[root] = m_succStart[root];
+
+    while( !m_stack.empty() )
+    {
+        uint32_t v = m_stack.back();
+
+        if( next[v] == m_succStart[v + 1] )
+        {
+            m_stack.pop_back();
+            continue;
+        }
+
+        uint32_t w = m_succ[next[v]++];
+
+        if( m_semi[w] == -1 )
+        {
+            m_parent[w] = v;
+            m_semi[w] = nReached;
+            m_vertex[nReached++] = w;
+            m_label[w] = w;
+            next[w] = m_succStart[w];
+            m_stack.push_back( w );
+        }
+    }
+
+    // Semidominators in reverse order, with the implicit immediate dominators
+    for( int32_t i = nReached - 1; i > 0; --i )
+    {
+        uint32_t w = m_vertex[i];
+
+        for( uint32_t p = m_predStart[w]; p < m_predStart[w + 1]; ++p )
+        {
+            uint32_t v = m_pred[p];
+
+            if( m_semi[v] == -1 )
+            {
+                continue;
+            }
+
+            uint32_t u = eval( v );
+            if( m_semi[u] < m_semi[w] )
+            {
+                m_semi[w] = m_semi[u];
+            }
+        }
+
+        uint32_t s = m_vertex[m_semi[w]];
+        m_bucketNext[w] = m_bucketHead[s];
+        m_bucketHead[s] = w;
+
+        uint32_t pw = m_parent[w];
+        m_ancestor[w] = pw;
+
+        for( uint32_t v = m_bucketHead[pw]; v != invalidHandle; v = m_bucketNext[v] )
+        {
+            uint32_t u = eval( v );
+            m_idom[v] = ( m_semi[u] < m_semi[v] ) ? u : pw;
+        }
+        m_bucketHead[pw] = invalidHandle;
+    }
+
+    // Make the implicit immediate dominators explicit
+    for( int32_t i = 1; i < nReached; ++i )
+    {
+        uint32_t w = m_vertex[i];
+
+        if( m_idom[w] != m_vertex[m_semi[w]] )
+        {
+            m_idom[w] = m_idom[m_idom[w]];
+        }
+    }
+
+    m_idom[root] = root;
+
+    m_valid = true;
+}
+
+uint32_t instDominators::eval( uint32_t v )
+{
+    if( m_ancestor[v] == invalidHandle )
+    {
+        return v;
+    }
+
+    // Compress the path, starting nearest the root
+    m_stack.clear();
+    uint32_t x = v;
+    while( m_ancestor[m_ancestor[x]] != invalidHandle )
+    {
+        m_stack.push_back( x );
+        x = m_ancestor[x];
+    }
+
+    while( !m_stack.empty() )
+    {
+        uint32_t y = m_stack.back();
+        m_stack.pop_back();
+
+        uint32_t a = m_ancestor[y];
+        if( m_semi[m_label[a]] < m_semi[m_label[y]] )
+        {
+            m_label[y] = m_label[a];
+        }
+        m_ancestor[y] = m_ancestor[a];
+    }
+
+    return m_label[v];
+}
+
+uint32_t instDominators::idom( uint32_t h )
+{
+    update();
+
+    if( h + 1 >= m_nVerts || m_idom[h] == m_nVerts - 1 )
+    {
+        return invalidHandle;
+    }
+
+    return m_idom[h];
+}
+
+bool instDominators::walk( criticalDeps &deps, uint32_t h )
+{
+    deps.puts.clear();
+    deps.beams.clear();
+    deps.nodes.clear();
+
+    update();
+
+    if( h + 1 >= m_nVerts || m_idom[h] == invalidHandle )
+    {
+        return false;
+    }
+
+    uint32_t root = m_nVerts - 1;
+
+    for( uint32_t d = m_idom[h]; d != root; d = m_idom[d] )
+    {
+        if( d < m_nPuts )
+        {
+            instIOPut *put = m_puts[d];
+            deps.puts.push_back( put );
+
+            if( put->nodeValid() && std::find( deps.nodes.begin(), deps.nodes.end(), put->node() ) == deps.nodes.end() )
+            {
+                deps.nodes.push_back( put->node() );
+            }
+        }
+        else
+        {
+            deps.beams.push_back( m_graph->handleBeam( d ) );
+        }
+    }
+
+    std::reverse( deps.puts.begin(), deps.puts.end() );
+    std::reverse( deps.beams.begin(), deps.beams.end() );
+    std::reverse( deps.nodes.begin(), deps.nodes.end() );
+
+    return true;
+}
+
+bool instDominators::critical( criticalDeps &deps, instBeam *beam )
+{
+    return walk( deps, beam->handle() );
+}
+
+bool instDominators::critical( criticalDeps &deps, instIOPut *put )
+{
+    return walk( deps, put->handle() );
+}
+
+} // namespace ingr
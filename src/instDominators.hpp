@@ -0,0 +1,132 @@
+/** \file
+ *
+ * \brief Single points of failure of the light paths, from dominator trees
+ */
+
+#ifndef instDominators_hpp
+#define instDominators_hpp
+
+#include <cstdint>
+#include <vector>
+
+#include "basicTypes.hpp"
+
+namespace ingr
+{
+
+class instGraph;
+class instNode;
+class instIOPut;
+class instBeam;
+
+/// The puts, beams, and nodes which every light path to a beam passes through
+/**
+ * \ingroup explainer
+ */
+struct criticalDeps
+{
+    std::vector<instIOPut *> puts;  ///< The critical puts, from the source towards the beam
+    std::vector<instBeam *> beams;  ///< The critical beams upstream of the beam, from the source towards the beam
+    std::vector<instNode *> nodes;  ///< The nodes of the critical puts, from the source towards the beam
+};
+
+/// Dominator analysis of the light paths of a graph
+/** The puts and beams of the graph, as handles, form a flow graph: a virtual root feeds every put which can
+ * be turned on directly, so outputs which are not output-linked and inputs without beams, an output feeds
+ * its beam, a beam feeds its dest, and an input feeds its linked outputs.  Disabled puts carry no light and
+ * are left out.  The dominator tree from the root is computed with the Lengauer-Tarjan algorithm, so an
+ * entity's dominators are the puts and beams which every light path to it passes through, and losing any
+ * of them loses it.
+ *
+ * The tree is recomputed lazily: a query first compares the graph's enabled generation with the one the tree
+ * was computed for, so a query with no enabled changes since the last is constant time.  Call compile() after
+ * changing the topology.
+ *
+ * A node is reported as critical if one of its puts is.  A node whose puts are only critical together, as
+ * when light splits within the node and rejoins, is not.
+ *
+ * \ingroup explainer
+ */
+class instDominators
+{
+  protected:
+    instGraph *m_graph{ nullptr }; ///< The graph
+
+    uint32_t m_nPuts{ 0 };            ///< The number of puts, whose handles come first
+    uint32_t m_nVerts{ 0 };           ///< The number of vertices, the handles plus the root
+
+    std::vector<instIOPut *> m_puts;  ///< The puts, indexed by handle
+
+    std::vector<uint32_t> m_edgeFrom; ///< The source handle of each edge, m_nVerts - 1 for the root
+    std::vector<uint32_t> m_edgeTo;   ///< The dest handle of each edge
+
+    std::vector<uint8_t> m_enabled;   ///< The enabled flags of the puts the tree was computed for
+    uint64_t m_enabledGen{ 0 };       ///< The enabled generation of the graph the tree was computed for
+
+    bool m_valid{ false };            ///< Whether the tree is up to date with the topology
+
+    std::vector<uint32_t> m_succStart, m_succ; ///< Successors of each vertex, compressed
+    std::vector<uint32_t> m_predStart, m_pred; ///< Predecessors of each vertex, compressed
+
+    std::vector<uint32_t> m_idom;     ///< The immediate dominator of each vertex, invalidHandle if unreachable
+
+    // Lengauer-Tarjan working space, kept to avoid reallocating
+    std::vector<int32_t> m_semi;
+    std::vector<uint32_t> m_vertex, m_parent, m_ancestor, m_label, m_bucketHead, m_bucketNext, m_stack;
+
+  public:
+    /// Construct for a graph, compiling its topology
+    explicit instDominators( instGraph &graph /**< [in] the graph, which must outlive the analysis */ );
+
+    /// Compile the topology of the graph
+    /** Assigns handles in the graph.  The tree is recomputed at the next query.
+     */
+    void compile();
+
+    /// Force the tree to be recomputed at the next query
+    void invalidate();
+
+    /// Get the immediate dominator of a put or beam
+    /**
+     * \returns the handle of the immediate dominator, or invalidHandle if the entity is not reachable or is
+     *          only dominated by the root
+     */
+    uint32_t idom( uint32_t h /**< [in] the handle of the put or beam */ );
+
+    /// Get the critical dependencies of a beam
+    /**
+     * \returns true if light can reach the beam, with its dependencies in \p deps
+     * \returns false if light can not reach the beam, with \p deps empty
+     */
+    bool critical( criticalDeps &deps, /**< [out] the critical dependencies */
+                   instBeam *beam      /**< [in] the beam */
+    );
+
+    /// Get the critical dependencies of a put
+    /**
+     * \returns true if light can reach the put, with its dependencies, not including itself, in \p deps
+     * \returns false if light can not reach the put, with \p deps empty
+     */
+    bool critical( criticalDeps &deps, /**< [out] the critical dependencies */
+                   instIOPut *put      /**< [in] the put */
+    );
+
+  protected:
+    /// Recompute the tree if the enabled flags have changed or it was invalidated
+    void update();
+
+    /// Compute the dominator tree
+    void compute();
+
+    /// Find the vertex with minimum semidominator on the forest path to \p v, compressing the path
+    uint32_t eval( uint32_t v /**< [in] the vertex */ );
+
+    /// Fill \p deps by walking up the tree from a handle
+    bool walk( criticalDeps &deps, /**< [out] the critical dependencies */
+               uint32_t h          /**< [in] the handle */
+    );
+};
+
+} // namespace ingr
+
+#endif // instDominators_hpp
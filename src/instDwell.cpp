@@ -0,0 +1,189 @@
+#include <algorithm>
+
+#include "instDwell.hpp"
+#include "instGraph.hpp"
+
+namespace ingr
+{
+
+void instDwell::start( instGraph &graph, uint64_t now, uint64_t bucketWidth, size_t nBuckets )
+{
+    stop();
+
+    graph.assignHandles();
+
+    m_entries.resize( graph.nHandles() );
+
+    if( bucketWidth > 0 && nBuckets > 0 )
+    {
+        m_bucketWidth = bucketWidth;
+        m_nBuckets = nBuckets;
+        m_buckets.assign( m_entries.size() * m_nBuckets, {} );
+    }
+
+    for( uint32_t h = 0; h < m_entries.size(); ++h )
+    {
+        entry &e = m_entries[h];
+
+        if( instIOPut *put = graph.handlePut( h ) )
+        {
+            e.state = static_cast<uint8_t>( put->state() );
+        }
+        else
+        {
+            e.state = static_cast<uint8_t>( graph.handleBeam( h )->state() );
+        }
+
+        e.since = now;
+        e.lastBucket = m_bucketWidth > 0 ? now / m_bucketWidth : 0;
+    }
+
+    m_start = now;
+    m_active = true;
+}
+
+void instDwell::stop()
+{
+    m_active = false;
+
+    m_entries.clear();
+    m_entries.shrink_to_fit();
+    m_buckets.clear();
+    m_buckets.shrink_to_fit();
+
+    m_bucketWidth = 0;
+    m_nBuckets = 0;
+}
+
+uint64_t instDwell::startTime() const
+{
+    return m_start;
+}
+
+void instDwell::addToBuckets( uint32_t h, uint64_t t0, uint64_t t1 )
+{
+    entry &e = m_entries[h];
+    std::array<uint64_t, 3> *buckets = &m_buckets[h * m_nBuckets];
+
+    uint64_t last = ( t1 - 1 ) / m_bucketWidth;
+
+    // Clear the buckets being reused, at most all of them
+    if( last > e.lastBucket )
+    {
+        uint64_t b = std::max( e.lastBucket + 1, last + 1 >= m_nBuckets ? last + 1 - m_nBuckets : 0 );
+
+        for( ; b <= last; ++b )
+        {
+            buckets[b % m_nBuckets] = {};
+        }
+
+        e.lastBucket = last;
+    }
+
+    // Only the time in the buckets kept matters
+    if( last + 1 >= m_nBuckets )
+    {
+        t0 = std::max( t0, ( last + 1 - m_nBuckets ) * m_bucketWidth );
+    }
+
+    while( t0 < t1 )
+    {
+        uint64_t b = t0 / m_bucketWidth;
+        uint64_t end = std::min( t1, ( b + 1 ) * m_bucketWidth );
+
+        buckets[b % m_nBuckets][e.state] += end - t0;
+
+        t0 = end;
+    }
+}
+
+void instDwell::transition( uint32_t h, int to, uint64_t time )
+{
+    if( !m_active || h >= m_entries.size() )
+    {
+        return;
+    }
+
+    entry &e = m_entries[h];
+
+    if( time > e.since )
+    {
+        e.total[e.state] += time - e.since;
+
+        if( m_bucketWidth > 0 )
+        {
+            addToBuckets( h, e.since, time );
+        }
+
+        e.since = time;
+    }
+
+    e.state = to;
+}
+
+dwellStats instDwell::stats( uint32_t h, uint64_t now ) const
+{
+    dwellStats ds;
+
+    if( h >= m_entries.size() )
+    {
+        return ds;
+    }
+
+    const entry &e = m_entries[h];
+
+    ds.time = e.total;
+
+    if( now > e.since )
+    {
+        ds.time[e.state] += now - e.since;
+    }
+
+    return ds;
+}
+
+dwellStats instDwell::window( uint32_t h, uint64_t now, size_t n ) const
+{
+    dwellStats ds;
+
+    if( h >= m_entries.size() || m_bucketWidth == 0 )
+    {
+        return ds;
+    }
+
+    const entry &e = m_entries[h];
+    const std::array<uint64_t, 3> *buckets = &m_buckets[h * m_nBuckets];
+
+    n = std::min( n, m_nBuckets );
+
+    uint64_t current = now / m_bucketWidth;
+    uint64_t first = current + 1 >= n ? current + 1 - n : 0;
+
+    // Buckets after lastBucket have not been written, and those before its window have been reused
+    for( uint64_t b = first; b <= current; ++b )
+    {
+        if( b <= e.lastBucket && b + m_nBuckets > e.lastBucket )
+        {
+            for( size_t s = 0; s < 3; ++s )
+            {
+                ds.time[s] += buckets[b % m_nBuckets][s];
+            }
+        }
+    }
+
+    // The time since the last transition is not in the buckets yet
+    uint64_t t0 = std::max( e.since, first * m_bucketWidth );
+    if( now > t0 )
+    {
+        ds.time[e.state] += now - t0;
+    }
+
+    return ds;
+}
+
+double instDwell::dutyCycle( uint32_t h, uint64_t now ) const
+{
+    return stats( h, now ).fraction( static_cast<int>( putState::on ) );
+}
+
+} // namespace ingr
@@ -0,0 +1,153 @@
+/** \file
+ *
+ * \brief Time spent in each state by puts and beams, cumulative and over sliding windows
+ */
+
+#ifndef instDwell_hpp
+#define instDwell_hpp
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "basicTypes.hpp"
+
+namespace ingr
+{
+
+class instGraph;
+
+/// The time an entity spent in each state over an interval
+/** States are indexed by their value: putState off, waiting, on for puts, and beamState off, intermediate,
+ * on for beams.
+ *
+ * \ingroup explainer
+ */
+struct dwellStats
+{
+    std::array<uint64_t, 3> time{}; ///< The ns spent in each state
+
+    /// Get the total time covered
+    /**
+     * \returns the sum of the times, in ns
+     */
+    uint64_t total() const
+    {
+        return time[0] + time[1] + time[2];
+    }
+
+    /// Get the fraction of the time spent in a state
+    /**
+     * \returns the fraction from 0 to 1, or 0 if no time is covered
+     */
+    double fraction( int state /**< [in] the state, as the value of a putState or beamState */ ) const
+    {
+        uint64_t tot = total();
+
+        return tot > 0 ? static_cast<double>( time[state] ) / tot : 0.0;
+    }
+};
+
+/// Cumulative and windowed time-in-state for every put and beam of a graph
+/** Started with start(), after which the graph reports each transition with transition(), at constant cost
+ * per call.  The cumulative time in each state is kept since start().  If a window is configured, the time
+ * in each state is also kept per bucket of a fixed width, for the most recent buckets, so the time in each
+ * state over the last N buckets can be queried.
+ *
+ * Times are ns since the Unix epoch, as from journalTime().  Entities are identified by the handles
+ * assigned by instGraph::assignHandles.  Must only be used from the thread which changes the graph.
+ *
+ * \ingroup explainer
+ */
+class instDwell
+{
+  protected:
+    /// The accounting for one entity
+    struct entry
+    {
+        uint64_t since{ 0 };              ///< The time of the last transition, or of start()
+        uint8_t state{ 0 };               ///< The current state
+        std::array<uint64_t, 3> total{};  ///< The time in each state up to since
+        uint64_t lastBucket{ 0 };         ///< The absolute number of the last bucket written
+    };
+
+    bool m_active{ false };              ///< Whether accounting is running
+
+    uint64_t m_start{ 0 };               ///< The time of start()
+
+    std::vector<entry> m_entries;        ///< Indexed by handle
+
+    uint64_t m_bucketWidth{ 0 };         ///< The width of a window bucket in ns, 0 if there are no windows
+
+    size_t m_nBuckets{ 0 };              ///< The number of buckets kept for each entity
+
+    std::vector<std::array<uint64_t, 3>> m_buckets; ///< The buckets, m_nBuckets per entity, by absolute number modulo m_nBuckets
+
+    /// Add the time from \p t0 to \p t1 in the current state of an entity to its window buckets
+    void addToBuckets( uint32_t h, uint64_t t0, uint64_t t1 );
+
+  public:
+    /// Start accounting
+    /** Assigns handles in the graph, and takes the current state of each put and beam as the state it has
+     * been in since \p now.
+     */
+    void start( instGraph &graph,            /**< [in] the graph */
+                uint64_t now,                /**< [in] the current time */
+                uint64_t bucketWidth = 0,    /**< [in] [optional] the width of a window bucket in ns, 0 for none */
+                size_t nBuckets = 0          /**< [in] [optional] the number of buckets kept */
+    );
+
+    /// Stop accounting and release the memory
+    void stop();
+
+    /// Check if accounting is running
+    /**
+     * \returns the current value of m_active
+     */
+    bool active() const
+    {
+        return m_active;
+    }
+
+    /// Get the time accounting started
+    /**
+     * \returns the current value of m_start
+     */
+    uint64_t startTime() const;
+
+    /// Account for a transition.  Called by the graph.
+    void transition( uint32_t h,    /**< [in] the handle of the entity */
+                     int to,        /**< [in] the new state */
+                     uint64_t time  /**< [in] the time of the transition */
+    );
+
+    /// Get the time in each state since start()
+    /**
+     * \returns the times, or all zero if \p h is not a valid handle
+     */
+    dwellStats stats( uint32_t h,    /**< [in] the handle of the entity */
+                      uint64_t now   /**< [in] the current time */
+    ) const;
+
+    /// Get the time in each state over the last \p n window buckets, including the current partial one
+    /** The window is clipped to the time since start().
+     *
+     * \returns the times, or all zero if \p h is not a valid handle or there are no windows
+     */
+    dwellStats window( uint32_t h,    /**< [in] the handle of the entity */
+                       uint64_t now,  /**< [in] the current time */
+                       size_t n       /**< [in] the number of buckets, at most the number kept */
+    ) const;
+
+    /// Get the fraction of the time since start() that an entity was on
+    /**
+     * \returns the fraction from 0 to 1
+     */
+    double dutyCycle( uint32_t h,    /**< [in] the handle of the entity */
+                      uint64_t now   /**< [in] the current time */
+    ) const;
+};
+
+} // namespace ingr
+
+#endif // instDwell_hpp
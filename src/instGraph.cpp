@@ -1,15 +1,8 @@
 
-#include <iostream>
-
 #include "toml++/toml.h"
 
 #include "instGraph.hpp"
-
-#if 0
-    #define BREADCRUMB std::cerr << __FILE__ << " " << __LINE__ << std::endl;
-#else
-    #define BREADCRUMB
-#endif
+#include "instTrace.hpp"
 
 namespace ingr
 {
@@ -107,8 +100,186 @@ instBeam *instGraph::beam( const std::string &key )
     return m_beams[key];
 }
 
+instDiagnostics *instGraph::diagnostics()
+{
+    if( m_diagnostics == nullptr )
+    {
+        return globalDiagnostics();
+    }
+
+    return m_diagnostics;
+}
+
+void instGraph::diagnostics( instDiagnostics *diag )
+{
+    m_diagnostics = diag;
+}
+
+instMetrics &instGraph::metrics()
+{
+    return m_metrics;
+}
+
+size_t instGraph::assignHandles()
+{
+    m_handles.clear();
+
+    for( auto &node : m_nodes )
+    {
+        for( auto &ip : node.second->inputs() )
+        {
+            ip.second->handle( m_handles.size() );
+            m_handles.push_back( { entityKind::put, ip.second } );
+        }
+
+        for( auto &op : node.second->outputs() )
+        {
+            op.second->handle( m_handles.size() );
+            m_handles.push_back( { entityKind::put, op.second } );
+        }
+    }
+
+    for( auto &beam : m_beams )
+    {
+        beam.second->handle( m_handles.size() );
+        m_handles.push_back( { entityKind::beam, beam.second } );
+    }
+
+    return m_handles.size();
+}
+
+size_t instGraph::nHandles() const
+{
+    return m_handles.size();
+}
+
+instIOPut *instGraph::handlePut( uint32_t h )
+{
+    if( h >= m_handles.size() || m_handles[h].first != entityKind::put )
+    {
+        return nullptr;
+    }
+
+    return static_cast<instIOPut *>( m_handles[h].second );
+}
+
+instBeam *instGraph::handleBeam( uint32_t h )
+{
+    if( h >= m_handles.size() || m_handles[h].first != entityKind::beam )
+    {
+        return nullptr;
+    }
+
+    return static_cast<instBeam *>( m_handles[h].second );
+}
+
+std::string instGraph::handleName( uint32_t h )
+{
+    if( instIOPut *put = handlePut( h ) )
+    {
+        std::string node = put->node() ? put->node()->name() : std::string();
+
+        return std::string( 1, ioDir2Char( put->io() ) ) + ":" + node + ":" + put->name();
+    }
+
+    if( instBeam *beam = handleBeam( h ) )
+    {
+        return "beam:" + beam->name();
+    }
+
+    return "";
+}
+
+instJournal *instGraph::journal()
+{
+    return m_journal;
+}
+
+void instGraph::journal( instJournal *jnl )
+{
+    m_journal = jnl;
+
+    if( m_journal )
+    {
+        assignHandles();
+
+        std::vector<std::string> names;
+        names.reserve( m_handles.size() );
+
+        for( size_t h = 0; h < m_handles.size(); ++h )
+        {
+            names.push_back( handleName( h ) );
+        }
+
+        m_journal->names( names );
+    }
+}
+
+instHistory *instGraph::history()
+{
+    return m_history;
+}
+
+void instGraph::history( instHistory *hist )
+{
+    m_history = hist;
+}
+
+instDwell &instGraph::dwell()
+{
+    return m_dwell;
+}
+
+instChanges &instGraph::changes()
+{
+    return m_changes;
+}
+
+instPathIndex *instGraph::paths()
+{
+    return m_paths;
+}
+
+void instGraph::paths( instPathIndex *pidx )
+{
+    m_paths = pidx;
+}
+
+instReachability *instGraph::reachability()
+{
+    return m_reachability;
+}
+
+void instGraph::reachability( instReachability *reach )
+{
+    m_reachability = reach;
+}
+
+uint64_t instGraph::enabledGeneration() const
+{
+    return m_enabledGeneration;
+}
+
+void instGraph::notifyEnabledChange( uint32_t handle )
+{
+    ++m_enabledGeneration;
+
+    if( m_reachability )
+    {
+        m_reachability->enabledChange( handle );
+    }
+}
+
+void instGraph::notifyStateChange()
+{
+    m_metrics.count( metricCounter::graphNotifications );
+
+    stateChange();
+}
+
 void instGraph::stateChange()
 {
+    INGR_TRACE_SCOPE( graphStateChange, this );
 }
 
 } // namespace ingr
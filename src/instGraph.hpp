@@ -3,9 +3,18 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "instNode.hpp"
 #include "instBeam.hpp"
+#include "instDiagnostics.hpp"
+#include "instMetrics.hpp"
+#include "instJournal.hpp"
+#include "instHistory.hpp"
+#include "instDwell.hpp"
+#include "instChanges.hpp"
+#include "instPathIndex.hpp"
+#include "instReachability.hpp"
 
 namespace ingr
 {
@@ -16,6 +25,7 @@ namespace ingr
  */
 class instGraph
 {
+    friend class instGraphBuilder;
 
   public:
     /// A map of nodes
@@ -31,6 +41,36 @@ class instGraph
     /// The beams of this graph
     beamMapT m_beams;
 
+    /// The diagnostics destination for this graph, not owned.  If nullptr the global destination is used.
+    instDiagnostics *m_diagnostics{ nullptr };
+
+    /// The counters and latency histograms for this graph
+    instMetrics m_metrics;
+
+    /// The puts and beams indexed by handle, see assignHandles()
+    std::vector<std::pair<entityKind, void *>> m_handles;
+
+    /// The journal of transitions, not owned.  If nullptr transitions are not journaled.
+    instJournal *m_journal{ nullptr };
+
+    /// The persistent history of transitions, not owned.  Set by instHistory::create.
+    instHistory *m_history{ nullptr };
+
+    /// The time spent in each state by the puts and beams, once started
+    instDwell m_dwell;
+
+    /// The generation of the graph, and once started the log of recent changes
+    instChanges m_changes;
+
+    /// The index of light paths with their lit status, not owned.  Set by instPathIndex::build.
+    instPathIndex *m_paths{ nullptr };
+
+    /// The reachability between puts, not owned.  Set by instReachability::build.
+    instReachability *m_reachability{ nullptr };
+
+    /// Incremented each time a put is enabled or disabled
+    uint64_t m_enabledGeneration{ 0 };
+
   public:
     /// Default c'tor
     instGraph();
@@ -86,6 +126,172 @@ class instGraph
      */
     instBeam *beam( const std::string &key );
 
+    /// Get the diagnostics destination for this graph
+    /**
+     * \returns m_diagnostics if set, otherwise the global destination.  Never nullptr.
+     */
+    instDiagnostics *diagnostics();
+
+    /// Set the diagnostics destination for this graph
+    void diagnostics( instDiagnostics *diag /**< [in] the new destination, not owned.  nullptr for the global one. */ );
+
+    /// Get the metrics registry for this graph
+    /**
+     * \returns a reference to m_metrics
+     */
+    instMetrics &metrics();
+
+    /// Assign a handle to each put and beam
+    /** Handles are consecutive from 0: the puts in node order, inputs then outputs, followed by the beams.
+     * Call again after adding puts or beams.
+     *
+     * \returns the number of handles assigned
+     */
+    size_t assignHandles();
+
+    /// Get the number of handles assigned by the last call to assignHandles()
+    /**
+     * \returns the size of m_handles
+     */
+    size_t nHandles() const;
+
+    /// Get the put with a handle
+    /**
+     * \returns the put, or nullptr if \p h is not the handle of a put
+     */
+    instIOPut *handlePut( uint32_t h /**< [in] the handle */ );
+
+    /// Get the beam with a handle
+    /**
+     * \returns the beam, or nullptr if \p h is not the handle of a beam
+     */
+    instBeam *handleBeam( uint32_t h /**< [in] the handle */ );
+
+    /// Get the name of the put or beam with a handle
+    /**
+     * \returns "i:node:put" or "o:node:put" for a put, "beam:name" for a beam, or "" if \p h is invalid
+     */
+    std::string handleName( uint32_t h /**< [in] the handle */ );
+
+    /// Get the journal
+    /**
+     * \returns the current value of m_journal, which may be nullptr
+     */
+    instJournal *journal();
+
+    /// Set the journal which records transitions
+    /** Assigns handles with assignHandles() and sets the journal's names.
+     */
+    void journal( instJournal *jnl /**< [in] the journal, not owned.  nullptr stops journaling. */ );
+
+    /// Get the persistent history
+    /**
+     * \returns the current value of m_history, which may be nullptr
+     */
+    instHistory *history();
+
+    /// Set the persistent history which records transitions
+    /** Normally called by instHistory::create and instHistory::close.
+     */
+    void history( instHistory *hist /**< [in] the history, not owned.  nullptr stops recording. */ );
+
+    /// Get the time-in-state accounting for this graph
+    /** Call instDwell::start on the result to begin accounting.
+     *
+     * \returns a reference to m_dwell
+     */
+    instDwell &dwell();
+
+    /// Get the generation and change log for this graph
+    /** Call instChanges::start on the result to begin logging.
+     *
+     * \returns a reference to m_changes
+     */
+    instChanges &changes();
+
+    /// Get the index of light paths
+    /**
+     * \returns the current value of m_paths, which may be nullptr
+     */
+    instPathIndex *paths();
+
+    /// Set the index of light paths which is told of transitions
+    /** Normally called by instPathIndex::build and instPathIndex::clear.
+     */
+    void paths( instPathIndex *pidx /**< [in] the index, not owned.  nullptr stops updates. */ );
+
+    /// Get the reachability between puts
+    /**
+     * \returns the current value of m_reachability, which may be nullptr
+     */
+    instReachability *reachability();
+
+    /// Set the reachability between puts which is told of enabled changes
+    /** Normally called by instReachability::build and instReachability::clear.
+     */
+    void reachability( instReachability *reach /**< [in] the reachability, not owned.  nullptr stops updates. */ );
+
+    /// Record a transition of a put or beam in the change log, path index, journal, history, and dwell accounting
+    void recordTransition( entityKind kind,    /**< [in] the kind of entity */
+                           uint32_t handle,    /**< [in] the entity's handle */
+                           int from,           /**< [in] the old state */
+                           int to,             /**< [in] the new state */
+                           journalCause cause  /**< [in] what caused the transition */
+    )
+    {
+        m_changes.transition( handle );
+
+        if( m_paths )
+        {
+            m_paths->transition( handle, from, to );
+        }
+
+        if( m_journal == nullptr && m_history == nullptr && !m_dwell.active() )
+        {
+            return;
+        }
+
+        journalRecord rec;
+        rec.time = journalTime();
+        rec.handle = handle;
+        rec.kind = kind;
+        rec.from = from;
+        rec.to = to;
+        rec.cause = cause;
+
+        if( m_journal )
+        {
+            m_journal->append( rec );
+        }
+
+        if( m_history )
+        {
+            m_history->record( rec );
+        }
+
+        if( m_dwell.active() )
+        {
+            m_dwell.transition( handle, to, rec.time );
+        }
+    }
+
+    /// Get the enabled generation
+    /** Analyses which depend on the enabled flags compare this with the generation they were computed for.
+     *
+     * \returns the current value of m_enabledGeneration
+     */
+    uint64_t enabledGeneration() const;
+
+    /// Notify the graph that a put was enabled or disabled
+    /** Increments the enabled generation and updates the reachability, if set.
+     */
+    void notifyEnabledChange( uint32_t handle /**< [in] the put's handle */ );
+
+    /// Notify the graph that the state of a put or beam changed
+    /** Counts the notification and calls stateChange().  Puts and beams call this rather than stateChange().
+     */
+    void notifyStateChange();
+
     virtual void stateChange();
 
 }; // class instGraph
@@ -0,0 +1,606 @@
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+#include "instGraphBuilder.hpp"
+
+namespace ingr
+{
+
+instGraphBuilder::instGraphBuilder()
+{
+}
+
+void instGraphBuilder::reserve( size_t nodes, size_t puts, size_t beams, size_t links )
+{
+    m_nodes.reserve( nodes );
+    m_puts.reserve( puts );
+    m_beams.reserve( beams );
+    m_links.reserve( links );
+}
+
+void instGraphBuilder::addNode( const std::string &name, void *auxData )
+{
+    m_nodes.push_back( { name, auxData } );
+}
+
+size_t instGraphBuilder::addPut( const std::string &node,
+                                 ioDir io,
+                                 const std::string &name,
+                                 putType type,
+                                 const std::string &beam,
+                                 void *auxData )
+{
+    m_puts.push_back( { node, io, name, type, beam, true, putState::off, auxData } );
+
+    return m_puts.size() - 1;
+}
+
+instGraphBuilder::putSpec &instGraphBuilder::put( size_t n )
+{
+    if( n >= m_puts.size() )
+    {
+        std::string msg = "put spec index " + std::to_string( n ) + " out of range";
+        msg += " (ingr::instGraphBuilder::put ";
+        msg += __FILE__;
+        msg += " ";
+        msg += std::to_string( __LINE__ );
+        msg += ")";
+
+        throw std::out_of_range( msg );
+    }
+
+    return m_puts[n];
+}
+
+void instGraphBuilder::addBeam( const std::string &name, void *auxData )
+{
+    m_beams.push_back( { name, "", "", "", "", auxData } );
+}
+
+void instGraphBuilder::addBeam( const std::string &name,
+                                const std::string &sourceNode,
+                                const std::string &sourcePut,
+                                const std::string &destNode,
+                                const std::string &destPut,
+                                void *auxData )
+{
+    m_beams.push_back( { name, sourceNode, sourcePut, destNode, destPut, auxData } );
+}
+
+void instGraphBuilder::addOutputLink( const std::string &node, const std::string &input, const std::string &output )
+{
+    m_links.push_back( { node, input, output } );
+}
+
+std::vector<void *> instGraphBuilder::auxData() const
+{
+    std::vector<void *> ads;
+
+    for( auto &n : m_nodes )
+    {
+        if( n.auxData )
+        {
+            ads.push_back( n.auxData );
+        }
+    }
+
+    for( auto &p : m_puts )
+    {
+        if( p.auxData )
+        {
+            ads.push_back( p.auxData );
+        }
+    }
+
+    for( auto &b : m_beams )
+    {
+        if( b.auxData )
+        {
+            ads.push_back( b.auxData );
+        }
+    }
+
+    return ads;
+}
+
+int instGraphBuilder::build( std::string &emsg, instGraph &graph )
+{
+    static constexpr size_t npos = std::string::npos;
+
+    auto fail = [&emsg]( const std::string &msg )
+    {
+        emsg = "instGraphBuilder::build: " + msg;
+        return -1;
+    };
+
+    auto dirStr = []( ioDir io ) { return ( io == ioDir::input ) ? std::string( "input" ) : std::string( "output" ); };
+
+    //--------------------------------------------------------------------
+    // Validation.  Nothing is allocated or changed in the graph here.
+    //--------------------------------------------------------------------
+
+    // Every node referenced, new or already in the graph, gets an entry in nodes.  Each node's puts are
+    // listed contiguously in nodePuts, sorted by direction and name.
+    struct nodeRef
+    {
+        size_t spec{ npos };       // index in m_nodes, npos if the node is already in the graph
+        instNode *node{ nullptr }; // the node, set for existing nodes now and for new nodes on construction
+        size_t putBegin{ 0 };      // start of this node's puts in nodePuts
+        size_t nInputs{ 0 };
+        size_t nOutputs{ 0 };
+    };
+
+    std::vector<nodeRef> nodes;
+    nodes.reserve( m_nodes.size() );
+
+    std::unordered_map<std::string_view, size_t> nodeIdx;
+    nodeIdx.reserve( m_nodes.size() );
+
+    for( size_t n = 0; n < m_nodes.size(); ++n )
+    {
+        if( m_nodes[n].name.empty() )
+        {
+            return fail( "node with empty name" );
+        }
+
+        if( !nodeIdx.emplace( m_nodes[n].name, nodes.size() ).second || graph.m_nodes.count( m_nodes[n].name ) > 0 )
+        {
+            return fail( "duplicate node \"" + m_nodes[n].name + "\"" );
+        }
+
+        nodes.push_back( {} );
+        nodes.back().spec = n;
+    }
+
+    // Get the index of a node in nodes, adding it if it is already in the graph. Returns npos if unknown.
+    auto nodeRefIdx = [&]( const std::string &name ) -> size_t
+    {
+        auto it = nodeIdx.find( name );
+        if( it != nodeIdx.end() )
+        {
+            return it->second;
+        }
+
+        auto git = graph.m_nodes.find( name );
+        if( git == graph.m_nodes.end() || git->second == nullptr )
+        {
+            return npos;
+        }
+
+        nodeIdx.emplace( git->first, nodes.size() );
+        nodes.push_back( {} );
+        nodes.back().node = git->second;
+
+        return nodes.size() - 1;
+    };
+
+    // Puts
+    std::vector<size_t> putNode( m_puts.size() );
+
+    for( size_t p = 0; p < m_puts.size(); ++p )
+    {
+        const putSpec &ps = m_puts[p];
+
+        if( ps.name.empty() )
+        {
+            return fail( "put with empty name on node \"" + ps.node + "\"" );
+        }
+
+        size_t nr = nodeRefIdx( ps.node );
+        if( nr == npos )
+        {
+            return fail( "unknown node \"" + ps.node + "\" for " + dirStr( ps.io ) + " \"" + ps.name + "\"" );
+        }
+
+        instNode *gn = nodes[nr].node;
+        if( gn && ( ( ps.io == ioDir::input && gn->inputValid( ps.name ) ) ||
+                    ( ps.io == ioDir::output && gn->outputValid( ps.name ) ) ) )
+        {
+            return fail( "duplicate " + dirStr( ps.io ) + " \"" + ps.name + "\" on node \"" + ps.node + "\"" );
+        }
+
+        putNode[p] = nr;
+
+        if( ps.io == ioDir::input )
+        {
+            ++nodes[nr].nInputs;
+        }
+        else
+        {
+            ++nodes[nr].nOutputs;
+        }
+    }
+
+    auto putLess = [this]( size_t a, size_t b )
+    {
+        if( m_puts[a].io != m_puts[b].io )
+        {
+            return m_puts[a].io < m_puts[b].io;
+        }
+
+        return m_puts[a].name < m_puts[b].name;
+    };
+
+    std::vector<size_t> nodePuts( m_puts.size() );
+    {
+        size_t begin = 0;
+        for( nodeRef &nr : nodes )
+        {
+            nr.putBegin = begin;
+            begin += nr.nInputs + nr.nOutputs;
+        }
+
+        std::vector<size_t> fill( nodes.size() );
+        for( size_t n = 0; n < nodes.size(); ++n )
+        {
+            fill[n] = nodes[n].putBegin;
+        }
+
+        for( size_t p = 0; p < m_puts.size(); ++p )
+        {
+            nodePuts[fill[putNode[p]]++] = p;
+        }
+    }
+
+    for( nodeRef &nr : nodes )
+    {
+        auto begin = nodePuts.begin() + nr.putBegin;
+        auto end = begin + nr.nInputs + nr.nOutputs;
+
+        std::sort( begin, end, putLess );
+
+        auto dup = std::adjacent_find( begin, end, [&]( size_t a, size_t b ) { return !putLess( a, b ); } );
+        if( dup != end )
+        {
+            const putSpec &ps = m_puts[*dup];
+            return fail( "duplicate " + dirStr( ps.io ) + " \"" + ps.name + "\" on node \"" + ps.node + "\"" );
+        }
+    }
+
+    // Find a put, returning true if it is either in the specs or already in the graph.
+    // If in the specs, spec is set to its index, otherwise to npos, and existing to the put.
+    auto findPut = [&]( size_t nr, ioDir io, const std::string &name, size_t &spec, instIOPut *&existing )
+    {
+        spec = npos;
+        existing = nullptr;
+
+        auto begin = nodePuts.begin() + nodes[nr].putBegin;
+        auto end = begin + nodes[nr].nInputs + nodes[nr].nOutputs;
+
+        auto it = std::lower_bound( begin,
+                                    end,
+                                    0,
+                                    [&]( size_t a, int )
+                                    {
+                                        if( m_puts[a].io != io )
+                                        {
+                                            return m_puts[a].io < io;
+                                        }
+                                        return m_puts[a].name < name;
+                                    } );
+
+        if( it != end && m_puts[*it].io == io && m_puts[*it].name == name )
+        {
+            spec = *it;
+            return true;
+        }
+
+        instNode *gn = nodes[nr].node;
+        if( gn == nullptr )
+        {
+            return false;
+        }
+
+        const instNode::ioputMapT &puts = ( io == ioDir::input ) ? gn->inputs() : gn->outputs();
+        auto git = puts.find( name );
+        if( git == puts.end() || git->second == nullptr )
+        {
+            return false;
+        }
+
+        existing = git->second;
+
+        return true;
+    };
+
+    // Beams, and the puts at each end.  The first m_beams.size() entries are the explicit beams, in order.
+    struct beamEnds
+    {
+        std::string_view name;
+        instBeam *existing{ nullptr }; // set if the beam is already in the graph
+
+        size_t srcNode{ npos };  // index in nodes of the source's node
+        std::string_view srcPut; // name of the source
+        bool hasSrc{ false };
+
+        size_t destNode{ npos };
+        std::string_view destPut;
+        bool hasDest{ false };
+    };
+
+    std::vector<beamEnds> beams;
+    beams.reserve( m_beams.size() );
+
+    std::unordered_map<std::string_view, size_t> beamIdx;
+    beamIdx.reserve( m_beams.size() );
+
+    for( size_t n = 0; n < m_beams.size(); ++n )
+    {
+        if( m_beams[n].name.empty() )
+        {
+            return fail( "beam with empty name" );
+        }
+
+        if( !beamIdx.emplace( m_beams[n].name, beams.size() ).second || graph.m_beams.count( m_beams[n].name ) > 0 )
+        {
+            return fail( "duplicate beam \"" + m_beams[n].name + "\"" );
+        }
+
+        beams.push_back( {} );
+        beams.back().name = m_beams[n].name;
+    }
+
+    // Record one end of a beam, returning false if that end is already connected to a different put
+    auto setEnd = []( bool &has, size_t &node, std::string_view &put, size_t nn, std::string_view np )
+    {
+        if( has )
+        {
+            return ( node == nn && put == np );
+        }
+
+        has = true;
+        node = nn;
+        put = np;
+
+        return true;
+    };
+
+    std::vector<size_t> putBeam( m_puts.size(), npos );
+
+    for( size_t p = 0; p < m_puts.size(); ++p )
+    {
+        const putSpec &ps = m_puts[p];
+
+        if( ps.beam.empty() )
+        {
+            continue;
+        }
+
+        auto it = beamIdx.find( ps.beam );
+
+        if( it == beamIdx.end() )
+        {
+            beamEnds be;
+            be.name = ps.beam;
+
+            auto git = graph.m_beams.find( ps.beam );
+            if( git != graph.m_beams.end() && git->second != nullptr )
+            {
+                // An existing beam's connected ends can't be replaced, which setEnd enforces with an invalid node
+                be.existing = git->second;
+                be.hasSrc = be.existing->sourceValid();
+                be.hasDest = be.existing->destValid();
+            }
+
+            it = beamIdx.emplace( ps.beam, beams.size() ).first;
+            beams.push_back( be );
+        }
+
+        beamEnds &be = beams[it->second];
+
+        bool ok = ( ps.io == ioDir::output ) ? setEnd( be.hasSrc, be.srcNode, be.srcPut, putNode[p], ps.name )
+                                             : setEnd( be.hasDest, be.destNode, be.destPut, putNode[p], ps.name );
+
+        if( !ok )
+        {
+            return fail( "beam \"" + ps.beam + "\" already has a " +
+                         ( ps.io == ioDir::output ? std::string( "source" ) : std::string( "dest" ) ) + " (" +
+                         dirStr( ps.io ) + " \"" + ps.name + "\" on node \"" + ps.node + "\")" );
+        }
+
+        putBeam[p] = it->second;
+    }
+
+    // Ends given on the beam side.  The put must exist and not be connected to a different beam.
+    auto beamSideEnd = [&]( size_t b, ioDir io, const std::string &node, const std::string &name )
+    {
+        const beamSpec &bs = m_beams[b];
+        beamEnds &be = beams[b];
+
+        size_t nr = nodeRefIdx( node );
+
+        size_t spec = npos;
+        instIOPut *existing = nullptr;
+
+        if( nr == npos || !findPut( nr, io, name, spec, existing ) ||
+            ( spec != npos && !m_puts[spec].beam.empty() && m_puts[spec].beam != bs.name ) ||
+            ( existing && existing->beamValid() ) )
+        {
+            return fail( dirStr( io ) + " \"" + name + "\" on node \"" + node +
+                         "\" not found or already connected for beam \"" + bs.name + "\"" );
+        }
+
+        bool ok = ( io == ioDir::output ) ? setEnd( be.hasSrc, be.srcNode, be.srcPut, nr, name )
+                                          : setEnd( be.hasDest, be.destNode, be.destPut, nr, name );
+
+        if( !ok )
+        {
+            return fail( "beam \"" + bs.name + "\" already has a " +
+                         ( io == ioDir::output ? std::string( "source" ) : std::string( "dest" ) ) );
+        }
+
+        return 0;
+    };
+
+    for( size_t b = 0; b < m_beams.size(); ++b )
+    {
+        const beamSpec &bs = m_beams[b];
+
+        if( !bs.sourceNode.empty() || !bs.sourcePut.empty() )
+        {
+            if( beamSideEnd( b, ioDir::output, bs.sourceNode, bs.sourcePut ) < 0 )
+            {
+                return -1;
+            }
+        }
+
+        if( !bs.destNode.empty() || !bs.destPut.empty() )
+        {
+            if( beamSideEnd( b, ioDir::input, bs.destNode, bs.destPut ) < 0 )
+            {
+                return -1;
+            }
+        }
+    }
+
+    // Output links
+    std::vector<size_t> linkNode( m_links.size() );
+
+    for( size_t l = 0; l < m_links.size(); ++l )
+    {
+        const linkSpec &ls = m_links[l];
+
+        size_t nr = nodeRefIdx( ls.node );
+
+        size_t spec;
+        instIOPut *existing;
+
+        if( nr == npos || !findPut( nr, ioDir::input, ls.input, spec, existing ) )
+        {
+            return fail( "input \"" + ls.input + "\" on node \"" + ls.node + "\" not found for output link" );
+        }
+
+        if( !findPut( nr, ioDir::output, ls.output, spec, existing ) )
+        {
+            return fail( "output \"" + ls.output + "\" on node \"" + ls.node + "\" not found for output link from \"" +
+                         ls.input + "\"" );
+        }
+
+        linkNode[l] = nr;
+    }
+
+    //--------------------------------------------------------------------
+    // Construction.  Everything is valid, so nothing below can fail.
+    //--------------------------------------------------------------------
+
+    // Nodes are inserted in sorted order, hinting at the position after the last one, so each insertion into
+    // an empty map is amortized constant time.
+    std::vector<size_t> order( m_nodes.size() );
+    std::iota( order.begin(), order.end(), 0 );
+    std::sort( order.begin(), order.end(), [this]( size_t a, size_t b ) { return m_nodes[a].name < m_nodes[b].name; } );
+
+    auto nhint = graph.m_nodes.end();
+    for( size_t n : order )
+    {
+        instNode *nn = new instNode( m_nodes[n].name );
+        nn->auxData( m_nodes[n].auxData );
+        nn->reserve( nodes[n].nInputs, nodes[n].nOutputs );
+        nodes[n].node = nn;
+
+        nhint = std::next( graph.m_nodes.emplace_hint( nhint, m_nodes[n].name, nn ) );
+    }
+
+    // Beams, also in sorted order
+    order.resize( beams.size() );
+    std::iota( order.begin(), order.end(), 0 );
+    std::sort( order.begin(), order.end(), [&beams]( size_t a, size_t b ) { return beams[a].name < beams[b].name; } );
+
+    std::vector<instBeam *> beamPtr( beams.size(), nullptr );
+
+    auto bhint = graph.m_beams.end();
+    for( size_t b : order )
+    {
+        if( beams[b].existing )
+        {
+            beamPtr[b] = beams[b].existing;
+            continue;
+        }
+
+        instBeam *nb = new instBeam;
+        nb->name( std::string( beams[b].name ) );
+        nb->parentGraph( &graph );
+        if( b < m_beams.size() )
+        {
+            nb->auxData( m_beams[b].auxData );
+        }
+        beamPtr[b] = nb;
+
+        bhint = std::next( graph.m_beams.emplace_hint( bhint, beams[b].name, nb ) );
+    }
+
+    // Puts.  addIOPut connects the beam back to the put.
+    std::vector<std::pair<instIOPut *, putState>> initial;
+
+    for( size_t p = 0; p < m_puts.size(); ++p )
+    {
+        const putSpec &ps = m_puts[p];
+
+        instNode *nn = nodes[putNode[p]].node;
+        instBeam *nb = ( putBeam[p] == npos ) ? nullptr : beamPtr[putBeam[p]];
+
+        instIOPut *np = new instIOPut( nn, ps.io, ps.name, ps.type, nb );
+        np->enabled( ps.enabled );
+        np->parentGraph( &graph );
+        np->auxData( ps.auxData );
+
+        nn->addIOPut( np );
+
+        if( ps.state != putState::off )
+        {
+            initial.push_back( { np, ps.state } );
+        }
+    }
+
+    // Ends given on the beam side
+    for( size_t b = 0; b < m_beams.size(); ++b )
+    {
+        const beamSpec &bs = m_beams[b];
+        instBeam *nb = beamPtr[b];
+
+        if( !bs.sourceNode.empty() || !bs.sourcePut.empty() )
+        {
+            instIOPut *op = nodes[beams[b].srcNode].node->output( bs.sourcePut );
+            op->beam( nb );
+            nb->source( op );
+        }
+
+        if( !bs.destNode.empty() || !bs.destPut.empty() )
+        {
+            instIOPut *ip = nodes[beams[b].destNode].node->input( bs.destPut );
+            ip->beam( nb );
+            nb->dest( ip );
+        }
+    }
+
+    for( size_t l = 0; l < m_links.size(); ++l )
+    {
+        nodes[linkNode[l]].node->input( m_links[l].input )->outputLink( m_links[l].output );
+    }
+
+    for( nodeRef &nr : nodes )
+    {
+        nr.node->updateOutputLinks();
+    }
+
+    for( auto &ip : initial )
+    {
+        ip.first->state( ip.second );
+    }
+
+    clear();
+
+    return 0;
+}
+
+void instGraphBuilder::clear()
+{
+    m_nodes.clear();
+    m_puts.clear();
+    m_beams.clear();
+    m_links.clear();
+}
+
+} // namespace ingr
@@ -0,0 +1,157 @@
+/** \file
+ *
+ * \brief Bulk construction of an instGraph
+ */
+
+#ifndef instGraphBuilder_hpp
+#define instGraphBuilder_hpp
+
+#include <string>
+#include <vector>
+
+#include "instGraph.hpp"
+
+namespace ingr
+{
+
+/// Builds an instGraph from nodes, puts, beams, and output links added in any order.
+/** Entities are only recorded as they are added.  All validation, allocation, and linking is done in a
+ * single pass by build(), which either adds everything to the graph or nothing.  build() sets the parent
+ * graph of every put and beam, connects beams to their source and dest puts, and updates the outputLinked
+ * flags of every node.  Finally any initial put states are set, in the order the puts were added, so that
+ * they propagate through the complete graph.
+ *
+ * A beam can be connected either from the put side, by giving the beam name to addPut, or from the beam
+ * side by giving the source and dest puts to addBeam.  A beam named by a put but never passed to addBeam is created.  Nodes must be added
+ * with addNode, or already exist in the graph.
+ *
+ * This is used by both instGraphTOML and instGraphXML, and can be used to generate graphs programmatically.
+ *
+ * \ingroup explainer
+ */
+class instGraphBuilder
+{
+  public:
+    /// Specification of a node
+    struct nodeSpec
+    {
+        std::string name;
+        void *auxData{ nullptr };
+    };
+
+    /// Specification of a put
+    struct putSpec
+    {
+        std::string node;
+        ioDir io{ ioDir::input };
+        std::string name;
+        putType type{ putType::light };
+        std::string beam; ///< The beam connected to this put, may be empty
+        bool enabled{ true };
+        putState state{ putState::off }; ///< The initial state, set after all entities are linked
+        void *auxData{ nullptr };
+    };
+
+    /// Specification of a beam
+    struct beamSpec
+    {
+        std::string name;
+        std::string sourceNode; ///< The node of the source output, may be empty
+        std::string sourcePut;  ///< The name of the source output, may be empty
+        std::string destNode;   ///< The node of the dest input, may be empty
+        std::string destPut;    ///< The name of the dest input, may be empty
+        void *auxData{ nullptr };
+    };
+
+    /// Specification of an output link
+    struct linkSpec
+    {
+        std::string node;
+        std::string input;
+        std::string output;
+    };
+
+  protected:
+    std::vector<nodeSpec> m_nodes;
+    std::vector<putSpec> m_puts;
+    std::vector<beamSpec> m_beams;
+    std::vector<linkSpec> m_links;
+
+  public:
+    /// Default c'tor
+    instGraphBuilder();
+
+    /// Reserve space for the expected number of entities
+    void reserve( size_t nodes, /**< [in] the expected number of nodes */
+                  size_t puts,  /**< [in] the expected number of puts */
+                  size_t beams, /**< [in] the expected number of beams */
+                  size_t links  /**< [in] the expected number of output links */
+    );
+
+    /// Add a node
+    void addNode( const std::string &name,  /**< [in] the unique name of the node */
+                  void *auxData = nullptr   /**< [in] [optional] aux data for the node */
+    );
+
+    /// Add a put
+    /**
+     * \returns the index of the put's spec, which can be used with put()
+     */
+    size_t addPut( const std::string &node,       /**< [in] the name of the parent node */
+                   ioDir io,                      /**< [in] the direction of the put */
+                   const std::string &name,       /**< [in] the name of the put, unique in its node and direction */
+                   putType type,                  /**< [in] the type of the put */
+                   const std::string &beam = "",  /**< [in] [optional] the beam connected to the put */
+                   void *auxData = nullptr        /**< [in] [optional] aux data for the put */
+    );
+
+    /// Get the spec of a put previously added, to set other members
+    /**
+     * \returns a reference to the put spec
+     */
+    putSpec &put( size_t n /**< [in] the index returned by addPut */ );
+
+    /// Add a beam
+    void addBeam( const std::string &name, /**< [in] the unique name of the beam */
+                  void *auxData = nullptr  /**< [in] [optional] aux data for the beam */
+    );
+
+    /// Add a beam, specifying its source and dest puts
+    void addBeam( const std::string &name,       /**< [in] the unique name of the beam */
+                  const std::string &sourceNode, /**< [in] the node of the source output */
+                  const std::string &sourcePut,  /**< [in] the name of the source output */
+                  const std::string &destNode,   /**< [in] the node of the dest input */
+                  const std::string &destPut,    /**< [in] the name of the dest input */
+                  void *auxData = nullptr        /**< [in] [optional] aux data for the beam */
+    );
+
+    /// Add an output link from an input to an output of the same node
+    void addOutputLink( const std::string &node,   /**< [in] the node */
+                        const std::string &input,  /**< [in] the name of the input */
+                        const std::string &output  /**< [in] the name of the output */
+    );
+
+    /// Get all non-null aux data pointers in the specs
+    /** Useful for cleaning up if build() fails, since the aux data is then not attached to anything.
+     *
+     * \returns a vector of the aux data pointers
+     */
+    std::vector<void *> auxData() const;
+
+    /// Validate the specs, and if valid create and link all entities in the graph
+    /** If an error is found nothing is added to the graph.  The specs are cleared on success.
+     *
+     * \returns 0 on success
+     * \returns -1 on error, with \p emsg set
+     */
+    int build( std::string &emsg,  /**< [out] the error message, if any */
+               instGraph &graph    /**< [in/out] the graph to add the entities to */
+    );
+
+    /// Remove all specs
+    void clear();
+};
+
+} // namespace ingr
+
+#endif // instGraphBuilder_hpp
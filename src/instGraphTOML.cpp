@@ -1,19 +1,23 @@
-
-#include <iostream>
-
 #include "toml++/toml.h"
 
 #include "instGraphTOML.hpp"
-
-#if 0
-    #define BREADCRUMB std::cerr << __FILE__ << " " << __LINE__ << std::endl;
-#else
-    #define BREADCRUMB
-#endif
+#include "instGraphBuilder.hpp"
 
 namespace ingr
 {
 
+// Report a diagnostic at the source position of a TOML node
+template <typename formatT>
+void reportTOML( instDiagnostics *diag, severity sev, const toml::node &tn, formatT &&format )
+{
+    diag->report( sev,
+                  "instGraphTOML",
+                  tn.source().begin.line,
+                  tn.source().begin.column,
+                  0,
+                  std::forward<formatT>( format ) );
+}
+
 instGraphTOML::instGraphTOML()
 {
 }
@@ -24,194 +28,265 @@ instGraphTOML::~instGraphTOML()
 
 int instGraphTOML::parseTOMLTable( toml::table &tbl )
 {
-    toml::array &configNodes = *tbl["nodes"].as_array();
+    instDiagnostics *diag = diagnostics();
+
+    toml::array *configNodes = tbl["nodes"].as_array();
+
+    if( configNodes == nullptr )
+    {
+        diag->report( severity::error, "instGraphTOML", 0, 0, 0, [] { return std::string( "no nodes array" ); } );
+        return -1;
+    }
+
+    // Beams are named by the puts at either end, in any order, so the graph is built once all are parsed
+    instGraphBuilder builder;
+    builder.reserve( configNodes->size(), 2 * configNodes->size(), configNodes->size(), configNodes->size() );
 
-    for( auto &&tab : configNodes )
+    size_t nNodes = 0;
+    size_t nPuts = 0;
+
+    for( auto &&tab : *configNodes )
     {
-        toml::node_view<toml::node> name = tab.as_table()->at_path( "name" );
+        toml::table *nodeTbl = tab.as_table();
 
-        if( !name.is_string() )
+        if( nodeTbl == nullptr )
         {
-            if( tab.source().begin.operator bool() )
+            reportTOML( diag, severity::error, tab, [] { return std::string( "node is not a table" ); } );
+            return -1;
+        }
+
+        const std::string *name = nullptr;
+        toml::array *inputs = nullptr;
+        toml::array *outputs = nullptr;
+
+        for( auto &&[key, val] : *nodeTbl )
+        {
+            if( key == "name" )
             {
-                std::cerr << "Node at " << tab.source().begin << " has no name. Ignoring. \n";
+                if( !val.is_string() )
+                {
+                    reportTOML( diag, severity::error, val, [] { return std::string( "node name is not a string" ); } );
+                    return -1;
+                }
+
+                name = &val.as_string()->get();
+            }
+            else if( key == "inputs" || key == "outputs" )
+            {
+                if( !val.is_array() )
+                {
+                    reportTOML( diag,
+                                severity::error,
+                                val,
+                                [&] { return "node " + std::string( key.str() ) + " is not an array"; } );
+                    return -1;
+                }
+
+                ( key == "inputs" ? inputs : outputs ) = val.as_array();
             }
             else
             {
-                std::cerr << "node without name\n";
+                reportTOML( diag,
+                            severity::warning,
+                            val,
+                            [&] { return "ignoring unknown node key \"" + std::string( key.str() ) + "\""; } );
             }
-            continue;
         }
 
-        std::string newname = tab.as_table()->at_path( "name" ).as_string()->get();
-
-        std::cout << "Creating node: " << newname << "\n";
-
-        BREADCRUMB
-
-        instNode *newNode = new instNode( newname );
-
-        std::pair<nodeMapT::iterator, bool> nodeRes = m_nodes.emplace( newname, newNode );
-
-        BREADCRUMB
-
-        toml::array *configOutputs = tab.at_path( "outputs" ).as_array();
-        if( configOutputs == nullptr )
+        if( name == nullptr )
         {
-            std::cerr << "   Node at " << tab.source().begin << " has no outputs.\n";
+            reportTOML( diag, severity::warning, tab, [] { return std::string( "ignoring node without name" ); } );
+            continue;
         }
-        else
-        {
-            std::cout << "\tWith " << configOutputs->size() << " outputs\n";
 
-            for( auto &&output : *configOutputs )
+        builder.addNode( *name );
+        ++nNodes;
+
+        if( outputs )
+        {
+            for( auto &&output : *outputs )
             {
-                if( !output.as_table()->at_path( "name" ).is_string() )
+                if( parseTOMLPut( builder, *name, ioDir::output, output ) < 0 )
                 {
-                    /// \todo test me
-                    std::cerr << "\tOutput at " << output.source().begin << " has no name.";
                     return -1;
                 }
+            }
+
+            nPuts += outputs->size();
+        }
 
-                if( !output.as_table()->at_path( "beam" ).is_string() )
+        if( inputs )
+        {
+            for( auto &&input : *inputs )
+            {
+                if( parseTOMLPut( builder, *name, ioDir::input, input ) < 0 )
                 {
-                    /// \todo test me
-                    std::cerr << "\tOutput at " << output.source().begin << " has no beam.";
                     return -1;
                 }
+            }
 
-                BREADCRUMB
+            nPuts += inputs->size();
+        }
+    }
 
-                // First handle the beam, creating if needed or updating otherwise
-                std::string beamName = output.as_table()->at_path( "beam" ).as_string()->get();
+    size_t nBeams = m_beams.size();
 
-                ingr::instBeam *newBeam = nullptr;
+    std::string emsg;
+    if( builder.build( emsg, *this ) < 0 )
+    {
+        diag->report( severity::error, "instGraphTOML", 0, 0, 0, [&] { return emsg; } );
+        return -1;
+    }
 
-                if( m_beams.count( beamName ) == 0 )
-                {
-                    newBeam = new instBeam;
-                    std::pair<beamMapT::iterator, bool> beamRes = m_beams.emplace( beamName, newBeam );
-                    newBeam->name( beamName );
-                    std::cerr << "\tCreated beam " << beamName << "\n";
-                }
-                else
-                {
-                    newBeam = m_beams[beamName];
-
-                    if( newBeam != nullptr )
-                    {
-                        if( newBeam->sourceValid() )
-                        {
-                            ///\todo test me
-                            std::cerr << "\tBeam " << beamName << "("
-                                      << output.as_table()->at_path( "beam" ).node()->source().begin
-                                      << ") already has a source.\n";
-                            return -1;
-                        }
-                    }
-
-                    std::cerr << "\tUpdating beam " << beamName << "\n";
-                }
+    diag->report( severity::info, "instGraphTOML", 0, 0, nNodes, [] { return std::string( "nodes loaded" ); } );
+    diag->report( severity::info, "instGraphTOML", 0, 0, nPuts, [] { return std::string( "puts loaded" ); } );
+    diag->report( severity::info,
+                  "instGraphTOML",
+                  0,
+                  0,
+                  m_beams.size() - nBeams,
+                  [] { return std::string( "beams loaded" ); } );
 
-                BREADCRUMB
+    return 0;
+}
 
-                // Now handle the output
-                std::string putName = output.as_table()->at_path( "name" ).as_string()->get();
+int instGraphTOML::parseTOMLPut( instGraphBuilder &builder, const std::string &node, ioDir io, toml::node &put )
+{
+    instDiagnostics *diag = diagnostics();
 
-                BREADCRUMB
+    toml::table *putTbl = put.as_table();
 
-                // Here we add the output
-                instIOPut *newPut =
-                    new instIOPut( { newNode, ingr::ioDir::output, putName, ingr::putType::light, newBeam } );
-                newNode->addIOPut( newPut );
-            }
-        }
+    if( putTbl == nullptr )
+    {
+        reportTOML( diag,
+                    severity::error,
+                    put,
+                    [&] { return ioDir2String( io ) + " of node " + node + " is not a table"; } );
+        return -1;
+    }
 
-        toml::array *configInputs = tab.at_path( "inputs" ).as_array();
-        if( configInputs == nullptr )
-        {
-            std::cout << "\tWith " << 0 << " inputs\n";
-        }
-        else
-        {
-            std::cout << "\tWith " << configInputs->size() << " inputs\n";
+    auto notString = [&]( const toml::key &key, const toml::node &val )
+    {
+        reportTOML( diag,
+                    severity::error,
+                    val,
+                    [&] { return ioDir2String( io ) + " " + std::string( key.str() ) + " is not a string"; } );
+        return -1;
+    };
 
-            for( auto &&input : *configInputs )
-            {
+    auto badValue = [&]( const toml::key &key, const toml::node &val )
+    {
+        reportTOML( diag,
+                    severity::error,
+                    val,
+                    [&] { return "invalid " + ioDir2String( io ) + " " + std::string( key.str() ); } );
+        return -1;
+    };
 
-                if( !input.as_table()->at_path( "name" ).is_string() )
-                {
-                    /// \todo test me
-                    std::cerr << "Input at " << input.source().begin << " has no name.";
-                    return -1;
-                }
+    const std::string *name = nullptr;
+    const std::string *beam = nullptr;
+    putType type = putType::light;
+    bool enabled = true;
+    putState state = putState::off;
+    toml::array *links = nullptr;
 
-                if( !input.as_table()->at_path( "beam" ).is_string() )
-                {
-                    /// \todo test me
-                    std::cerr << "Input at " << input.source().begin << " has no beam.";
-                    return -1;
-                }
+    for( auto &&[key, val] : *putTbl )
+    {
+        if( key == "name" )
+        {
+            if( !val.is_string() )
+            {
+                return notString( key, val );
+            }
 
-                BREADCRUMB
+            name = &val.as_string()->get();
+        }
+        else if( key == "beam" )
+        {
+            if( !val.is_string() )
+            {
+                return notString( key, val );
+            }
 
-                // First handle the beam, creating if needed or updating otherwise
-                std::string beamName = input.as_table()->at_path( "beam" ).as_string()->get();
+            beam = &val.as_string()->get();
+        }
+        else if( key == "type" )
+        {
+            if( !val.is_string() )
+            {
+                return notString( key, val );
+            }
 
-                instBeam *newBeam = nullptr;
+            if( string2PutType( type, val.as_string()->get() ) < 0 )
+            {
+                return badValue( key, val );
+            }
+        }
+        else if( key == "enabled" )
+        {
+            if( !val.is_boolean() )
+            {
+                return badValue( key, val );
+            }
 
-                if( m_beams.count( beamName ) == 0 )
-                {
-                    newBeam = new instBeam;
-                    std::pair<beamMapT::iterator, bool> beamRes = m_beams.emplace( beamName, newBeam );
-                    std::cerr << "\tCreated beam " << beamName << "\n";
-                    newBeam->name( beamName );
-                }
-                else
-                {
-                    newBeam = m_beams[beamName];
-                    if( newBeam != nullptr )
-                    {
-                        if( newBeam->destValid() )
-                        {
-                            ///\todo test me
-                            std::cerr << "Beam " << beamName << "("
-                                      << input.as_table()->at_path( "beam" ).node()->source().begin
-                                      << ") already has a dest.\n";
-                            return -1;
-                        }
-                    }
-
-                    std::cerr << "\tUpdating beam " << beamName << "\n";
-                }
+            enabled = val.as_boolean()->get();
+        }
+        else if( key == "state" )
+        {
+            if( !val.is_string() )
+            {
+                return notString( key, val );
+            }
 
-                BREADCRUMB
+            if( string2PutState( state, val.as_string()->get() ) < 0 )
+            {
+                return badValue( key, val );
+            }
+        }
+        else if( key == "outputLinks" && io == ioDir::input )
+        {
+            if( !val.is_array() )
+            {
+                return badValue( key, val );
+            }
 
-                // Now handle the input
-                std::string putName = input.as_table()->at_path( "name" ).as_string()->get();
+            links = val.as_array();
+        }
+        else
+        {
+            reportTOML(
+                diag,
+                severity::warning,
+                val,
+                [&] { return "ignoring unknown " + ioDir2String( io ) + " key \"" + std::string( key.str() ) + "\""; } );
+        }
+    }
 
-                BREADCRUMB
+    if( name == nullptr )
+    {
+        reportTOML( diag,
+                    severity::error,
+                    put,
+                    [&] { return ioDir2String( io ) + " of node " + node + " has no name"; } );
+        return -1;
+    }
 
-                instIOPut *newPut =
-                    new instIOPut( { newNode, ingr::ioDir::input, putName, ingr::putType::light, newBeam } );
-                std::string nnKey = newNode->addIOPut( newPut );
+    size_t ps = builder.addPut( node, io, *name, type, beam ? *beam : std::string() );
+    builder.put( ps ).enabled = enabled;
+    builder.put( ps ).state = state;
 
-                if( input.as_table()->at_path( "outputLinks" ).is_array() )
-                {
-                    /// \todo test me
-                    std::cerr << "\t\thas outputLinks:\n";
-                    for( int n = 0; n < input.as_table()->at_path( "outputLinks" ).as_array()->size(); ++n )
-                    {
-                        std::string olink =
-                            input.as_table()->at_path( "outputLinks" ).as_array()->at( n ).as_string()->get();
-                        std::cerr << "\t\t    " << olink << "\n";
-
-                        newNode->input( nnKey )->outputLink( olink );
-                    }
-                }
+    if( links )
+    {
+        for( auto &&link : *links )
+        {
+            if( !link.is_string() )
+            {
+                reportTOML( diag, severity::error, link, [] { return std::string( "output link is not a string" ); } );
+                return -1;
             }
+
+            builder.addOutputLink( node, *name, link.as_string()->get() );
         }
-        // End of adding node
     }
 
     return 0;
@@ -227,8 +302,12 @@ int instGraphTOML::loadTOMLFile( const std::string &fname )
     }
     catch( const toml::parse_error &err )
     {
-        ///\todo identify errors
-        std::cerr << "Parsing failed:\n" << err << "\n";
+        diagnostics()->report( severity::error,
+                               "instGraphTOML",
+                               err.source().begin.line,
+                               err.source().begin.column,
+                               0,
+                               [&] { return "parsing " + fname + " failed: " + std::string( err.description() ); } );
         return -1;
     }
 }
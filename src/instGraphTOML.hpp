@@ -9,14 +9,41 @@ namespace toml
 namespace v3
 {
 class table;
+class node;
 }
 } // namespace toml
 
 namespace ingr
 {
 
+class instGraphBuilder;
+
 /// Specifying an instrument graph with TOML.
-/**
+/** The graph is an array of tables named `nodes`.  Each node has a `name`, and optional arrays of tables
+ * named `inputs` and `outputs`.  Each put has a `name` and the optional keys:
+ * - `beam`: the name of the beam connected to the put
+ * - `type`: one of "light" (default), "data", "power", "mechanical", or "fluid"
+ * - `enabled`: true (default) or false
+ * - `state`: the initial state, one of "off" (default), "waiting", or "on"
+ * - `outputLinks`: for inputs only, an array of the names of outputs of the same node
+ *
+ * For example:
+ * \code
+ * [[nodes]]
+ *     name="pickoff"
+ *     [[nodes.inputs]]
+ *         name="tel"
+ *         beam="telescope2pickoff"
+ *         state="on"
+ *         outputLinks=["out"]
+ *     [[nodes.outputs]]
+ *         name="out"
+ *         beam="pickoff2stagek"
+ * \endcode
+ *
+ * Errors and warnings are reported with their source positions, and the counts of entities loaded at
+ * severity::info, to the graph's diagnostics().
+ *
  * \ingroup explainer
  */
 class instGraphTOML : public instGraph
@@ -28,9 +55,32 @@ class instGraphTOML : public instGraph
 
     ~instGraphTOML();
 
-    int parseTOMLTable( toml::v3::table &tbl );
+    /// Add the nodes, puts, and beams specified in a parsed TOML table to the graph
+    /** Nothing is added if there is an error.
+     *
+     * \returns 0 on success
+     * \returns -1 on error
+     */
+    int parseTOMLTable( toml::v3::table &tbl /**< [in] the parsed table */ );
+
+    /// Load a TOML file and add its graph
+    /**
+     * \returns 0 on success
+     * \returns -1 on error
+     */
+    int loadTOMLFile( const std::string &fname /**< [in] the path of the file */ );
 
-    int loadTOMLFile( const std::string &fname );
+  protected:
+    /// Parse one put table and add it to the builder
+    /**
+     * \returns 0 on success
+     * \returns -1 on error
+     */
+    int parseTOMLPut( instGraphBuilder &builder, /**< [in/out] the builder to add the put to */
+                      const std::string &node,   /**< [in] the name of the put's node */
+                      ioDir io,                  /**< [in] the direction of the put */
+                      toml::v3::node &put        /**< [in] the put table */
+    );
 
 }; // class instGraphTOML
 
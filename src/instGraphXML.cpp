@@ -1,7 +1,11 @@
-#include <iostream>
 #include <vector>
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
 
 #include "instGraphXML.hpp"
+#include "instGraphBuilder.hpp"
+#include "instTrace.hpp"
 
 #define PUGIXML_HEADER_ONLY
 #include "pugixml/pugixml.hpp"
@@ -438,9 +442,94 @@ struct find_mxGraph : pugi::xml_tree_walker
     }
 };
 
+/// The serialized document and the layout of its dynamic fields, for patch mode.
+struct instGraphXML::patchTable
+{
+    struct field
+    {
+        pugi::xml_attribute attr;           ///< The attribute whose value fills this field
+        char pad{ ' ' };                    ///< The character used to pad the value to the field width
+        size_t width{ 0 };                  ///< The width of the field in bytes
+        size_t offset{ std::string::npos }; ///< The offset of the field in buffer
+        bool dirty{ false };                ///< Whether this field is in the dirty list
+    };
+
+    std::string buffer;        ///< The serialized document
+
+    std::vector<field> fields; ///< The dynamic fields in buffer
+
+    std::vector<size_t> dirty; ///< Indices of the fields changed since the last save
+
+    bool valid{ false };       ///< False if the document needs to be laid out again
+
+    void mark( size_t f )
+    {
+        if( !valid || f >= fields.size() || fields[f].dirty )
+        {
+            return;
+        }
+
+        fields[f].dirty = true;
+        dirty.push_back( f );
+    }
+};
+
+// pugi::xml_writer which appends to a string
+struct stringWriter : pugi::xml_writer
+{
+    std::string *out{ nullptr };
+
+    virtual void write( const void *data, size_t size )
+    {
+        out->append( static_cast<const char *>( data ), size );
+    }
+};
+
+// Escape an attribute value for writing directly into the serialized document
+void escapeAttr( std::string &out, const char *val )
+{
+    out.clear();
+
+    for( const char *p = val; *p != '\0'; ++p )
+    {
+        switch( *p )
+        {
+        case '&':
+            out += "&amp;";
+            break;
+        case '<':
+            out += "&lt;";
+            break;
+        case '>':
+            out += "&gt;";
+            break;
+        case '"':
+            out += "&quot;";
+            break;
+        default:
+            // Control characters, including newlines and tabs, are written as two digit character references
+            // exactly as pugixml writes them
+            if( static_cast<unsigned char>( *p ) < 0x20 )
+            {
+                unsigned char ch = *p;
+                out += "&#";
+                out += static_cast<char>( '0' + ch / 10 );
+                out += static_cast<char>( '0' + ch % 10 );
+                out += ';';
+            }
+            else
+            {
+                out += *p;
+            }
+        }
+    }
+}
+
 instGraphXML::instGraphXML()
 {
     m_doc = new pugi::xml_document;
+    m_patch = std::make_unique<patchTable>();
+    m_fileSink.path( m_outputPath );
 }
 
 instGraphXML::~instGraphXML()
@@ -493,18 +582,12 @@ instGraphXML::~instGraphXML()
 #define MXGPARSE_ERR_DOC_CE ( -510 )
 #define MXGPARSE_ERR_DOC_SE ( -515 )
 #define MXGPARSE_ERR_DOC_OLDN ( -520 )
-
-struct egData
-{
-    std::string name;
-    std::string type;
-    std::string payload;
-    pugi::xml_node *node {nullptr};
-};
+#define MXGPARSE_ERR_DOC_BUILD ( -525 )
 
 int instGraphXML::parseXMLDoc( std::string &emsg )
 {
-    std::vector<egData> extras;
+    m_patch->valid = false;
+    m_extras.clear();
 
     find_mxGraph mxGraph;
     m_doc->traverse( mxGraph );
@@ -523,6 +606,22 @@ int instGraphXML::parseXMLDoc( std::string &emsg )
         return MXGPARSE_ERR_DOC_NOROOT;
     }
 
+    // Cells can appear in any order, so the graph is built once all have been parsed
+    instGraphBuilder builder;
+
+    // A put's node is created even if it has no cell of its own
+    std::unordered_set<std::string> cellNodes;
+    std::unordered_set<std::string> putNodes;
+
+    // On error, the gui data given to the builder isn't attached to anything yet
+    auto discard = [&builder]()
+    {
+        for( void *ad : builder.auxData() )
+        {
+            delete static_cast<guiData *>( ad );
+        }
+    };
+
     for( pugi::xml_node cell : root.children( "mxCell" ) )
     {
         pugi::xml_attribute id = cell.attribute( "id" );
@@ -535,6 +634,7 @@ int instGraphXML::parseXMLDoc( std::string &emsg )
         if( value.length() < 1 )
         {
             emsg = "mxCell with empty id (length 0)";
+            discard();
             return MXGPARSE_ERR_DOC_CE;
         }
 
@@ -548,9 +648,22 @@ int instGraphXML::parseXMLDoc( std::string &emsg )
         if( fc == 0 || fc == value.length() ) // starts or ends with :
         {
             emsg = "mxCell id starts or ends with ':'. (id=\"" + value + "\")";
+            discard();
             return MXGPARSE_ERR_DOC_SE;
         }
 
+        // Parse errors are reported with the id of the cell, since the name may not have been parsed
+        auto parseError = [&]( const char *kind )
+        {
+            diagnostics()->report( severity::error,
+                                   "instGraphXML",
+                                   0,
+                                   0,
+                                   0,
+                                   [&]
+                                   { return std::string( "error parsing " ) + kind + " \"" + value + "\": " + emsg; } );
+        };
+
         if( value[0] == 'n' )
         {
             std::string name;
@@ -558,19 +671,13 @@ int instGraphXML::parseXMLDoc( std::string &emsg )
             int ec = parseNode( name, emsg, value, fc );
             if( ec < 0 )
             {
-                std::cerr << "Error parsing node " << name << ": " << emsg << " (" << ec << ")\n";
-
+                parseError( "node" );
+                discard();
                 return ec;
             }
 
-            instNode *newNode = new instNode( name );
-
-            std::pair<nodeMapT::iterator, bool> nodeRes = m_nodes.emplace( name, newNode );
-            ///\todo result check
-
-            guiData *gd = new guiData( cell );
-
-            newNode->auxData( gd );
+            builder.addNode( name, new guiData( cell ) );
+            cellNodes.insert( name );
         }
         else if( value[0] == 'o' || value[0] == 'i' )
         {
@@ -582,25 +689,13 @@ int instGraphXML::parseXMLDoc( std::string &emsg )
             int ec = parsePut( dir, type, node, name, emsg, value, fc );
             if( ec < 0 )
             {
+                parseError( "put" );
+                discard();
                 return ec;
             }
 
-            if( m_nodes.count( node ) == 0 ) // node might not exist b/c it hasn't been parsed yet
-            {
-                instNode *newNode = new instNode( node );
-
-                std::pair<nodeMapT::iterator, bool> nodeRes = m_nodes.emplace( node, newNode );
-            }
-
-            instNode *newNode = m_nodes[node];
-
-            instIOPut *newPut = new instIOPut( { newNode, dir, name, type, nullptr } );
-            newNode->addIOPut( newPut );
-            newPut->parentGraph( this ); ///\todo we need a single way to do this all
-
-            // pugi::xml_node * xn = new pugi::xml_node(cell);
-            guiData *gd = new guiData( cell );
-            newPut->auxData( gd );
+            builder.addPut( node, dir, name, type, "", new guiData( cell ) );
+            putNodes.insert( node );
         }
         else if( value[0] == 'b' )
         {
@@ -617,91 +712,12 @@ int instGraphXML::parseXMLDoc( std::string &emsg )
 
             if( ec < 0 )
             {
+                parseError( "beam" );
+                discard();
                 return ec;
             }
 
-            instBeam *newBeam = new instBeam;
-            std::pair<beamMapT::iterator, bool> beamRes = m_beams.emplace( name, newBeam );
-            newBeam->name( name );
-            newBeam->parentGraph( this ); ///\todo we need a single way to do this all
-
-            if( m_nodes.count( outNode ) > 0 )
-            {
-                if( !m_nodes[outNode]->outputValid( outName ) )
-                {
-                    std::string msg = "node \"";
-                    msg += outNode + "\"";
-                    msg += " has no ouput \"";
-                    msg += outName + "\"";
-                    msg += " for beam id \"";
-                    msg += value + "\".  Beams must be at end of drawio file!";
-                    msg += " (ingr::instGraphXML::parseXMLDoc ";
-                    msg += __FILE__;
-                    msg += " ";
-                    msg += std::to_string( __LINE__ );
-                    msg += ")";
-                    throw std::runtime_error( msg );
-                }
-
-                m_nodes[outNode]->output( outName )->beam( newBeam );
-            }
-            else
-            {
-                std::string msg = "node \"";
-                msg += outNode + "\"";
-                msg += " not found for beam id \"";
-                msg += value + "\".  Beams must be at end of drawio file!";
-                msg += " (ingr::instGraphXML::parseXMLDoc ";
-                msg += __FILE__;
-                msg += " ";
-                msg += std::to_string( __LINE__ );
-                msg += ")";
-
-                throw std::runtime_error( msg );
-            }
-
-            newBeam->source( m_nodes[outNode]->output( outName ) );
-
-            if( m_nodes.count( inNode ) > 0 )
-            {
-                if( !m_nodes[inNode]->inputValid( inName ) )
-                {
-                    std::string msg = "node \"";
-                    msg += inNode + "\"";
-                    msg += " has no input \"";
-                    msg += inName + "\"";
-                    msg += " for beam id \"";
-                    msg += value + "\".  Beams must be at end of drawio file!";
-                    msg += " (ingr::instGraphXML::parseXMLDoc ";
-                    msg += __FILE__;
-                    msg += " ";
-                    msg += std::to_string( __LINE__ );
-                    msg += ")";
-                    throw std::runtime_error( msg );
-                }
-
-                m_nodes[inNode]->input( inName )->beam( newBeam );
-            }
-            else
-            {
-                std::string msg = "node \"";
-                msg += inNode + "\"";
-                msg += " not found for beam id \"";
-                msg += value + "\".  Beams must be at end of drawio file!";
-                msg += " (ingr::instGraphXML::parseXMLDoc ";
-                msg += __FILE__;
-                msg += " ";
-                msg += std::to_string( __LINE__ );
-                msg += ")";
-
-                throw std::runtime_error( msg );
-            }
-
-            newBeam->dest( m_nodes[inNode]->input( inName ) );
-
-            guiData *gd = new guiData( cell );
-            // pugi::xml_node * xn = new pugi::xml_node(cell);
-            newBeam->auxData( gd );
+            builder.addBeam( name, outNode, outName, inNode, inName, new guiData( cell ) );
         }
         else if( value[0] == 'l' ) //a link
         {
@@ -719,15 +735,20 @@ int instGraphXML::parseXMLDoc( std::string &emsg )
 
             if( ec < 0 )
             {
+                parseError( "link" );
+                discard();
                 return ec;
             }
 
             if( outNode != inNode )
             {
                 emsg = "output link has different nodes for source and target ':'. (id=\"" + value + "\")";
+                parseError( "link" );
+                discard();
                 return MXGPARSE_ERR_DOC_OLDN;
             }
-            m_nodes[inNode]->input( inName )->outputLink( outName );
+
+            builder.addOutputLink( inNode, inName, outName );
 
             m_outputLinks.insert( std::pair( value, std::make_shared<guiData>( cell ) ) );
         }
@@ -749,56 +770,60 @@ int instGraphXML::parseXMLDoc( std::string &emsg )
                 payload = value.substr( ec + 1, value.size() - ( fc + 1 ) );
             }
 
-            extras.emplace_back();
-            extras.back().name = name;
-            extras.back().type = type;
-            extras.back().payload = payload;
-            extras.back().node = new pugi::xml_node(cell); //Construct
+            m_extras.push_back( { name, type, payload, guiData( cell ) } );
 
         }
     }
 
-    for( auto &node : m_nodes )
+    for( auto &&node : putNodes )
     {
-        if( !node.second->auxDataValid() )
+        if( cellNodes.count( node ) == 0 )
         {
-            std::string msg = "instGraphXML::parseXMLDoc: Node ";
-            msg += node.second->name() + " was not found in the XML but it was referred to.";
-            throw std::runtime_error( msg );
+            builder.addNode( node );
         }
     }
 
-    for( auto &&nn : m_nodes )
+    if( builder.build( emsg, *this ) < 0 )
     {
-        nn.second->updateOutputLinks();
+        discard();
+        return MXGPARSE_ERR_DOC_BUILD;
     }
 
-    for( auto &extra : extras )
+    // Drop extras whose node doesn't exist, then sort so each (node, type) is contiguous
+    instDiagnostics *diag = diagnostics();
+
+    auto orphan = [this, diag]( const extraGuiData &extra )
     {
-        if( m_nodes.count( extra.name ) > 0 )
+        if( m_nodes.count( extra.node ) == 0 )
         {
-            //std::cerr << "Found extra: " << extra.type << " for " << extra.name << ": " << extra.payload << "\n";
+            diag->report( severity::warning,
+                          "instGraphXML",
+                          0,
+                          0,
+                          0,
+                          [&] { return "no node for extra: " + extra.type + " for " + extra.node + " " + extra.payload; } );
+            return true;
+        }
 
-            if( !m_nodes[extra.name]->auxDataValid() )
-            {
-                std::cerr << "no valid auxData for " << extra.name << "\n";
-                continue;
-            }
-            guiData *gd = static_cast<guiData *>( m_nodes[extra.name]->auxData() );
+        return false;
+    };
 
-            extraGuiData egd; // = new extraGuiData;
-            egd.payload = extra.payload;
-            egd.gdata = std::make_shared<guiData>( extra.node );
+    m_extras.erase( std::remove_if( m_extras.begin(), m_extras.end(), orphan ), m_extras.end() );
 
-            gd->extraData.insert( { extra.type, egd } );
-        }
-        else
-        {
-            std::cerr << "No node for extra: " << extra.type << " for " << extra.name << " " << extra.payload << "\n";
+    std::stable_sort( m_extras.begin(),
+                      m_extras.end(),
+                      []( const extraGuiData &a, const extraGuiData &b )
+                      {
+                          int c = a.node.compare( b.node );
+                          return ( c < 0 ) || ( c == 0 && a.type < b.type );
+                      } );
+
+    buildValueIndex();
+
+    diag->report( severity::info, "instGraphXML", 0, 0, m_nodes.size(), [] { return std::string( "nodes loaded" ); } );
+    diag->report( severity::info, "instGraphXML", 0, 0, m_beams.size(), [] { return std::string( "beams loaded" ); } );
+    diag->report( severity::info, "instGraphXML", 0, 0, m_extras.size(), [] { return std::string( "extras loaded" ); } );
 
-            delete extra.node;
-        }
-    }
     return 0;
 }
 
@@ -828,382 +853,922 @@ const std::string &instGraphXML::outputPath()
 void instGraphXML::outputPath( const std::string &op )
 {
     m_outputPath = op;
+    m_fileSink.path( m_outputPath );
 }
 
-void instGraphXML::stateChange()
+bool instGraphXML::patchMode()
 {
-    for( auto it : m_beams )
-    {
-        if( it.second->auxDataValid() )
-        {
-            auxDataT *auxData = static_cast<auxDataT *>( it.second->auxData() );
-            if( it.second->state() == beamState::on )
-            {
-                auxData->strokeColor( m_colorOn );
-                auxData->fontColor( m_colorOn );
-            }
-            else if( it.second->state() == beamState::intermediate )
-            {
-                auxData->strokeColor( m_colorInt );
-                auxData->fontColor( m_colorInt );
-            }
-            else if( it.second->state() == beamState::off )
-            {
-                auxData->strokeColor( m_colorOff );
-                auxData->fontColor( m_colorOff );
-            }
-        }
-    }
-
-    for( auto it : m_nodes )
-    {
-        for( auto iit : it.second->inputs() )
-        {
-            if( iit.second->auxDataValid() )
-            {
-                auxDataT *auxData = static_cast<auxDataT *>( iit.second->auxData() );
+    return m_patchMode;
+}
 
-                if( iit.second->state() == putState::on )
-                {
-                    auxData->strokeColor( m_colorOn );
-                    auxData->fontColor( m_colorOn );
-                }
-                else if( iit.second->state() == putState::waiting )
-                {
-                    auxData->strokeColor( m_colorInt );
-                    auxData->fontColor( m_colorInt );
-                }
-                else if( iit.second->state() == putState::off )
-                {
-                    auxData->strokeColor( m_colorOff );
-                    auxData->fontColor( m_colorOff );
-                }
-            }
-        }
+void instGraphXML::patchMode( bool pm )
+{
+    m_patchMode = pm;
 
-        for( auto oit : it.second->outputs() )
-        {
-            if( oit.second->auxDataValid() )
-            {
-                auxDataT *auxData = static_cast<auxDataT *>( oit.second->auxData() );
+    m_patch->valid = false;
+    m_patch->dirty.clear();
+    m_patch->fields.clear();
+    m_patch->buffer.clear();
+}
 
-                if( oit.second->state() == putState::on )
-                {
-                    auxData->strokeColor( m_colorOn );
-                    auxData->fontColor( m_colorOn );
-                }
-                else if( oit.second->state() == putState::waiting )
-                {
-                    auxData->strokeColor( m_colorInt );
-                    auxData->fontColor( m_colorInt );
-                }
-                else if( oit.second->state() == putState::off )
-                {
-                    auxData->strokeColor( m_colorOff );
-                    auxData->fontColor( m_colorOff );
-                }
-            }
-        }
-    }
+size_t instGraphXML::patchValueWidth()
+{
+    return m_patchValueWidth;
+}
 
-    m_doc->save_file( m_outputPath.c_str() );
+void instGraphXML::patchValueWidth( size_t pvw )
+{
+    m_patchValueWidth = pvw;
 }
 
-///\todo make this use ioDIR
-void instGraphXML::valuePut( const std::string &node, const std::string &put, const ioDir &dir, const std::string &val )
+void instGraphXML::addSink( const std::shared_ptr<instGraphXMLSink> &sink )
 {
-    if( !m_nodes.count( node ) == 1 )
+    if( !sink )
     {
-        return;
+        throw std::invalid_argument( "instGraphXML::addSink: sink is null" );
     }
 
-    instNode *nptr;
+    m_sinks.push_back( sink );
+}
 
-    try
-    {
-        nptr = instGraph::node( node );
-    }
-    catch( ... )
-    {
-        return;
-    }
+void instGraphXML::removeSink( const std::shared_ptr<instGraphXMLSink> &sink )
+{
+    m_sinks.erase( std::remove( m_sinks.begin(), m_sinks.end(), sink ), m_sinks.end() );
+}
 
-    instIOPut *pptr;
-    try
-    {
-        if( dir == ioDir::input )
-        {
-            pptr = nptr->input( put );
-        }
-        else
-        {
-            pptr = nptr->output( put );
-        }
-    }
-    catch( ... )
-    {
-        return;
-    }
+void instGraphXML::clearSinks()
+{
+    m_sinks.clear();
+}
 
-    if( !pptr->auxDataValid() )
+std::span<const char> instGraphXML::lastRender()
+{
+    if( m_patchMode )
     {
-        return;
+        return { m_patch->buffer.data(), m_patch->buffer.size() };
     }
 
-    static_cast<auxDataT *>( pptr->auxData() )->value( val );
+    return { m_render.data(), m_render.size() };
+}
 
-    m_doc->save_file( m_outputPath.c_str() );
+uint64_t instGraphXML::renderGeneration()
+{
+    return m_renderGen;
 }
 
-void instGraphXML::valueExtra( const std::string &node, const std::string &extra, const std::string &val )
+void instGraphXML::save()
 {
-    if( !m_nodes.count( node ) == 1 )
-    {
-        return;
-    }
+    INGR_TRACE_SCOPE( xmlSave, this );
+
+    m_metrics.count( metricCounter::saves );
+    metricTimer timer( &m_metrics, metricHistogram::save );
+
+    renderView rv;
 
-    instNode *nptr;
+    std::vector<std::pair<size_t, size_t>> ranges;
 
-    try
+    if( m_patchMode )
     {
-        nptr = instGraph::node( node );
+        patchTable &pt = *m_patch;
+
+        if( pt.valid )
+        {
+            if( pt.dirty.empty() && m_renderGen > 0 )
+            {
+                return; // nothing changed
+            }
+
+            ranges.reserve( pt.dirty.size() );
+
+            for( size_t f : pt.dirty )
+            {
+                pt.fields[f].dirty = false;
+
+                if( !patchFill( f ) )
+                {
+                    pt.valid = false; // doesn't fit, start over
+                    break;
+                }
+
+                ranges.push_back( { pt.fields[f].offset, pt.fields[f].width } );
+            }
+
+            pt.dirty.clear();
+        }
+
+        if( !pt.valid )
+        {
+            patchLayout();
+            ranges.clear();
+        }
+
+        std::sort( ranges.begin(), ranges.end() );
+        rv.dirty = ranges;
     }
-    catch( ... )
+    else
     {
-        return;
-    }
+        m_renderNext.clear();
+        stringWriter sw;
+        sw.out = &m_renderNext;
+        m_doc->save( sw );
 
-    if( !nptr->auxDataValid() )
-    {
-        return;
+        if( m_renderNext == m_render && m_renderGen > 0 )
+        {
+            return; // nothing changed
+        }
+
+        m_render.swap( m_renderNext );
     }
 
-    auxDataT * ad = static_cast<auxDataT *>( nptr->auxData() );
+    ++m_renderGen;
+
+    rv.doc = lastRender();
+    rv.generation = m_renderGen;
+
+    m_metrics.stage( metricHistogram::cascadeToSave );
 
-    if(ad->extraData.count(extra) == 0)
+    INGR_TRACE_SCOPE( xmlPublish, this );
+
+    if( m_outputPath != "" )
     {
-        return;
+        m_fileSink.publish( rv );
     }
 
-    auto edL = ad->extraData.lower_bound(extra);
-    auto edU = ad->extraData.upper_bound(extra);
-    while(edL != edU)
+    for( auto &sink : m_sinks )
     {
-        edL->second.gdata->value( val );
-        ++edL;
+        sink->publish( rv );
     }
 
-    m_doc->save_file( m_outputPath.c_str() );
+    m_metrics.stage( metricHistogram::cascadeToPublish );
 }
 
-void instGraphXML::hideLinks()
+void instGraphXML::patchLayout()
 {
-    for( auto &lit : m_outputLinks )
-    {
-        lit.second->opacity( 0 );
-    }
-}
+    patchTable &pt = *m_patch;
+
+    pt.valid = false;
+    pt.fields.clear();
+    pt.dirty.clear();
+
+    // Collect the gui data for every entity
+    std::vector<guiData *> gds;
 
-void instGraphXML::hidePuts()
-{
     for( auto &nit : m_nodes )
     {
+        if( nit.second->auxDataValid() )
+        {
+            gds.push_back( static_cast<guiData *>( nit.second->auxData() ) );
+        }
+
         for( auto &pit : nit.second->inputs() )
         {
             if( pit.second->auxDataValid() )
             {
-                guiData *gd = static_cast<guiData *>( pit.second->auxData() );
-                gd->opacity( 0 );
-                gd->textOpacity( 0 );
+                gds.push_back( static_cast<guiData *>( pit.second->auxData() ) );
             }
         }
-    }
 
-    for( auto &nit : m_nodes )
-    {
         for( auto &pit : nit.second->outputs() )
         {
             if( pit.second->auxDataValid() )
             {
-                guiData *gd = static_cast<guiData *>( pit.second->auxData() );
-                gd->opacity( 0 );
-                gd->textOpacity( 0 );
+                gds.push_back( static_cast<guiData *>( pit.second->auxData() ) );
             }
         }
     }
-}
-
-instGraphXML::guiData::guiData( pugi::xml_node *xn )
-{
-    xmlNode = xn;
-    findColors();
-}
-
-instGraphXML::guiData::guiData( const pugi::xml_node &xn )
-{
-    xmlNode = new pugi::xml_node( xn );
-    findColors();
-}
-
-instGraphXML::guiData::~guiData()
-{
-    if( xmlNode != nullptr )
-    {
-        delete xmlNode;
-    }
-}
 
-void instGraphXML::guiData::findColors()
-{
-    if( xmlNode == nullptr )
+    for( auto &bit : m_beams )
     {
-        styleValue = "";
-        strokeColorPos.clear();
-        fontColorPos.clear();
-        opacityPos.clear();
-        textOpacityPos.clear();
-        return;
+        if( bit.second->auxDataValid() )
+        {
+            gds.push_back( static_cast<guiData *>( bit.second->auxData() ) );
+        }
     }
 
-    pugi::xml_attribute style = xmlNode->attribute( "style" );
-
-    if( !style.empty() )
-    {
-        styleValue = style.value();
-
-        strokeColorPos.findKey( styleValue, "strokeColor" );
-        fontColorPos.findKey( styleValue, "fontColor" );
-        opacityPos.findKey( styleValue, "opacity" );
-        textOpacityPos.findKey( styleValue, "textOpacity" );
-    }
-    else
+    for( auto &lit : m_outputLinks )
     {
-        styleValue = "";
-        strokeColorPos.clear();
-        fontColorPos.clear();
-        opacityPos.clear();
-        textOpacityPos.clear();
+        gds.push_back( lit.second.get() );
     }
-}
 
-void instGraphXML::guiData::strokeColor( const std::string &color )
-{
-    if( xmlNode == nullptr )
+    for( auto &extra : m_extras )
     {
-        std::string msg = "instGraphXML::guiData::strokeColor: xmlNode null";
-        throw std::runtime_error( msg );
+        gds.push_back( &extra.gdata );
     }
 
-    pugi::xml_attribute style = xmlNode->attribute( "style" );
-
-    if( style.empty() )
-    {
-        std::string msg = "instGraphXML::guiData::strokeColor: no `style` attribute";
-        throw std::runtime_error( msg );
-    }
+    // Size a field for each style and value attribute
+    std::string esc;
 
-    // Add it if it doesn't exist
-    if( strokeColorPos.keyPos == std::string::npos )
+    for( guiData *gd : gds )
     {
-        styleValue += std::string("strokeColor=") + m_defaultColor + ";";
-        style.set_value( styleValue.c_str() );
-        findColors();
+        gd->patch = &pt;
+        gd->styleField = std::string::npos;
+        gd->valueField = std::string::npos;
 
-        if( strokeColorPos.keyPos == std::string::npos )
+        if( gd->xmlNode == nullptr )
         {
-            std::string msg = "Unable to add strokeColor to style attribute";
+            continue;
+        }
+
+        if( gd->styleAttr != nullptr )
+        {
+            escapeAttr( esc, gd->styleAttribute().value() );
+            size_t w = esc.size();
+
+            if( gd->stateStylesGen != -1 )
+            {
+                for( auto &ss : gd->stateStyles )
+                {
+                    escapeAttr( esc, ss.c_str() );
+                    w = std::max( w, esc.size() );
+                }
+            }
+
+            gd->styleField = pt.fields.size();
+            pt.fields.push_back( { gd->styleAttribute(), ';', w + m_patchStyleSlack } );
+        }
+
+        pugi::xml_attribute value = gd->node().attribute( "value" );
+        if( !value.empty() )
+        {
+            escapeAttr( esc, value.value() );
+
+            gd->valueField = pt.fields.size();
+            pt.fields.push_back( { value, ' ', std::max( esc.size(), m_patchValueWidth ) } );
+        }
+    }
+
+    // Serialize with a unique placeholder in each field
+    static constexpr char marker[] = "@@ingr#";
+    static constexpr size_t markerLen = sizeof( marker ) - 1;
+
+    std::vector<std::string> saved( pt.fields.size() );
+    std::string ph;
+
+    for( size_t f = 0; f < pt.fields.size(); ++f )
+    {
+        saved[f] = pt.fields[f].attr.value();
+
+        ph = marker + std::to_string( f ) + "#";
+        pt.fields[f].attr.set_value( ph.c_str() );
+    }
+
+    std::string raw;
+    stringWriter sw;
+    sw.out = &raw;
+    m_doc->save( sw );
+
+    for( size_t f = 0; f < pt.fields.size(); ++f )
+    {
+        pt.fields[f].attr.set_value( saved[f].c_str() );
+    }
+
+    // Copy the document into the buffer, replacing each placeholder with its field at full width
+    pt.buffer.clear();
+    pt.buffer.reserve( raw.size() );
+
+    size_t start = 0;
+    size_t pos = 0;
+    while( ( pos = raw.find( marker, pos ) ) != std::string::npos )
+    {
+        size_t f = strtoul( raw.c_str() + pos + markerLen, nullptr, 10 );
+
+        if( f < pt.fields.size() )
+        {
+            ph = marker + std::to_string( f ) + "#";
+        }
+
+        // Text which only starts like a placeholder, e.g. in a label, is left as is
+        if( f >= pt.fields.size() || pos + ph.size() > raw.size() ||
+            memcmp( raw.data() + pos, ph.data(), ph.size() ) != 0 )
+        {
+            pos += markerLen;
+            continue;
+        }
+
+        if( pt.fields[f].offset != std::string::npos )
+        {
+            std::string msg = "field " + std::to_string( f ) + " found twice in serialized document";
+            msg += " (ingr::instGraphXML::patchLayout ";
+            msg += __FILE__;
+            msg += " ";
+            msg += std::to_string( __LINE__ );
+            msg += ")";
+            throw std::runtime_error( msg );
+        }
+
+        pt.buffer.append( raw, start, pos - start );
+        pt.fields[f].offset = pt.buffer.size();
+        pt.buffer.append( pt.fields[f].width, pt.fields[f].pad );
+
+        pos += ph.size();
+        start = pos;
+    }
+
+    pt.buffer.append( raw, start, std::string::npos );
+
+    for( size_t f = 0; f < pt.fields.size(); ++f )
+    {
+        if( pt.fields[f].offset == std::string::npos || !patchFill( f ) )
+        {
+            std::string msg = "field " + std::to_string( f ) + " not found in serialized document";
+            msg += " (ingr::instGraphXML::patchLayout ";
+            msg += __FILE__;
+            msg += " ";
+            msg += std::to_string( __LINE__ );
+            msg += ")";
             throw std::runtime_error( msg );
         }
     }
 
-    bool szch = strokeColorPos.setValue( styleValue, color );
+    pt.valid = true;
+}
+
+bool instGraphXML::patchFill( size_t f )
+{
+    patchTable::field &fld = m_patch->fields[f];
 
-    style.set_value( styleValue.c_str() );
+    static thread_local std::string esc;
+    escapeAttr( esc, fld.attr.value() );
 
-    if( szch )
+    if( esc.size() > fld.width )
     {
-        return findColors();
+        return false;
     }
+
+    char *dst = m_patch->buffer.data() + fld.offset;
+    memcpy( dst, esc.data(), esc.size() );
+    memset( dst + esc.size(), fld.pad, fld.width - esc.size() );
+
+    return true;
 }
 
-void instGraphXML::guiData::fontColor( const std::string &color )
+const std::string &instGraphXML::colorOff()
 {
-    if( xmlNode == nullptr )
+    return m_colorOff;
+}
+
+void instGraphXML::colorOff( const std::string &c )
+{
+    m_colorOff = c;
+    ++m_colorGen;
+}
+
+const std::string &instGraphXML::colorInt()
+{
+    return m_colorInt;
+}
+
+void instGraphXML::colorInt( const std::string &c )
+{
+    m_colorInt = c;
+    ++m_colorGen;
+}
+
+const std::string &instGraphXML::colorOn()
+{
+    return m_colorOn;
+}
+
+void instGraphXML::colorOn( const std::string &c )
+{
+    m_colorOn = c;
+    ++m_colorGen;
+}
+
+void instGraphXML::stateKey( const std::string &key,
+                             const std::string &offVal,
+                             const std::string &intVal,
+                             const std::string &onVal )
+{
+    for( auto &sk : m_stateKeys )
     {
-        std::string msg = "instGraphXML::guiData::fontColor: xmlNode null";
-        throw std::runtime_error( msg );
+        if( sk.key == key )
+        {
+            sk.values[0] = offVal;
+            sk.values[1] = intVal;
+            sk.values[2] = onVal;
+            ++m_colorGen;
+            return;
+        }
     }
 
-    pugi::xml_attribute style = xmlNode->attribute( "style" );
+    m_stateKeys.push_back( { key, { offVal, intVal, onVal } } );
+    ++m_colorGen;
+}
 
-    if( style.empty() )
+int instGraphXML::styleIndex( putState st )
+{
+    if( st == putState::on )
     {
-        std::string msg = "instGraphXML::guiData::fontColor: no `style` attribute";
-        throw std::runtime_error( msg );
+        return 2;
+    }
+    else if( st == putState::waiting )
+    {
+        return 1;
     }
 
-    // Add it if it doesn't exist
-    if( fontColorPos.keyPos == std::string::npos )
+    return 0;
+}
+
+int instGraphXML::styleIndex( beamState st )
+{
+    if( st == beamState::on )
+    {
+        return 2;
+    }
+    else if( st == beamState::intermediate )
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+void instGraphXML::restyle( auxDataT *auxData, int st )
+{
+    if( auxData->stateStylesGen != m_colorGen )
     {
-        styleValue += std::string("fontColor=") + m_defaultColor + ";";
-        style.set_value( styleValue.c_str() );
-        findColors();
+        auxData->buildStateStyles( m_colorOff, m_colorInt, m_colorOn, m_stateKeys, m_colorGen );
+    }
 
-        if( fontColorPos.keyPos == std::string::npos )
+    auxData->stateStyle( st );
+}
+
+void instGraphXML::stateChange()
+{
+    INGR_TRACE_SCOPE( graphStateChange, this );
+
+    {
+        metricTimer timer( &m_metrics, metricHistogram::render );
+
+        for( auto it : m_beams )
         {
-            std::string msg = "Unable to add fontColor to style attribute";
-            throw std::runtime_error( msg );
+            if( it.second->auxDataValid() )
+            {
+                restyle( static_cast<auxDataT *>( it.second->auxData() ), styleIndex( it.second->state() ) );
+            }
+        }
+
+        for( auto it : m_nodes )
+        {
+            for( auto iit : it.second->inputs() )
+            {
+                if( iit.second->auxDataValid() )
+                {
+                    restyle( static_cast<auxDataT *>( iit.second->auxData() ), styleIndex( iit.second->state() ) );
+                }
+            }
+
+            for( auto oit : it.second->outputs() )
+            {
+                if( oit.second->auxDataValid() )
+                {
+                    restyle( static_cast<auxDataT *>( oit.second->auxData() ), styleIndex( oit.second->state() ) );
+                }
+            }
         }
     }
 
-    bool szch = fontColorPos.setValue( styleValue, color );
+    m_metrics.stage( metricHistogram::cascadeToRender );
 
-    style.set_value( styleValue.c_str() );
+    save();
+}
 
-    if( szch )
+size_t instGraphXML::addValueSlot( valueTarget target, const std::string &node, const std::string &name )
+{
+    auto nit = m_valueNodes.try_emplace( node, m_valueNames.size() ).first;
+    if( nit->second == m_valueNames.size() )
     {
-        return findColors();
+        m_valueNames.emplace_back();
     }
+
+    size_t slot = m_valueSlots.size();
+    m_valueNames[nit->second][static_cast<int>( target )][name] = slot;
+    m_valueSlots.emplace_back();
+
+    return slot;
 }
 
-void instGraphXML::guiData::opacity( int op )
+void instGraphXML::buildValueIndex()
+{
+    m_valueSlots.clear();
+    m_valueNodes.clear();
+    m_valueNames.clear();
+
+    for( auto &nit : m_nodes )
+    {
+        for( auto &pit : nit.second->inputs() )
+        {
+            if( pit.second->auxDataValid() )
+            {
+                size_t slot = addValueSlot( valueTarget::input, nit.first, pit.first );
+                m_valueSlots[slot].put = static_cast<guiData *>( pit.second->auxData() );
+            }
+        }
+
+        for( auto &pit : nit.second->outputs() )
+        {
+            if( pit.second->auxDataValid() )
+            {
+                size_t slot = addValueSlot( valueTarget::output, nit.first, pit.first );
+                m_valueSlots[slot].put = static_cast<guiData *>( pit.second->auxData() );
+            }
+        }
+    }
+
+    // m_extras is sorted, so each (node, type) is a contiguous range
+    size_t n = 0;
+    while( n < m_extras.size() )
+    {
+        size_t e = n + 1;
+        while( e < m_extras.size() && m_extras[e].node == m_extras[n].node && m_extras[e].type == m_extras[n].type )
+        {
+            ++e;
+        }
+
+        size_t slot = addValueSlot( valueTarget::extra, m_extras[n].node, m_extras[n].type );
+        m_valueSlots[slot].extraBegin = n;
+        m_valueSlots[slot].extraEnd = e;
+
+        n = e;
+    }
+}
+
+size_t instGraphXML::findValueSlot( valueTarget target, std::string_view node, std::string_view name ) const
+{
+    auto nit = m_valueNodes.find( node );
+    if( nit == m_valueNodes.end() )
+    {
+        return std::string::npos;
+    }
+
+    const nameIndex &names = m_valueNames[nit->second][static_cast<int>( target )];
+
+    auto it = names.find( name );
+    if( it == names.end() )
+    {
+        return std::string::npos;
+    }
+
+    return it->second;
+}
+
+const std::vector<instGraphXML::extraGuiData> &instGraphXML::extras()
+{
+    return m_extras;
+}
+
+std::span<instGraphXML::extraGuiData> instGraphXML::extras( const std::string &node, const std::string &type )
+{
+    size_t slot = findValueSlot( valueTarget::extra, node, type );
+    if( slot == std::string::npos )
+    {
+        return {};
+    }
+
+    const valueSlot &vs = m_valueSlots[slot];
+
+    return { m_extras.data() + vs.extraBegin, vs.extraEnd - vs.extraBegin };
+}
+
+///\todo make this use ioDIR
+void instGraphXML::valuePut( const std::string &node, const std::string &put, const ioDir &dir, const std::string &val )
+{
+    valueUpdate vu{ node, ( dir == ioDir::input ) ? valueTarget::input : valueTarget::output, put, val };
+
+    valueBatch( { &vu, 1 } );
+}
+
+void instGraphXML::valueExtra( const std::string &node, const std::string &extra, const std::string &val )
+{
+    valueUpdate vu{ node, valueTarget::extra, extra, val };
+
+    valueBatch( { &vu, 1 } );
+}
+
+instGraphXML::valueBatchResult instGraphXML::valueBatch( std::span<const valueUpdate> updates )
+{
+    valueBatchResult res;
+
+    for( auto &vu : updates )
+    {
+        size_t slot = ( vu.slot != std::string::npos ) ? vu.slot : findValueSlot( vu.target, vu.node, vu.name );
+
+        if( slot >= m_valueSlots.size() )
+        {
+            ++res.unknown;
+            continue;
+        }
+
+        const valueSlot &vs = m_valueSlots[slot];
+
+        bool changed = false;
+        if( vs.put != nullptr )
+        {
+            changed = vs.put->value( vu.value );
+        }
+        else
+        {
+            for( size_t n = vs.extraBegin; n < vs.extraEnd; ++n )
+            {
+                changed |= m_extras[n].gdata.value( vu.value );
+            }
+        }
+
+        if( changed )
+        {
+            ++res.applied;
+        }
+        else
+        {
+            ++res.unchanged;
+        }
+    }
+
+    if( res.applied > 0 )
+    {
+        save();
+    }
+
+    return res;
+}
+
+void instGraphXML::hideLinks()
+{
+    for( auto &lit : m_outputLinks )
+    {
+        lit.second->opacity( 0 );
+    }
+}
+
+void instGraphXML::hidePuts()
+{
+    for( auto &nit : m_nodes )
+    {
+        for( auto &pit : nit.second->inputs() )
+        {
+            if( pit.second->auxDataValid() )
+            {
+                guiData *gd = static_cast<guiData *>( pit.second->auxData() );
+                gd->opacity( 0 );
+                gd->textOpacity( 0 );
+            }
+        }
+    }
+
+    for( auto &nit : m_nodes )
+    {
+        for( auto &pit : nit.second->outputs() )
+        {
+            if( pit.second->auxDataValid() )
+            {
+                guiData *gd = static_cast<guiData *>( pit.second->auxData() );
+                gd->opacity( 0 );
+                gd->textOpacity( 0 );
+            }
+        }
+    }
+}
+
+void instGraphXML::styleTable::parse( const char *style )
+{
+    entries.clear();
+
+    if( style == nullptr )
+    {
+        return;
+    }
+
+    const char *p = style;
+    while( *p != '\0' )
+    {
+        const char *e = p;
+        const char *eq = nullptr;
+
+        while( *e != '\0' && *e != ';' )
+        {
+            if( *e == '=' && eq == nullptr )
+            {
+                eq = e;
+            }
+            ++e;
+        }
+
+        if( e > p ) // skip empty entries, e.g. from ";;"
+        {
+            entries.emplace_back();
+            if( eq != nullptr )
+            {
+                entries.back().key.assign( p, eq - p );
+                entries.back().value.assign( eq + 1, e - ( eq + 1 ) );
+            }
+            else
+            {
+                entries.back().key.assign( p, e - p );
+                entries.back().hasValue = false;
+            }
+        }
+
+        p = ( *e == ';' ) ? e + 1 : e;
+    }
+}
+
+size_t instGraphXML::styleTable::find( const std::string &key ) const
+{
+    for( size_t n = 0; n < entries.size(); ++n )
+    {
+        if( entries[n].key == key )
+        {
+            return n;
+        }
+    }
+
+    return std::string::npos;
+}
+
+size_t instGraphXML::styleTable::slot( const std::string &key, const std::string &def )
+{
+    size_t n = find( key );
+
+    if( n != std::string::npos )
+    {
+        return n;
+    }
+
+    entries.push_back( { key, def, true } );
+
+    return entries.size() - 1;
+}
+
+bool instGraphXML::styleTable::value( size_t slot, const std::string &value )
+{
+    if( slot >= entries.size() )
+    {
+        std::string msg = "instGraphXML::styleTable::value: invalid slot " + std::to_string( slot );
+        throw std::out_of_range( msg );
+    }
+
+    entry &ent = entries[slot];
+
+    if( ent.hasValue && ent.value == value )
+    {
+        return false;
+    }
+
+    ent.value = value;
+    ent.hasValue = true;
+
+    return true;
+}
+
+void instGraphXML::styleTable::serialize( std::string &style ) const
+{
+    style.clear();
+
+    for( auto &ent : entries )
+    {
+        style += ent.key;
+        if( ent.hasValue )
+        {
+            style += '=';
+            style += ent.value;
+        }
+        style += ';';
+    }
+}
+
+instGraphXML::guiData::guiData( const pugi::xml_node &xn )
+{
+    xmlNode = xn.internal_object();
+    styleAttr = xn.attribute( "style" ).internal_object();
+    parseStyle();
+}
+
+pugi::xml_node instGraphXML::guiData::node() const
+{
+    return pugi::xml_node( xmlNode );
+}
+
+pugi::xml_attribute instGraphXML::guiData::styleAttribute() const
+{
+    return pugi::xml_attribute( styleAttr );
+}
+
+void instGraphXML::guiData::parseStyle()
+{
+    if( styleAttr == nullptr )
+    {
+        style.entries.clear();
+    }
+    else
+    {
+        style.parse( styleAttribute().value() );
+    }
+
+    strokeColorSlot = style.find( "strokeColor" );
+    fontColorSlot = style.find( "fontColor" );
+    opacitySlot = style.find( "opacity" );
+    textOpacitySlot = style.find( "textOpacity" );
+}
+
+void instGraphXML::guiData::writeStyle()
+{
+    style.serialize( styleValue );
+    styleAttribute().set_value( styleValue.c_str() );
+    markDirty( styleField );
+}
+
+void instGraphXML::guiData::markDirty( size_t field )
+{
+    if( patch == nullptr || field == std::string::npos )
+    {
+        return;
+    }
+
+    patch->mark( field );
+}
+
+void instGraphXML::guiData::strokeColor( const std::string &color )
 {
     if( xmlNode == nullptr )
     {
-        std::string msg = "instGraphXML::guiData::opacity: xmlNode null";
+        std::string msg = "instGraphXML::guiData::strokeColor: xmlNode null";
         throw std::runtime_error( msg );
     }
 
-    pugi::xml_attribute style = xmlNode->attribute( "style" );
+    if( styleAttr == nullptr )
+    {
+        std::string msg = "instGraphXML::guiData::strokeColor: no `style` attribute";
+        throw std::runtime_error( msg );
+    }
+
+    syncStyle();
+
+    // Add it if it doesn't exist
+    if( strokeColorSlot == std::string::npos )
+    {
+        strokeColorSlot = style.slot( "strokeColor", m_defaultColor );
+    }
+
+    if( style.value( strokeColorSlot, color ) || currentStyle == -1 )
+    {
+        writeStyle();
+    }
+}
 
-    if( style.empty() )
+void instGraphXML::guiData::fontColor( const std::string &color )
+{
+    if( xmlNode == nullptr )
     {
-        std::string msg = "instGraphXML::guiData::opacity: no `style` attribute";
+        std::string msg = "instGraphXML::guiData::fontColor: xmlNode null";
         throw std::runtime_error( msg );
     }
 
+    if( styleAttr == nullptr )
+    {
+        std::string msg = "instGraphXML::guiData::fontColor: no `style` attribute";
+        throw std::runtime_error( msg );
+    }
+
+    syncStyle();
+
     // Add it if it doesn't exist
-    if( opacityPos.keyPos == std::string::npos )
+    if( fontColorSlot == std::string::npos )
     {
-        styleValue += "opacity=" + std::to_string( m_defaultOpacity ) + ";";
-        style.set_value( styleValue.c_str() );
-        findColors();
+        fontColorSlot = style.slot( "fontColor", m_defaultColor );
+    }
 
-        if( opacityPos.keyPos == std::string::npos )
-        {
-            std::string msg = "Unable to add opacity to style attribute";
-            throw std::runtime_error( msg );
-        }
+    if( style.value( fontColorSlot, color ) || currentStyle == -1 )
+    {
+        writeStyle();
     }
+}
 
-    bool szch = opacityPos.setValue( styleValue, std::to_string( op ) );
+void instGraphXML::guiData::opacity( int op )
+{
+    if( xmlNode == nullptr )
+    {
+        std::string msg = "instGraphXML::guiData::opacity: xmlNode null";
+        throw std::runtime_error( msg );
+    }
 
-    style.set_value( styleValue.c_str() );
+    if( styleAttr == nullptr )
+    {
+        std::string msg = "instGraphXML::guiData::opacity: no `style` attribute";
+        throw std::runtime_error( msg );
+    }
 
-    if( szch )
+    syncStyle();
+    stateStylesGen = -1; // the state styles no longer match the xml
+
+    // Add it if it doesn't exist
+    if( opacitySlot == std::string::npos )
     {
-        return findColors();
+        opacitySlot = style.slot( "opacity", std::to_string( m_defaultOpacity ) );
     }
+
+    style.value( opacitySlot, std::to_string( op ) );
+    writeStyle();
 }
 
 void instGraphXML::guiData::textOpacity( int op )
@@ -1214,51 +1779,150 @@ void instGraphXML::guiData::textOpacity( int op )
         throw std::runtime_error( msg );
     }
 
-    pugi::xml_attribute style = xmlNode->attribute( "style" );
-
-    if( style.empty() )
+    if( styleAttr == nullptr )
     {
         std::string msg = "instGraphXML::guiData::textOpacity: no `style` attribute";
         throw std::runtime_error( msg );
     }
 
+    syncStyle();
+    stateStylesGen = -1; // the state styles no longer match the xml
+
     // Add it if it doesn't exist
-    if( textOpacityPos.keyPos == std::string::npos )
+    if( textOpacitySlot == std::string::npos )
+    {
+        textOpacitySlot = style.slot( "textOpacity", std::to_string( m_defaultOpacity ) );
+    }
+
+    style.value( textOpacitySlot, std::to_string( op ) );
+    writeStyle();
+}
+
+void instGraphXML::guiData::styleKey( const std::string &key, const std::string &val )
+{
+    if( xmlNode == nullptr )
+    {
+        std::string msg = "instGraphXML::guiData::styleKey: xmlNode null";
+        throw std::runtime_error( msg );
+    }
+
+    if( styleAttr == nullptr )
+    {
+        std::string msg = "instGraphXML::guiData::styleKey: no `style` attribute";
+        throw std::runtime_error( msg );
+    }
+
+    syncStyle();
+    stateStylesGen = -1; // the state styles no longer match the xml
+
+    style.value( style.slot( key, val ), val );
+    writeStyle();
+}
+
+void instGraphXML::guiData::buildStateStyles( const std::string &colorOff,
+                                              const std::string &colorInt,
+                                              const std::string &colorOn,
+                                              const std::vector<stateStyleKey> &keys,
+                                              int gen )
+{
+    if( xmlNode == nullptr )
+    {
+        std::string msg = "instGraphXML::guiData::buildStateStyles: xmlNode null";
+        throw std::runtime_error( msg );
+    }
+
+    if( styleAttr == nullptr )
     {
-        styleValue += "textOpacity=" + std::to_string( m_defaultOpacity ) + ";";
-        style.set_value( styleValue.c_str() );
-        findColors();
+        std::string msg = "instGraphXML::guiData::buildStateStyles: no `style` attribute";
+        throw std::runtime_error( msg );
+    }
 
-        if( textOpacityPos.keyPos == std::string::npos )
+    syncStyle();
+
+    if( strokeColorSlot == std::string::npos )
+    {
+        strokeColorSlot = style.slot( "strokeColor", m_defaultColor );
+    }
+
+    if( fontColorSlot == std::string::npos )
+    {
+        fontColorSlot = style.slot( "fontColor", m_defaultColor );
+    }
+
+    std::vector<size_t> slots( keys.size() );
+    for( size_t k = 0; k < keys.size(); ++k )
+    {
+        slots[k] = style.slot( keys[k].key, keys[k].values[0] );
+    }
+
+    const std::string *colors[3] = { &colorOff, &colorInt, &colorOn };
+
+    for( int n = 0; n < 3; ++n )
+    {
+        style.value( strokeColorSlot, *colors[n] );
+        style.value( fontColorSlot, *colors[n] );
+
+        for( size_t k = 0; k < keys.size(); ++k )
         {
-            std::string msg = "Unable to add opacity to style attribute";
-            throw std::runtime_error( msg );
+            style.value( slots[k], keys[k].values[n] );
         }
+
+        style.serialize( stateStyles[n] );
     }
 
-    bool szch = textOpacityPos.setValue( styleValue, std::to_string( op ) );
+    styleAttribute().set_value( stateStyles[2].c_str() );
+    markDirty( styleField );
 
-    style.set_value( styleValue.c_str() );
+    stateStylesGen = gen;
+    currentStyle = 2;
+}
 
-    if( szch )
+void instGraphXML::guiData::stateStyle( int st )
+{
+    if( st == currentStyle || styleAttr == nullptr )
     {
-        return findColors();
+        return;
+    }
+
+    styleAttribute().set_value( stateStyles[st].c_str() );
+    markDirty( styleField );
+    currentStyle = st;
+}
+
+void instGraphXML::guiData::syncStyle()
+{
+    // the style table is stale once a cached state style has been applied
+    if( currentStyle != -1 )
+    {
+        currentStyle = -1;
+        parseStyle();
     }
 }
 
-void instGraphXML::guiData::value( const std::string &val )
+bool instGraphXML::guiData::value( std::string_view val )
 {
     if( xmlNode == nullptr )
     {
-        return;
+        return false;
     }
 
-    pugi::xml_attribute value = xmlNode->attribute( "value" );
+    pugi::xml_attribute value = node().attribute( "value" );
+
+    if( value.empty() )
+    {
+        return false;
+    }
 
-    if( !value.empty() )
+    const char *cur = value.value();
+    if( strlen( cur ) == val.size() && memcmp( cur, val.data(), val.size() ) == 0 )
     {
-        value.set_value( val.c_str() );
+        return false;
     }
+
+    value.set_value( val.data(), val.size() );
+    markDirty( valueField );
+
+    return true;
 }
 
 } // namespace ingr
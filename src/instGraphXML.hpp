@@ -1,14 +1,23 @@
 #ifndef instGraphXML_hpp
 #define instGraphXML_hpp
 
+#include <array>
 #include <memory>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 #include "instGraph.hpp"
+#include "instGraphXMLSink.hpp"
 
 // forward
 namespace pugi
 {
 class xml_document;
 class xml_node;
+class xml_attribute;
+struct xml_node_struct;
+struct xml_attribute_struct;
 } // namespace pugi
 
 namespace ingr
@@ -22,105 +31,60 @@ class instGraphXML : public instGraph
 {
 
   public:
-    struct extraGuiData;
+    struct patchTable; // defined in instGraphXML.cpp
 
-    struct attrCoord
+    /// A drawio `style` attribute parsed into a flat key/value table
+    /** The style is a `;` separated list of `key=value` pairs, or bare `key` flags (e.g. `ellipse`).  Keys are
+     * matched exactly, and once a key's slot is known its value can be updated in O(1).  Order is preserved on
+     * serialization.
+     */
+    struct styleTable
     {
-        std::string key;
-        size_t keyPos{ std::string::npos };
-        size_t valLen{ std::string::npos }; ///< the length after the '=', not including the ';'
-        size_t attrLen{ std::string::npos };
-
-        void findKey( const std::string &attr, const std::string &k )
+        struct entry
         {
-            key = k;
-            attrLen = attr.size();
-            keyPos = attr.find( key );
-
-            if( keyPos == std::string::npos )
-            {
-                clear();
-                return;
-            }
-
-            // make sure it's long enough
-            if( attr.size() < keyPos + key.size() + 1 )
-            {
-                clear();
-                return;
-            }
-
-            if( attr[keyPos + key.size()] != '=' )
-            {
-                clear();
-                return;
-            }
-
-            size_t cpos = attr.find( ';', keyPos + key.size() + 1 );
-
-            if( cpos == std::string::npos )
-            {
-                clear();
-            }
-
-            valLen = cpos - ( keyPos + key.size() + 1 );
-        }
+            std::string key;
+            std::string value;
+            bool hasValue{ true }; ///< false for bare flags, which are written without `=`
+        };
 
-        void clear()
-        {
-            key = "";
-            keyPos = std::string::npos;
-            valLen = std::string::npos;
-            attrLen = std::string::npos;
-        }
+        std::vector<entry> entries;
+
+        /// Parse a style string, replacing the current contents
+        void parse( const char *style /**< [in] the style attribute value */ );
 
-        ///
+        /// Find the slot of a key
         /**
-         * \return false if no changes to attr size are made
-         * \return true if attr size changes
+         * \returns the slot index of \p key
+         * \returns std::string::npos if \p key is not present
          */
-        bool setValue( std::string &attr, const std::string &value )
-        {
-            if( attrLen != attr.size() )
-            {
-                std::string msg = "attrCoord::setValue: attribute length has changed for " + key;
-                throw std::runtime_error( msg );
-            }
-
-            if( attr.substr( keyPos, key.size() ) != key )
-            {
-                std::string msg = "attrCoord::setValue: attribute key has changed for " + key;
-                throw std::runtime_error( msg );
-            }
-
-            if( attr[keyPos + key.size()] != '=' )
-            {
-                std::string msg = "attrCoord::setValue: parse error: no = for " + key;
-                throw std::runtime_error( msg );
-            }
-
-            if( attr[keyPos + key.size() + 1 + valLen] != ';' )
-            {
-                std::string msg = "attrCoord::setValue: attribute value has changed for " + key;
-            }
-
-            if( value.size() == valLen )
-            {
-                for( size_t n = 0; n < valLen; ++n )
-                {
-                    attr[keyPos + key.size() + 1 + n] = value[n];
-                }
-
-                return false;
-            }
-            else
-            {
-                attr.erase( keyPos + key.size() + 1, valLen );
-                attr.insert( keyPos + key.size() + 1, value );
-                valLen = value.size();
-                return true;
-            }
-        }
+        size_t find( const std::string &key /**< [in] the key to find */ ) const;
+
+        /// Find the slot of a key, adding it if not present
+        /**
+         * \returns the slot index of \p key
+         */
+        size_t slot( const std::string &key, /**< [in] the key to find */
+                     const std::string &def  /**< [in] the value to add the key with if not present */
+        );
+
+        /// Set the value in a slot
+        /**
+         * \returns true if the value changed
+         * \returns false otherwise
+         */
+        bool value( size_t slot,              /**< [in] the slot, from find() or slot() */
+                    const std::string &value  /**< [in] the new value */
+        );
+
+        /// Write the table as a style string
+        void serialize( std::string &style /**< [out] the style string, contents replaced */ ) const;
+    };
+
+    /// A style key whose value is driven by state, in addition to strokeColor and fontColor
+    struct stateStyleKey
+    {
+        std::string key;
+        std::string values[3]; ///< The value for each state, indexed by \ref styleIndex
     };
 
     struct guiData
@@ -128,27 +92,54 @@ class instGraphXML : public instGraph
         static constexpr char m_defaultColor[] = "#FFFFFF";
         static constexpr int m_defaultOpacity = 100;
 
-        pugi::xml_node *xmlNode{ nullptr };
+        pugi::xml_node_struct *xmlNode{ nullptr }; ///< The handle of the cell's xml_node, valid as long as the document
+
+        std::string styleValue; ///< The serialized style, kept to reuse its storage
+
+        styleTable style;       ///< The parsed style attribute
+
+        size_t strokeColorSlot{ std::string::npos };
+
+        size_t fontColorSlot{ std::string::npos };
+
+        size_t opacitySlot{ std::string::npos };
+
+        size_t textOpacitySlot{ std::string::npos };
+
+        pugi::xml_attribute_struct *styleAttr{ nullptr }; ///< Cached handle to the `style` attribute of xmlNode, if any
 
-        std::string styleValue;
+        /// The complete style strings for each state, indexed by \ref styleIndex.
+        std::string stateStyles[3];
 
-        attrCoord strokeColorPos;
+        int stateStylesGen{ -1 }; ///< The color generation stateStyles was built for, -1 if not built.
 
-        attrCoord fontColorPos;
+        int currentStyle{ -1 };   ///< Index of the entry in stateStyles currently in the xml, -1 if none.
 
-        attrCoord opacityPos;
+        patchTable *patch{ nullptr };           ///< The patch table this data's fields are laid out in, if any.
 
-        attrCoord textOpacityPos;
+        size_t styleField{ std::string::npos }; ///< Index of the style attribute's field in patch
 
-        /// Construct from a pointer to an xml_node, taking ownership of the pointer
-        guiData( pugi::xml_node *xn /**< [in] Pointer to an xml_node to take ownership of*/ );
+        size_t valueField{ std::string::npos }; ///< Index of the value attribute's field in patch
 
-        /// Construct from an xml_node, copying it.
-        guiData( const pugi::xml_node &xn /**< [in] An xml_node to copy*/ );
+        /// Construct from an xml_node, keeping its handle
+        explicit guiData( const pugi::xml_node &xn /**< [in] the xml_node, which must outlive this */ );
 
-        ~guiData();
+        guiData( guiData && ) = default;
 
-        void findColors();
+        guiData( const guiData & ) = delete;
+
+        guiData &operator=( guiData && ) = default;
+
+        guiData &operator=( const guiData & ) = delete;
+
+        /// Get the xml_node
+        pugi::xml_node node() const;
+
+        /// Get the `style` attribute of the xml_node, which is empty if there is none
+        pugi::xml_attribute styleAttribute() const;
+
+        /// Parse the style attribute of xmlNode, and find the slots of the standard keys
+        void parseStyle();
 
         void strokeColor( const std::string &color /**< [in] */ );
 
@@ -158,18 +149,98 @@ class instGraphXML : public instGraph
 
         void textOpacity( int op /**< [in] */ );
 
-        void value( const std::string &val /**< [in] */ );
+        /// Set an arbitrary style key, adding it if not present
+        void styleKey( const std::string &key, /**< [in] the style key, e.g. `dashed` */
+                       const std::string &val  /**< [in] the new value */
+        );
+
+        /// Set the value attribute
+        /**
+         * \returns true if the value changed
+         * \returns false if it was unchanged or there is no value attribute
+         */
+        bool value( std::string_view val /**< [in] the new value */ );
 
-        std::multimap<std::string, extraGuiData> extraData;
+        /// Build the complete style string for each state
+        /** After this call the xml holds the style for the on state.
+         */
+        void buildStateStyles( const std::string &colorOff, /**< [in] the color for the off state */
+                               const std::string &colorInt, /**< [in] the color for the intermediate/waiting state*/
+                               const std::string &colorOn,  /**< [in] the color for the on state*/
+                               const std::vector<stateStyleKey> &keys, /**< [in] additional keys driven by state */
+                               int gen                      /**< [in] the color generation being built for */
+        );
+
+        /// Apply a prebuilt state style to the xml
+        /** Does nothing if the style is already applied.  buildStateStyles must be called first.
+         */
+        void stateStyle( int st /**< [in] the style index, see \ref styleIndex */ );
+
+      protected:
+        /// Re-read the style attribute if a state style has been applied since the last edit
+        void syncStyle();
+
+        /// Serialize the style table and write it to the style attribute
+        void writeStyle();
+
+        /// Mark a field as needing to be patched in the output
+        void markDirty( size_t field /**< [in] styleField or valueField */ );
     };
 
     typedef guiData auxDataT;
 
+    /// The target of a value update in \ref valueBatch
+    enum class valueTarget
+    {
+        input,  ///< the value of an input
+        output, ///< the value of an output
+        extra   ///< the value of all extra xml_nodes of a type
+    };
+
+    /// A single value update for \ref valueBatch
+    struct valueUpdate
+    {
+        std::string_view node;    ///< The name of the instNode
+        valueTarget target;       ///< Whether this updates an input, output, or extra
+        std::string_view name;    ///< The name of the put, or the type of the extra
+        std::string_view value;   ///< The new value
+        size_t slot{ std::string::npos }; ///< The slot from \ref findValueSlot, which if set is used instead of the names
+    };
+
+    /// The result of a \ref valueBatch
+    struct valueBatchResult
+    {
+        size_t applied{ 0 };   ///< The number of updates which changed a value
+        size_t unknown{ 0 };   ///< The number of updates whose node and put or extra were not found
+        size_t unchanged{ 0 }; ///< The number of updates which did not change any value
+    };
+
+    /// Get the index into guiData::stateStyles for a put state
+    static int styleIndex( putState st /**< [in] the put state */ );
+
+    /// Get the index into guiData::stateStyles for a beam state
+    static int styleIndex( beamState st /**< [in] the beam state */ );
+
+    /// An extra xml_node associated with a node, with id `type:node[:payload]`
     struct extraGuiData
     {
-        std::string payload;
+        std::string node;    ///< The name of the instNode this extra belongs to
+
+        std::string type;    ///< The type of the extra, e.g. `group`
+
+        std::string payload; ///< The optional payload following the node name in the id
+
+        guiData gdata;       ///< The gui data for the extra's xml_node
+    };
+
+    /// The location of the gui data for a value target, indexed by slot in m_valueSlots
+    struct valueSlot
+    {
+        guiData *put{ nullptr }; ///< The gui data of a put, or nullptr for extras
 
-        std::shared_ptr<guiData> gdata;
+        size_t extraBegin{ 0 };  ///< The first extra in m_extras
+
+        size_t extraEnd{ 0 };    ///< One past the last extra in m_extras
     };
 
   protected:
@@ -184,8 +255,30 @@ class instGraphXML : public instGraph
     std::string m_colorOn{ "#00FF00" };
     std::string m_colorInt{ "#FFFF00" };
 
+    std::vector<stateStyleKey> m_stateKeys; ///< Additional style keys driven by state.
+
+    int m_colorGen{ 0 }; ///< Incremented whenever a state color or key changes, invalidating the cached state styles.
+
     std::string m_outputPath{ "tmp.drawio" }; ///< The output file path for writing updated drawio xml.
 
+    fileSink m_fileSink; ///< Writes renders to m_outputPath
+
+    std::vector<std::shared_ptr<instGraphXMLSink>> m_sinks; ///< Additional sinks which receive each render
+
+    std::string m_render;     ///< The last render, when not in patch mode
+
+    std::string m_renderNext; ///< Working space for the next render, when not in patch mode
+
+    uint64_t m_renderGen{ 0 }; ///< The render generation, incremented each time a changed render is published
+
+    bool m_patchMode{ false };      ///< If true, saves patch fixed-width fields in place rather than re-serializing.
+
+    size_t m_patchValueWidth{ 0 };  ///< The minimum width of a value field in patch mode, 0 for the value's width.
+
+    size_t m_patchStyleSlack{ 16 }; ///< Extra width given to style fields in patch mode.
+
+    std::unique_ptr<patchTable> m_patch; ///< The serialized document and its field layout, for patch mode.
+
     /// Hold the gui information for output links
     /** Output links aren't actual entities in basic instGraph, rather they are just pointers
      * from inputs to outputs.  But in the mxGraph XML they are entities that need to be managed
@@ -193,6 +286,44 @@ class instGraphXML : public instGraph
      */
     std::map<std::string, std::shared_ptr<guiData>> m_outputLinks;
 
+    /// All extras in the graph, sorted by node and then type so that each (node, type) is a contiguous range.
+    std::vector<extraGuiData> m_extras;
+
+    /// Hash for name lookups by std::string_view, without building a std::string
+    struct nameHash
+    {
+        using is_transparent = void;
+
+        size_t operator()( std::string_view name ) const
+        {
+            return std::hash<std::string_view>{}( name );
+        }
+    };
+
+    /// Map from a name to a number
+    typedef std::unordered_map<std::string, size_t, nameHash, std::equal_to<>> nameIndex;
+
+    /// The gui data for each value target, indexed by slot
+    std::vector<valueSlot> m_valueSlots;
+
+    /// The index into m_valueNames of each node with a value target
+    nameIndex m_valueNodes;
+
+    /// For each node, the slot of each put name or extra type, indexed by \ref valueTarget
+    std::vector<std::array<nameIndex, 3>> m_valueNames;
+
+    /// Build m_valueSlots and their index.  Called at the end of parsing.
+    void buildValueIndex();
+
+    /// Add a value target to the index
+    /**
+     * \returns the slot of the target
+     */
+    size_t addValueSlot( valueTarget target,      /**< [in] the target type */
+                         const std::string &node, /**< [in] the node name */
+                         const std::string &name  /**< [in] the put name or extra type */
+    );
+
   public:
     /// Default c'tor
     instGraphXML();
@@ -211,10 +342,126 @@ class instGraphXML : public instGraph
     const std::string &outputPath();
 
     /// Set the output file path for writing updated drawio xml
+    /** Set to "" to disable writing to a file, e.g. if only sinks are used.
+     */
     void outputPath( const std::string &op /**< [in] the new output path */ );
 
+    /// Add a sink to receive each render, in addition to the output file
+    void addSink( const std::shared_ptr<instGraphXMLSink> &sink /**< [in] the sink to add */ );
+
+    /// Remove a sink
+    void removeSink( const std::shared_ptr<instGraphXMLSink> &sink /**< [in] the sink to remove */ );
+
+    /// Remove all sinks.  The output file is not affected.
+    void clearSinks();
+
+    /// Get a view of the last render
+    /** The view is valid until the next call to save().
+     *
+     * \returns a span over the last rendered document
+     */
+    std::span<const char> lastRender();
+
+    /// Get the generation of the last render
+    /** Incremented each time a render differing from the previous one is published.  Consumers can
+     * skip unchanged renders by comparing with the last generation they processed.
+     *
+     * \returns the current value of m_renderGen
+     */
+    uint64_t renderGeneration();
+
+    /// Get the color used for the off state
+    /**
+     * \returns a const reference to m_colorOff
+     */
+    const std::string &colorOff();
+
+    /// Set the color used for the off state
+    void colorOff( const std::string &c /**< [in] the new color */ );
+
+    /// Get the color used for the intermediate/waiting state
+    /**
+     * \returns a const reference to m_colorInt
+     */
+    const std::string &colorInt();
+
+    /// Set the color used for the intermediate/waiting state
+    void colorInt( const std::string &c /**< [in] the new color */ );
+
+    /// Get the color used for the on state
+    /**
+     * \returns a const reference to m_colorOn
+     */
+    const std::string &colorOn();
+
+    /// Set the color used for the on state
+    void colorOn( const std::string &c /**< [in] the new color */ );
+
+    /// Drive an additional style key by state
+    /** For instance `stateKey("dashed", "1", "1", "0")` draws off and intermediate/waiting beams and puts dashed.
+     * Calling again with the same key replaces its values.
+     */
+    void stateKey( const std::string &key,    /**< [in] the style key */
+                   const std::string &offVal, /**< [in] the value for the off state */
+                   const std::string &intVal, /**< [in] the value for the intermediate/waiting state */
+                   const std::string &onVal   /**< [in] the value for the on state */
+    );
+
+    /// Get whether patch mode is enabled
+    /**
+     * \returns the current value of m_patchMode
+     */
+    bool patchMode();
+
+    /// Enable or disable patch mode
+    /** In patch mode the document is serialized once with a fixed-width field for every style and value
+     * attribute, and the byte offset of each field is recorded.  Subsequent saves only overwrite the fields
+     * that changed, and only those byte ranges are written to the output file, so the cost of a save scales
+     * with the number of changed fields rather than the size of the document.  Style fields are padded with
+     * `;`, which drawio ignores.  Value fields are as wide as the value when laid out, unless
+     * patchValueWidth() is set, and are padded with spaces.  If a new value does not fit its field, the
+     * document is laid out again.
+     */
+    void patchMode( bool pm /**< [in] the new value of the patch mode flag */ );
+
+    /// Get the minimum width of value fields in patch mode
+    /**
+     * \returns the current value of m_patchValueWidth
+     */
+    size_t patchValueWidth();
+
+    /// Set the minimum width of value fields in patch mode
+    /** Takes effect at the next layout.  A wider field lets a value grow without laying out the document
+     * again, but a shorter value is padded with trailing spaces, which are part of the label drawio displays
+     * and so can shift a centered label.  The default of 0 makes each field the width of its value.
+     */
+    void patchValueWidth( size_t pvw /**< [in] the new minimum width */ );
+
+    /// Render the document and publish it to the output file and sinks
+    /** Nothing is published if the render is unchanged.
+     */
+    void save();
+
     virtual void stateChange();
 
+  protected:
+    /// Serialize the document with placeholder fields and record their offsets.
+    void patchLayout();
+
+    /// Fill a field of the serialized document from its attribute
+    /**
+     * \returns true on success
+     * \returns false if the attribute value no longer fits in the field
+     */
+    bool patchFill( size_t field /**< [in] the field index */ );
+
+
+    /// Apply the cached style for state \p st, building the cache first if the colors have changed
+    void restyle( auxDataT *auxData, /**< [in] the gui data to restyle */
+                  int st             /**< [in] the style index, see \ref styleIndex */
+    );
+
+  public:
     /// Set the value of a put
     virtual void valuePut( const std::string &node, /**< [in] the name of the instNode whose put is being modified.*/
                            const std::string &put,  /**< [in] the name of the put being modified.*/
@@ -229,6 +476,40 @@ class instGraphXML : public instGraph
                 const std::string &val    /**< [in] the new value to set */
     );
 
+    /// Get all extras in the graph
+    /**
+     * \returns a const reference to m_extras, sorted by node and then type
+     */
+    const std::vector<extraGuiData> &extras();
+
+    /// Get the extras of a given type for a node
+    /**
+     * \returns the contiguous range of m_extras for \p node and \p type, which is empty if there are none
+     */
+    std::span<extraGuiData> extras( const std::string &node, /**< [in] the node name */
+                                    const std::string &type  /**< [in] the extra type */
+    );
+
+    /// Find the slot of a value target
+    /** The slot can be passed in valueUpdate::slot to skip the lookup by name.  It is valid until the
+     * document is parsed again.
+     *
+     * \returns the slot
+     * \returns std::string::npos if the node has no such put or extra
+     */
+    size_t findValueSlot( valueTarget target,    /**< [in] the target type */
+                          std::string_view node, /**< [in] the node name */
+                          std::string_view name  /**< [in] the put name or extra type */
+    ) const;
+
+    /// Apply a batch of value updates, and save at most once
+    /** Each update is resolved by its slot, or by name through a precomputed index.  The document is saved
+     * once, and only if at least one value changed.
+     *
+     * \returns the counts of applied, unknown, and unchanged updates
+     */
+    valueBatchResult valueBatch( std::span<const valueUpdate> updates /**< [in] the updates to apply */ );
+
     virtual void hideLinks();
 
     virtual void hidePuts();
@@ -0,0 +1,369 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "instGraphXMLSink.hpp"
+
+namespace ingr
+{
+
+// Write len bytes of buf to fd, at offset off if off >= 0, otherwise at the current position
+void writeAll( int fd, const char *buf, size_t len, off_t off, const std::string &where )
+{
+    while( len > 0 )
+    {
+        ssize_t nw = ( off >= 0 ) ? pwrite( fd, buf, len, off ) : write( fd, buf, len );
+
+        if( nw < 0 )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+
+            std::string msg = "error writing " + where + ": " + strerror( errno );
+            msg += " (";
+            msg += __FILE__;
+            msg += " ";
+            msg += std::to_string( __LINE__ );
+            msg += ")";
+            throw std::runtime_error( msg );
+        }
+
+        buf += nw;
+        len -= nw;
+        if( off >= 0 )
+        {
+            off += nw;
+        }
+    }
+}
+
+instGraphXMLSink::~instGraphXMLSink()
+{
+}
+
+fileSink::fileSink()
+{
+}
+
+fileSink::fileSink( const std::string &path ) : m_path{ path }
+{
+}
+
+fileSink::~fileSink()
+{
+    closeFd();
+}
+
+const std::string &fileSink::path()
+{
+    return m_path;
+}
+
+void fileSink::path( const std::string &p )
+{
+    if( p != m_path )
+    {
+        closeFd();
+        m_path = p;
+    }
+}
+
+void fileSink::closeFd()
+{
+    if( m_fd >= 0 )
+    {
+        close( m_fd );
+        m_fd = -1;
+    }
+}
+
+void fileSink::publish( const renderView &rv )
+{
+    struct stat st;
+
+    // The file may have been removed or replaced since it was opened
+    if( m_fd >= 0 && ( stat( m_path.c_str(), &st ) < 0 || st.st_dev != m_dev || st.st_ino != m_ino ) )
+    {
+        closeFd();
+    }
+
+    bool full = ( m_fd < 0 || rv.dirty.empty() || rv.generation != m_lastGen + 1 || rv.doc.size() != m_lastSize );
+
+    if( m_fd < 0 )
+    {
+        m_fd = open( m_path.c_str(), O_WRONLY | O_CREAT, 0644 );
+        if( m_fd < 0 || fstat( m_fd, &st ) < 0 )
+        {
+            std::string msg = "error opening " + m_path + ": " + strerror( errno );
+            msg += " (ingr::fileSink::publish ";
+            msg += __FILE__;
+            msg += " ";
+            msg += std::to_string( __LINE__ );
+            msg += ")";
+            closeFd();
+            throw std::runtime_error( msg );
+        }
+
+        m_dev = st.st_dev;
+        m_ino = st.st_ino;
+    }
+
+    if( full )
+    {
+        writeAll( m_fd, rv.doc.data(), rv.doc.size(), 0, m_path );
+
+        if( ftruncate( m_fd, rv.doc.size() ) < 0 )
+        {
+            std::string msg = "error truncating " + m_path + ": " + strerror( errno );
+            msg += " (ingr::fileSink::publish ";
+            msg += __FILE__;
+            msg += " ";
+            msg += std::to_string( __LINE__ );
+            msg += ")";
+            throw std::runtime_error( msg );
+        }
+    }
+    else
+    {
+        // Coalesce the dirty ranges into spans covering the same pages, and write only those
+        static const size_t pageSz = sysconf( _SC_PAGESIZE );
+
+        size_t n = 0;
+        while( n < rv.dirty.size() )
+        {
+            size_t start = rv.dirty[n].first;
+            size_t end = rv.dirty[n].first + rv.dirty[n].second;
+
+            ++n;
+            while( n < rv.dirty.size() && rv.dirty[n].first / pageSz <= ( end - 1 ) / pageSz )
+            {
+                end = std::max( end, rv.dirty[n].first + rv.dirty[n].second );
+                ++n;
+            }
+
+            writeAll( m_fd, rv.doc.data() + start, end - start, start, m_path );
+        }
+    }
+
+    m_lastGen = rv.generation;
+    m_lastSize = rv.doc.size();
+}
+
+bufferSink::bufferSink( std::string *buffer, uint64_t *generation ) : m_buffer{ buffer }, m_generation{ generation }
+{
+    if( m_buffer == nullptr )
+    {
+        throw std::invalid_argument( "bufferSink: buffer is null" );
+    }
+}
+
+void bufferSink::publish( const renderView &rv )
+{
+    // The dirty ranges are relative to the previous generation, so a skipped generation needs a full copy
+    if( m_copied && rv.generation == m_lastGen + 1 && !rv.dirty.empty() && m_buffer->size() == rv.doc.size() )
+    {
+        for( auto &d : rv.dirty )
+        {
+            memcpy( m_buffer->data() + d.first, rv.doc.data() + d.first, d.second );
+        }
+    }
+    else
+    {
+        m_buffer->assign( rv.doc.data(), rv.doc.size() );
+    }
+
+    m_copied = true;
+    m_lastGen = rv.generation;
+
+    if( m_generation )
+    {
+        *m_generation = rv.generation;
+    }
+}
+
+fdSink::fdSink( int fd ) : m_fd{ fd }
+{
+}
+
+void fdSink::publish( const renderView &rv )
+{
+    std::string hdr = "instGraphXML " + std::to_string( rv.generation ) + " " + std::to_string( rv.doc.size() ) + "\n";
+
+    writeAll( m_fd, hdr.data(), hdr.size(), -1, "fd " + std::to_string( m_fd ) );
+    writeAll( m_fd, rv.doc.data(), rv.doc.size(), -1, "fd " + std::to_string( m_fd ) );
+}
+
+shmSink::shmSink( const std::string &name, size_t capacity ) : m_name{ name }, m_capacity{ capacity }
+{
+    bool created = true;
+
+    int fd = shm_open( m_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644 );
+    if( fd < 0 && errno == EEXIST )
+    {
+        created = false;
+        fd = shm_open( m_name.c_str(), O_RDWR, 0644 );
+    }
+
+    if( fd < 0 )
+    {
+        std::string msg = "shmSink: error opening " + m_name + ": " + strerror( errno );
+        throw std::runtime_error( msg );
+    }
+
+    m_mapSize = sizeof( shmHeader ) + m_capacity;
+
+    // Readers of an existing region would fault reading past the end if it shrank, so it is only grown
+    struct stat st;
+    if( !created && fstat( fd, &st ) < 0 )
+    {
+        std::string msg = "shmSink: error sizing " + m_name + ": " + strerror( errno );
+        close( fd );
+        throw std::runtime_error( msg );
+    }
+
+    if( ( created || static_cast<size_t>( st.st_size ) < m_mapSize ) && ftruncate( fd, m_mapSize ) < 0 )
+    {
+        std::string msg = "shmSink: error sizing " + m_name + ": " + strerror( errno );
+        close( fd );
+        throw std::runtime_error( msg );
+    }
+
+    m_map = mmap( nullptr, m_mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd );
+
+    if( m_map == MAP_FAILED )
+    {
+        m_map = nullptr;
+        std::string msg = "shmSink: error mapping " + m_name + ": " + strerror( errno );
+        throw std::runtime_error( msg );
+    }
+
+    shmHeader *hdr = static_cast<shmHeader *>( m_map );
+
+    if( created )
+    {
+        hdr->sequence.store( 0, std::memory_order_relaxed );
+        hdr->generation = 0;
+        hdr->size = 0;
+        hdr->capacity = m_capacity;
+        return;
+    }
+
+    // Readers may be reading the existing header, so it is reset with the sequence odd.  An odd sequence left
+    // by a writer which stopped during a write is kept.
+    uint64_t seq = hdr->sequence.load( std::memory_order_relaxed ) | 1;
+    hdr->sequence.store( seq, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+
+    hdr->generation = 0;
+    hdr->size = 0;
+    hdr->capacity = m_capacity;
+
+    hdr->sequence.store( seq + 1, std::memory_order_release );
+}
+
+shmSink::~shmSink()
+{
+    if( m_map )
+    {
+        munmap( m_map, m_mapSize );
+    }
+}
+
+void shmSink::publish( const renderView &rv )
+{
+    if( rv.doc.size() > m_capacity )
+    {
+        std::string msg = "shmSink: document size " + std::to_string( rv.doc.size() ) + " exceeds capacity " +
+                          std::to_string( m_capacity ) + " of " + m_name;
+        throw std::runtime_error( msg );
+    }
+
+    shmHeader *hdr = static_cast<shmHeader *>( m_map );
+    char *data = static_cast<char *>( m_map ) + sizeof( shmHeader );
+
+    uint64_t seq = hdr->sequence.load( std::memory_order_relaxed );
+    hdr->sequence.store( seq + 1, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+
+    if( !rv.dirty.empty() && hdr->size == rv.doc.size() && hdr->generation + 1 == rv.generation )
+    {
+        for( auto &d : rv.dirty )
+        {
+            memcpy( data + d.first, rv.doc.data() + d.first, d.second );
+        }
+    }
+    else
+    {
+        memcpy( data, rv.doc.data(), rv.doc.size() );
+    }
+
+    hdr->generation = rv.generation;
+    hdr->size = rv.doc.size();
+
+    hdr->sequence.store( seq + 2, std::memory_order_release );
+}
+
+int shmSink::read( std::string &doc, uint64_t &generation, const std::string &name )
+{
+    int fd = shm_open( name.c_str(), O_RDONLY, 0 );
+    if( fd < 0 )
+    {
+        return -1;
+    }
+
+    struct stat st;
+    if( fstat( fd, &st ) < 0 || static_cast<size_t>( st.st_size ) < sizeof( shmHeader ) )
+    {
+        close( fd );
+        return -1;
+    }
+
+    void *map = mmap( nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+
+    if( map == MAP_FAILED )
+    {
+        return -1;
+    }
+
+    const shmHeader *hdr = static_cast<const shmHeader *>( map );
+    const char *data = static_cast<const char *>( map ) + sizeof( shmHeader );
+    size_t avail = st.st_size - sizeof( shmHeader );
+
+    int rv = -1;
+    for( int tries = 0; tries < 1000; ++tries )
+    {
+        uint64_t seq0 = hdr->sequence.load( std::memory_order_acquire );
+        if( seq0 & 1 )
+        {
+            continue;
+        }
+
+        uint64_t gen = hdr->generation;
+        size_t sz = std::min<size_t>( hdr->size, avail );
+        doc.assign( data, sz );
+
+        std::atomic_thread_fence( std::memory_order_acquire );
+        if( hdr->sequence.load( std::memory_order_relaxed ) == seq0 )
+        {
+            generation = gen;
+            rv = 0;
+            break;
+        }
+    }
+
+    munmap( map, st.st_size );
+
+    return rv;
+}
+
+} // namespace ingr
@@ -0,0 +1,205 @@
+/** \file
+ *
+ * \brief Output sinks for rendered instGraphXML documents
+ */
+
+#ifndef instGraphXMLSink_hpp
+#define instGraphXMLSink_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ingr
+{
+
+/// A view of a rendered document, as handed to a sink
+/**
+ * \ingroup explainer
+ */
+struct renderView
+{
+    std::span<const char> doc; ///< The complete rendered document.  Only valid during the call to publish.
+
+    uint64_t generation{ 0 };  ///< The render generation, which increments each time the document changes.
+
+    /// Byte ranges, as (offset, length), changed since generation-1, sorted by offset.
+    /** Empty if the whole document should be considered changed.
+     */
+    std::span<const std::pair<size_t, size_t>> dirty;
+};
+
+/// Interface for a destination of rendered instGraphXML documents
+/**
+ * \ingroup explainer
+ */
+class instGraphXMLSink
+{
+  public:
+    virtual ~instGraphXMLSink();
+
+    /// Publish a newly rendered document
+    /** Errors are reported by throwing std::runtime_error.
+     */
+    virtual void publish( const renderView &rv /**< [in] the rendered document */ ) = 0;
+};
+
+/// Sink which writes the document to a file
+/** The file is kept open between renders, and opened again if the path no longer names it, for instance
+ * after it was removed or replaced by a rename.  If only some byte ranges changed since the last
+ * generation written, only the pages containing them are rewritten.
+ *
+ * \ingroup explainer
+ */
+class fileSink : public instGraphXMLSink
+{
+  protected:
+    std::string m_path;        ///< The path of the file
+
+    int m_fd{ -1 };            ///< The open file descriptor, or -1
+
+    uint64_t m_lastGen{ 0 };   ///< The generation last written
+
+    size_t m_lastSize{ 0 };    ///< The size of the document last written
+
+    uint64_t m_dev{ 0 };       ///< The device of the open file
+
+    uint64_t m_ino{ 0 };       ///< The inode of the open file
+
+  public:
+    /// Default c'tor
+    fileSink();
+
+    /// Construct with the path set
+    explicit fileSink( const std::string &path /**< [in] the file path */ );
+
+    /// Destructor, closes the file
+    ~fileSink();
+
+    /// Get the file path
+    /**
+     * \returns a const reference to m_path
+     */
+    const std::string &path();
+
+    /// Set the file path
+    /** Closes the current file if the path changes.
+     */
+    void path( const std::string &p /**< [in] the new path */ );
+
+    virtual void publish( const renderView &rv );
+
+  protected:
+    /// Close the file if it is open
+    void closeFd();
+};
+
+/// Sink which copies the document into a caller-supplied buffer
+/** Only the dirty ranges are copied when the document follows the generation last copied, otherwise the whole
+ * document is copied.
+ *
+ * \ingroup explainer
+ */
+class bufferSink : public instGraphXMLSink
+{
+  protected:
+    std::string *m_buffer{ nullptr }; ///< The destination buffer, not owned
+
+    uint64_t *m_generation{ nullptr }; ///< Optional destination for the generation, not owned
+
+    bool m_copied{ false };            ///< Whether a document has been copied
+
+    uint64_t m_lastGen{ 0 };           ///< The generation last copied
+
+  public:
+    /// Construct with the destination buffer
+    explicit bufferSink( std::string *buffer,               /**< [in] the buffer to copy into, must outlive this sink */
+                         uint64_t *generation = nullptr     /**< [in] [optional] updated with each generation copied */
+    );
+
+    virtual void publish( const renderView &rv );
+};
+
+/// Sink which writes the document to a file descriptor, such as a pipe or socket.
+/** Each document is preceded by a header line `instGraphXML <generation> <size>\n` so that a reader
+ * can frame the stream.  The descriptor is not owned and is not closed.
+ *
+ * \ingroup explainer
+ */
+class fdSink : public instGraphXMLSink
+{
+  protected:
+    int m_fd{ -1 }; ///< The file descriptor, not owned
+
+  public:
+    /// Construct with the descriptor
+    explicit fdSink( int fd /**< [in] the descriptor to write to */ );
+
+    virtual void publish( const renderView &rv );
+};
+
+/// Sink which publishes the document to a POSIX shared memory region
+/** The region begins with a \ref shmHeader followed by the document.  Writes are guarded by a sequence
+ * lock: the sequence is odd while a write is in progress.  Readers use \ref read.
+ *
+ * A region which already exists may be mapped by readers, so it is only grown, never shrunk, and its header
+ * is reset under the sequence lock.
+ *
+ * \ingroup explainer
+ */
+class shmSink : public instGraphXMLSink
+{
+  public:
+    /// The header at the start of the shared memory region
+    struct shmHeader
+    {
+        std::atomic<uint64_t> sequence; ///< Odd while a write is in progress
+        uint64_t generation;            ///< The render generation of the document
+        uint64_t size;                  ///< The size of the document
+        uint64_t capacity;              ///< The space available for the document
+    };
+
+  protected:
+    std::string m_name;           ///< The shared memory object name, e.g. "/instGraph"
+
+    size_t m_capacity{ 0 };       ///< The space available for the document
+
+    void *m_map{ nullptr };       ///< The mapping
+
+    size_t m_mapSize{ 0 };        ///< The size of the mapping
+
+  public:
+    /// Construct, creating the shared memory object if it does not exist
+    /**
+     * \throws std::runtime_error on error
+     */
+    shmSink( const std::string &name, /**< [in] the shared memory object name, must start with '/' */
+             size_t capacity          /**< [in] the maximum document size */
+    );
+
+    /// Destructor, unmaps the region.  The shared memory object is not unlinked.
+    ~shmSink();
+
+    /// Publish the document
+    /**
+     * \throws std::runtime_error if the document is larger than the capacity
+     */
+    virtual void publish( const renderView &rv );
+
+    /// Read the document from a shared memory object written by a shmSink
+    /**
+     * \returns 0 on success, with \p doc and \p generation set
+     * \returns -1 on error
+     */
+    static int read( std::string &doc,         /**< [out] the document */
+                     uint64_t &generation,     /**< [out] the generation of the document */
+                     const std::string &name   /**< [in] the shared memory object name */
+    );
+};
+
+} // namespace ingr
+
+#endif // instGraphXMLSink_hpp
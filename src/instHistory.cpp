@@ -0,0 +1,516 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#include "instHistory.hpp"
+#include "instGraph.hpp"
+
+namespace ingr
+{
+
+uint64_t historySnapshot::time() const
+{
+    return m_time;
+}
+
+size_t historySnapshot::size() const
+{
+    return m_states.size();
+}
+
+entityKind historySnapshot::kind( uint32_t h ) const
+{
+    if( !m_names || h >= m_names->size() )
+    {
+        throw std::out_of_range( "historySnapshot::kind: invalid handle" );
+    }
+
+    return ( *m_names )[h].first;
+}
+
+const std::string &historySnapshot::name( uint32_t h ) const
+{
+    if( !m_names || h >= m_names->size() )
+    {
+        throw std::out_of_range( "historySnapshot::name: invalid handle" );
+    }
+
+    return ( *m_names )[h].second;
+}
+
+putState historySnapshot::put( uint32_t h ) const
+{
+    if( kind( h ) != entityKind::put )
+    {
+        throw std::out_of_range( "historySnapshot::put: handle is not a put" );
+    }
+
+    return static_cast<putState>( m_states[h] );
+}
+
+beamState historySnapshot::beam( uint32_t h ) const
+{
+    if( kind( h ) != entityKind::beam )
+    {
+        throw std::out_of_range( "historySnapshot::beam: handle is not a beam" );
+    }
+
+    return static_cast<beamState>( m_states[h] );
+}
+
+static const char historyMagic[] = "INGRHID1";
+
+// The size of an index entry in the index file
+constexpr size_t historyIndexSize = 24;
+
+// The size of a checkpoint in the checkpoint file: the time, the number of handles, and 2 bits per handle
+static uint64_t checkpointSize( uint64_t nHandles )
+{
+    return 12 + ( nHandles + 3 ) / 4;
+}
+
+// Read the header of an index file, returning the offset of the first entry or 0 on error
+static uint64_t readHistoryHeader( std::string &emsg, historySnapshot::namesT &names, const std::string &fname )
+{
+    std::ifstream fin( fname, std::ios::binary );
+
+    if( !fin )
+    {
+        emsg = "error opening " + fname;
+        return 0;
+    }
+
+    char magic[8];
+    if( !fin.read( magic, 8 ) || memcmp( magic, historyMagic, 8 ) != 0 )
+    {
+        emsg = fname + " is not a history index";
+        return 0;
+    }
+
+    // The name lengths are bounded by the size of the file, so a corrupt length can't cause a huge allocation
+    fin.seekg( 0, std::ios::end );
+    uint64_t fileSize = fin.tellg();
+    fin.seekg( 8 );
+
+    uint32_t nNames;
+    if( !getLE( fin, nNames ) )
+    {
+        emsg = fname + " is truncated";
+        return 0;
+    }
+
+    names.clear();
+    for( uint32_t n = 0; n < nNames; ++n )
+    {
+        uint8_t kind = 0;
+        uint32_t len = 0;
+        std::string nm;
+
+        if( getLE( fin, kind ) && getLE( fin, len ) )
+        {
+            if( len > fileSize - static_cast<uint64_t>( fin.tellg() ) )
+            {
+                emsg = fname + " is truncated or has a corrupt name length";
+                return 0;
+            }
+
+            nm.resize( len );
+            fin.read( nm.data(), len );
+        }
+
+        if( !fin )
+        {
+            emsg = fname + " is truncated";
+            return 0;
+        }
+
+        names.push_back( { static_cast<entityKind>( kind ), std::move( nm ) } );
+    }
+
+    return fin.tellg();
+}
+
+instHistory::instHistory()
+{
+}
+
+instHistory::~instHistory()
+{
+    close();
+}
+
+int instHistory::create( std::string &emsg, const std::string &base, instGraph &graph, size_t checkpointInterval )
+{
+    emsg = "";
+
+    close();
+
+    m_base = base;
+    m_checkpointInterval = std::max<size_t>( checkpointInterval, 1 );
+
+    graph.assignHandles();
+
+    m_names = std::make_shared<historySnapshot::namesT>();
+    for( uint32_t h = 0; h < graph.nHandles(); ++h )
+    {
+        m_names->push_back(
+            { graph.handlePut( h ) ? entityKind::put : entityKind::beam, graph.handleName( h ) } );
+    }
+
+    std::string idx = base + ".idx";
+    std::string ckp = base + ".ckp";
+    std::string dlt = base + ".dlt";
+
+    std::error_code ec;
+
+    if( std::filesystem::exists( idx, ec ) )
+    {
+        historySnapshot::namesT names;
+
+        m_indexOffset = readHistoryHeader( emsg, names, idx );
+        if( m_indexOffset == 0 )
+        {
+            return -1;
+        }
+
+        if( names != *m_names )
+        {
+            emsg = base + " is the history of a graph with different puts or beams";
+            return -1;
+        }
+
+        // Drop any partial records left by a crash, then continue after the complete ones
+        m_nDeltas = std::filesystem::exists( dlt, ec ) ? std::filesystem::file_size( dlt, ec ) / journalRecordSize : 0;
+        std::filesystem::resize_file( dlt, m_nDeltas * journalRecordSize, ec );
+
+        m_index.clear();
+        if( readIndex( emsg ) < 0 )
+        {
+            return -1;
+        }
+
+        // An index entry may have been written before its checkpoint or deltas reached the disk
+        uint64_t ckpFileSize = std::filesystem::exists( ckp, ec ) ? std::filesystem::file_size( ckp, ec ) : 0;
+        uint64_t ckpRecSize = checkpointSize( m_names->size() );
+
+        while( !m_index.empty() &&
+               ( m_index.back().ckpOffset + ckpRecSize > ckpFileSize || m_index.back().deltaIndex > m_nDeltas ) )
+        {
+            m_index.pop_back();
+        }
+
+        std::filesystem::resize_file( idx, m_indexOffset + m_index.size() * historyIndexSize, ec );
+
+        m_ckpSize = m_index.empty() ? 0 : m_index.back().ckpOffset + ckpRecSize;
+        std::filesystem::resize_file( ckp, m_ckpSize, ec );
+
+        m_lastTime = m_index.empty() ? 0 : m_index.back().time;
+        if( m_nDeltas > 0 )
+        {
+            std::ifstream fin( dlt, std::ios::binary );
+            fin.seekg( ( m_nDeltas - 1 ) * journalRecordSize );
+
+            char bytes[journalRecordSize];
+            if( fin.read( bytes, journalRecordSize ) )
+            {
+                journalRecord rec;
+                decodeJournalRecord( rec, bytes );
+                m_lastTime = std::max( m_lastTime, rec.time );
+            }
+        }
+    }
+    else
+    {
+        std::string buf( historyMagic, 8 );
+
+        putLE<uint32_t>( buf, m_names->size() );
+        for( auto &nm : *m_names )
+        {
+            putLE<uint8_t>( buf, static_cast<uint8_t>( nm.first ) );
+            putLE<uint32_t>( buf, nm.second.size() );
+            buf += nm.second;
+        }
+
+        std::ofstream fout( idx, std::ios::binary | std::ios::trunc );
+        fout.write( buf.data(), buf.size() );
+
+        if( !fout )
+        {
+            emsg = "error writing " + idx;
+            return -1;
+        }
+
+        m_indexOffset = buf.size();
+        m_index.clear();
+        m_nDeltas = 0;
+        m_ckpSize = 0;
+        m_lastTime = 0;
+
+        std::ofstream( ckp, std::ios::binary | std::ios::trunc );
+        std::ofstream( dlt, std::ios::binary | std::ios::trunc );
+    }
+
+    m_idxOut.open( idx, std::ios::binary | std::ios::app );
+    m_ckpOut.open( ckp, std::ios::binary | std::ios::app );
+    m_dltOut.open( dlt, std::ios::binary | std::ios::app );
+
+    if( !m_idxOut || !m_ckpOut || !m_dltOut )
+    {
+        emsg = "error opening " + base + " for writing";
+        close();
+        return -1;
+    }
+
+    m_graph = &graph;
+
+    // The state may have changed while not recording, so always start from a checkpoint
+    if( checkpoint( emsg, journalTime() ) < 0 )
+    {
+        close();
+        return -1;
+    }
+
+    graph.history( this );
+
+    return 0;
+}
+
+int instHistory::open( std::string &emsg, const std::string &base )
+{
+    emsg = "";
+
+    close();
+
+    m_base = base;
+    m_names = std::make_shared<historySnapshot::namesT>();
+    m_index.clear();
+
+    m_indexOffset = readHistoryHeader( emsg, *m_names, base + ".idx" );
+    if( m_indexOffset == 0 )
+    {
+        return -1;
+    }
+
+    return readIndex( emsg );
+}
+
+void instHistory::close()
+{
+    if( m_graph && m_graph->history() == this )
+    {
+        m_graph->history( nullptr );
+    }
+
+    m_graph = nullptr;
+
+    m_idxOut.close();
+    m_ckpOut.close();
+    m_dltOut.close();
+}
+
+void instHistory::record( const journalRecord &rec )
+{
+    journalRecord clamped = rec;
+    clamped.time = std::max( rec.time, m_lastTime );
+    m_lastTime = clamped.time;
+
+    m_buf.clear();
+    encodeJournalRecord( m_buf, clamped );
+    m_dltOut.write( m_buf.data(), m_buf.size() );
+    ++m_nDeltas;
+
+    if( m_nDeltas - m_lastCheckpoint >= m_checkpointInterval )
+    {
+        std::string emsg;
+        if( checkpoint( emsg, clamped.time ) < 0 )
+        {
+            m_graph->diagnostics()->report( severity::error, "instHistory", 0, 0, 0, [&] { return emsg; } );
+        }
+    }
+}
+
+int instHistory::checkpoint( std::string &emsg, uint64_t time )
+{
+    emsg = "";
+
+    if( m_graph == nullptr )
+    {
+        emsg = "instHistory::checkpoint: not recording";
+        return -1;
+    }
+
+    time = std::max( time, m_lastTime );
+    m_lastTime = time;
+
+    m_buf.clear();
+    putLE<uint64_t>( m_buf, time );
+    putLE<uint32_t>( m_buf, m_names->size() );
+
+    uint8_t packed = 0;
+    for( uint32_t h = 0; h < m_names->size(); ++h )
+    {
+        uint8_t st;
+        if( instIOPut *put = m_graph->handlePut( h ) )
+        {
+            st = static_cast<uint8_t>( put->state() );
+        }
+        else
+        {
+            st = static_cast<uint8_t>( m_graph->handleBeam( h )->state() );
+        }
+
+        packed |= st << ( 2 * ( h % 4 ) );
+
+        if( h % 4 == 3 || h + 1 == m_names->size() )
+        {
+            m_buf += static_cast<char>( packed );
+            packed = 0;
+        }
+    }
+
+    m_ckpOut.write( m_buf.data(), m_buf.size() );
+
+    indexEntry ie{ time, m_ckpSize, m_nDeltas };
+
+    m_ckpSize += m_buf.size();
+
+    m_buf.clear();
+    putLE<uint64_t>( m_buf, ie.time );
+    putLE<uint64_t>( m_buf, ie.ckpOffset );
+    putLE<uint64_t>( m_buf, ie.deltaIndex );
+    m_idxOut.write( m_buf.data(), m_buf.size() );
+
+    if( !m_ckpOut || !m_idxOut )
+    {
+        emsg = "error writing checkpoint to " + m_base;
+        return -1;
+    }
+
+    m_index.push_back( ie );
+    m_lastCheckpoint = m_nDeltas;
+
+    return 0;
+}
+
+int instHistory::flush( std::string &emsg )
+{
+    emsg = "";
+
+    // Deltas and checkpoints first, so a reader never finds an index entry without its data
+    m_dltOut.flush();
+    m_ckpOut.flush();
+    m_idxOut.flush();
+
+    if( m_graph && ( !m_dltOut || !m_ckpOut || !m_idxOut ) )
+    {
+        emsg = "error flushing " + m_base;
+        return -1;
+    }
+
+    return 0;
+}
+
+int instHistory::readIndex( std::string &emsg )
+{
+    std::ifstream fin( m_base + ".idx", std::ios::binary );
+
+    if( !fin )
+    {
+        emsg = "error opening " + m_base + ".idx";
+        return -1;
+    }
+
+    fin.seekg( m_indexOffset + m_index.size() * historyIndexSize );
+
+    indexEntry ie;
+    while( getLE( fin, ie.time ) && getLE( fin, ie.ckpOffset ) && getLE( fin, ie.deltaIndex ) )
+    {
+        m_index.push_back( ie );
+    }
+
+    return 0;
+}
+
+int instHistory::stateAt( std::string &emsg, historySnapshot &snap, uint64_t time )
+{
+    emsg = "";
+
+    if( m_graph )
+    {
+        if( flush( emsg ) < 0 )
+        {
+            return -1;
+        }
+    }
+    else if( readIndex( emsg ) < 0 )
+    {
+        return -1;
+    }
+
+    auto it = std::upper_bound( m_index.begin(),
+                                m_index.end(),
+                                time,
+                                []( uint64_t t, const indexEntry &ie ) { return t < ie.time; } );
+
+    if( it == m_index.begin() )
+    {
+        emsg = "no history at or before " + std::to_string( time );
+        return -1;
+    }
+
+    const indexEntry &ie = *( it - 1 );
+
+    // Read the checkpoint
+    std::ifstream ckp( m_base + ".ckp", std::ios::binary );
+    ckp.seekg( ie.ckpOffset );
+
+    uint64_t ckpTime;
+    uint32_t nHandles;
+    if( !getLE( ckp, ckpTime ) || !getLE( ckp, nHandles ) || nHandles != m_names->size() )
+    {
+        emsg = "invalid checkpoint in " + m_base + ".ckp";
+        return -1;
+    }
+
+    std::string packed( ( nHandles + 3 ) / 4, '\0' );
+    if( !ckp.read( packed.data(), packed.size() ) )
+    {
+        emsg = "truncated checkpoint in " + m_base + ".ckp";
+        return -1;
+    }
+
+    snap.m_states.resize( nHandles );
+    for( uint32_t h = 0; h < nHandles; ++h )
+    {
+        snap.m_states[h] = ( static_cast<uint8_t>( packed[h / 4] ) >> ( 2 * ( h % 4 ) ) ) & 0x3;
+    }
+
+    // Replay the deltas up to time
+    std::ifstream dlt( m_base + ".dlt", std::ios::binary );
+    dlt.seekg( ie.deltaIndex * journalRecordSize );
+
+    char bytes[journalRecordSize];
+    journalRecord rec;
+
+    while( dlt.read( bytes, journalRecordSize ) )
+    {
+        decodeJournalRecord( rec, bytes );
+
+        if( rec.time > time )
+        {
+            break;
+        }
+
+        if( rec.handle < nHandles )
+        {
+            snap.m_states[rec.handle] = rec.to;
+        }
+    }
+
+    snap.m_time = time;
+    snap.m_names = m_names;
+
+    return 0;
+}
+
+} // namespace ingr
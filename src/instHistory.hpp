@@ -0,0 +1,211 @@
+/** \file
+ *
+ * \brief A persistent history of states, with queries of the state at a past time
+ */
+
+#ifndef instHistory_hpp
+#define instHistory_hpp
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "instJournal.hpp"
+
+namespace ingr
+{
+
+class instGraph;
+
+/// The states of all puts and beams of a graph at one time, read from an \ref instHistory
+/**
+ * \ingroup explainer
+ */
+class historySnapshot
+{
+    friend class instHistory;
+
+  public:
+    /// The kind and name of each handle
+    typedef std::vector<std::pair<entityKind, std::string>> namesT;
+
+  protected:
+    uint64_t m_time{ 0 };                  ///< The time of the snapshot, ns since the Unix epoch
+
+    std::shared_ptr<const namesT> m_names; ///< The kind and name of each handle, shared with the history
+
+    std::vector<uint8_t> m_states;         ///< The state of each handle
+
+  public:
+    /// Get the time of the snapshot
+    /**
+     * \returns ns since the Unix epoch
+     */
+    uint64_t time() const;
+
+    /// Get the number of handles
+    /**
+     * \returns the number of puts and beams
+     */
+    size_t size() const;
+
+    /// Get the kind of entity with a handle
+    /**
+     * \returns whether handle \p h is a put or a beam
+     *
+     * \throws std::out_of_range if \p h is not a valid handle
+     */
+    entityKind kind( uint32_t h /**< [in] the handle */ ) const;
+
+    /// Get the name of the entity with a handle
+    /**
+     * \returns the name, as "i:node:put", "o:node:put", or "beam:name"
+     *
+     * \throws std::out_of_range if \p h is not a valid handle
+     */
+    const std::string &name( uint32_t h /**< [in] the handle */ ) const;
+
+    /// Get the state of a put
+    /**
+     * \returns the state of the put with handle \p h
+     *
+     * \throws std::out_of_range if \p h is not the handle of a put
+     */
+    putState put( uint32_t h /**< [in] the handle */ ) const;
+
+    /// Get the state of a beam
+    /**
+     * \returns the state of the beam with handle \p h
+     *
+     * \throws std::out_of_range if \p h is not the handle of a beam
+     */
+    beamState beam( uint32_t h /**< [in] the handle */ ) const;
+};
+
+/// A persistent history of the states of a graph
+/** A writer is attached to a graph with create(), and records every transition of its puts and beams.  The
+ * history is stored in three append-only files:
+ * - `<base>.idx`: the kind and name of each handle, followed by one index entry per checkpoint giving its
+ *   time, its offset in the checkpoint file, and the number of deltas written before it.
+ * - `<base>.ckp`: checkpoints, each the time followed by the state of every handle packed in 2 bits.
+ * - `<base>.dlt`: deltas, one 16-byte record per transition in the dump format of \ref instJournal.
+ *
+ * A checkpoint is written on create() and after every \p checkpointInterval deltas, so a query reads one
+ * checkpoint and replays at most that many deltas.  Queries search by time, so the times recorded never
+ * decrease: a delta or checkpoint stamped before the last one written, for instance after the system clock
+ * was stepped back, is recorded at the time of the last one.  A history can be reopened for writing after a
+ * restart as long as the graph has the same puts and beams.
+ *
+ * A reader uses open() and stateAt().  It can read a history while another process writes it, up to the
+ * last flush.
+ *
+ * \ingroup explainer
+ */
+class instHistory
+{
+  protected:
+    /// An entry in the sparse time index
+    struct indexEntry
+    {
+        uint64_t time;       ///< The time of the checkpoint
+        uint64_t ckpOffset;  ///< The offset of the checkpoint in the checkpoint file
+        uint64_t deltaIndex; ///< The number of deltas written before the checkpoint
+    };
+
+    std::string m_base;                            ///< The path of the files, without extension
+
+    std::shared_ptr<historySnapshot::namesT> m_names; ///< The kind and name of each handle
+
+    std::vector<indexEntry> m_index;               ///< The index entries read or written
+
+    uint64_t m_indexOffset{ 0 };                   ///< The offset of the first index entry in the index file
+
+    instGraph *m_graph{ nullptr };                 ///< The graph being recorded, if writing
+
+    std::ofstream m_idxOut;                        ///< The index file, if writing
+    std::ofstream m_ckpOut;                        ///< The checkpoint file, if writing
+    std::ofstream m_dltOut;                        ///< The delta file, if writing
+
+    uint64_t m_ckpSize{ 0 };                       ///< The size of the checkpoint file
+    uint64_t m_nDeltas{ 0 };                       ///< The number of deltas in the delta file
+    uint64_t m_lastCheckpoint{ 0 };                ///< The number of deltas at the last checkpoint
+    uint64_t m_lastTime{ 0 };                      ///< The time of the last delta or checkpoint written
+
+    size_t m_checkpointInterval{ 4096 };           ///< The number of deltas between checkpoints
+
+    std::string m_buf;                             ///< Buffer for formatting records
+
+  public:
+    /// Default c'tor
+    instHistory();
+
+    /// Destructor.  Detaches from the graph and flushes the files.
+    ~instHistory();
+
+    /// Start recording the history of a graph
+    /** Assigns handles, creates the files or opens existing ones for appending, writes a checkpoint, and
+     * attaches this to the graph.
+     *
+     * \returns 0 on success
+     * \returns -1 on error, with \p emsg set
+     */
+    int create( std::string &emsg,                 /**< [out] the error message */
+                const std::string &base,           /**< [in] the path of the files, without extension */
+                instGraph &graph,                  /**< [in] the graph to record */
+                size_t checkpointInterval = 4096   /**< [in] [optional] the number of deltas between checkpoints */
+    );
+
+    /// Open an existing history for reading
+    /**
+     * \returns 0 on success
+     * \returns -1 on error, with \p emsg set
+     */
+    int open( std::string &emsg,      /**< [out] the error message */
+              const std::string &base /**< [in] the path of the files, without extension */
+    );
+
+    /// Stop recording, detach from the graph, and close the files
+    void close();
+
+    /// Record a transition.  Called by the graph.
+    void record( const journalRecord &rec /**< [in] the transition */ );
+
+    /// Write a checkpoint of the current state of the graph
+    /**
+     * \returns 0 on success
+     * \returns -1 on error, with \p emsg set
+     */
+    int checkpoint( std::string &emsg, /**< [out] the error message */
+                    uint64_t time      /**< [in] the time of the checkpoint, ns since the Unix epoch */
+    );
+
+    /// Flush the files to disk so readers see all records
+    /**
+     * \returns 0 on success
+     * \returns -1 on error, with \p emsg set
+     */
+    int flush( std::string &emsg /**< [out] the error message */ );
+
+    /// Get the state of the graph at a time
+    /** Reads the last checkpoint at or before \p time, and replays the deltas up to \p time.  Index entries
+     * written since the last call are read first.
+     *
+     * \returns 0 on success
+     * \returns -1 on error, including if \p time is before the first checkpoint, with \p emsg set
+     */
+    int stateAt( std::string &emsg,      /**< [out] the error message */
+                 historySnapshot &snap,  /**< [out] the state at \p time */
+                 uint64_t time           /**< [in] the time, ns since the Unix epoch */
+    );
+
+  protected:
+    /// Read index entries appended since the last read
+    int readIndex( std::string &emsg /**< [out] the error message */ );
+};
+
+} // namespace ingr
+
+#endif // instHistory_hpp
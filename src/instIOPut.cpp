@@ -2,8 +2,9 @@
 #include "instNode.hpp"
 #include "instBeam.hpp"
 #include "instGraph.hpp"
+#include "instTrace.hpp"
 
-#include <iostream>
+#include <stdexcept>
 
 namespace ingr
 {
@@ -131,6 +132,10 @@ putState instIOPut::state() const
 
 void instIOPut::state( putState ns, bool nobeam, bool byOutputLink )
 {
+    INGR_TRACE_STATE_SCOPE( putState, this, m_state );
+
+    metricCascade cascade( m_parentGraph ? &m_parentGraph->metrics() : nullptr );
+
     // If this put is not enabled we can't do anything but turn it off
     if(!m_enabled && ns != putState::off)
     {
@@ -167,13 +172,22 @@ void instIOPut::state( putState ns, bool nobeam, bool byOutputLink )
         changed = true;
     }
 
+    putState from = m_state;
+
     m_state = ns;
 
     if( changed )
     {
         if( m_parentGraph )
         {
-            m_parentGraph->stateChange();
+            m_parentGraph->metrics().count( metricCounter::putTransitions );
+            m_parentGraph->recordTransition( entityKind::put,
+                                             m_handle,
+                                             static_cast<int>( from ),
+                                             static_cast<int>( ns ),
+                                             byOutputLink ? journalCause::outputLink
+                                                          : ( nobeam ? journalCause::beam : journalCause::external ) );
+            m_parentGraph->notifyStateChange();
         }
     }
 
@@ -204,7 +218,29 @@ bool instIOPut::enabled() const
 
 void instIOPut::enabled(bool en)
 {
+    bool changed = ( m_enabled != en );
+
     m_enabled = en;
+
+    if( changed && m_parentGraph )
+    {
+        m_parentGraph->notifyEnabledChange( m_handle );
+    }
+}
+
+uint32_t instIOPut::handle() const
+{
+    return m_handle;
+}
+
+void instIOPut::handle( uint32_t h )
+{
+    m_handle = h;
+}
+
+instGraph *instIOPut::parentGraph()
+{
+    return m_parentGraph;
 }
 
 void instIOPut::parentGraph( instGraph *ig )
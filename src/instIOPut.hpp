@@ -40,6 +40,7 @@ class instGraph;
  */
 class instIOPut
 {
+    friend class instOverlay;
 
   protected:
     instNode *m_node{ nullptr };      ///< The node to which this put belongs
@@ -72,6 +73,8 @@ class instIOPut
 
     void *m_auxData{ nullptr };          ///< Auxilliary data for this beam, i.e. for GUI support.
 
+    uint32_t m_handle{ invalidHandle };  ///< Compact identifier within the parent graph, see instGraph::assignHandles
+
   public:
     /// Default c'tor
     instIOPut();
@@ -216,6 +219,21 @@ class instIOPut
      */
     const std::set<std::string> &outputLinks();
 
+    /// Get the handle of this put
+    /**
+     * \returns the current value of m_handle
+     */
+    uint32_t handle() const;
+
+    /// Set the handle of this put
+    void handle( uint32_t h /**< [in] the new handle */ );
+
+    /// Get the parent instGraph
+    /**
+     * \returns the current value of m_parentGraph, which may be nullptr
+     */
+    instGraph *parentGraph();
+
     /// Set the parent instGraph
     void parentGraph( instGraph *ig /**< [in] pointer to the parent instGraph */ );
 
@@ -0,0 +1,284 @@
+#include <cstring>
+#include <fstream>
+
+#include "instJournal.hpp"
+
+namespace ingr
+{
+
+std::string journalCause2String( journalCause cause )
+{
+    if( cause == journalCause::external )
+        return "external";
+    else if( cause == journalCause::beam )
+        return "beam";
+    else if( cause == journalCause::outputLink )
+        return "outputLink";
+    else if( cause == journalCause::propagation )
+        return "propagation";
+    else
+        return "unknown";
+}
+
+instJournal::instJournal( size_t capacity )
+{
+    size_t cap = 1;
+    while( cap < capacity )
+    {
+        cap <<= 1;
+    }
+
+    m_slots.reset( new slot[cap] );
+    m_mask = cap - 1;
+}
+
+size_t instJournal::capacity() const
+{
+    return m_mask + 1;
+}
+
+uint64_t instJournal::appended() const
+{
+    return m_head.load( std::memory_order_acquire );
+}
+
+void instJournal::clear()
+{
+    for( size_t n = 0; n <= m_mask; ++n )
+    {
+        m_slots[n].sequence.store( 0, std::memory_order_relaxed );
+    }
+
+    m_head.store( 0, std::memory_order_release );
+}
+
+void instJournal::append( const journalRecord &rec )
+{
+    uint64_t n = m_head.fetch_add( 1, std::memory_order_relaxed );
+
+    slot &s = m_slots[n & m_mask];
+
+    s.sequence.store( 2 * n + 1, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+
+    s.time.store( rec.time, std::memory_order_relaxed );
+    s.word.store( static_cast<uint64_t>( rec.handle ) | ( static_cast<uint64_t>( rec.kind ) << 32 ) |
+                      ( static_cast<uint64_t>( rec.from ) << 40 ) | ( static_cast<uint64_t>( rec.to ) << 48 ) |
+                      ( static_cast<uint64_t>( rec.cause ) << 56 ),
+                  std::memory_order_relaxed );
+
+    s.sequence.store( 2 * n + 2, std::memory_order_release );
+}
+
+bool instJournal::read( journalRecord &rec, uint64_t n ) const
+{
+    const slot &s = m_slots[n & m_mask];
+
+    if( s.sequence.load( std::memory_order_acquire ) != 2 * n + 2 )
+    {
+        return false;
+    }
+
+    uint64_t time = s.time.load( std::memory_order_relaxed );
+    uint64_t word = s.word.load( std::memory_order_relaxed );
+
+    std::atomic_thread_fence( std::memory_order_acquire );
+
+    if( s.sequence.load( std::memory_order_relaxed ) != 2 * n + 2 )
+    {
+        return false; // overwritten while reading
+    }
+
+    rec.time = time;
+    rec.handle = static_cast<uint32_t>( word );
+    rec.kind = static_cast<entityKind>( ( word >> 32 ) & 0xFF );
+    rec.from = ( word >> 40 ) & 0xFF;
+    rec.to = ( word >> 48 ) & 0xFF;
+    rec.cause = static_cast<journalCause>( ( word >> 56 ) & 0xFF );
+
+    return true;
+}
+
+const std::vector<std::string> &instJournal::names() const
+{
+    return m_names;
+}
+
+void instJournal::names( const std::vector<std::string> &nms )
+{
+    m_names = nms;
+}
+
+instJournal::const_iterator instJournal::begin() const
+{
+    uint64_t end = m_head.load( std::memory_order_acquire );
+
+    return const_iterator( this, end > m_mask + 1 ? end - ( m_mask + 1 ) : 0, end );
+}
+
+instJournal::const_iterator instJournal::end() const
+{
+    return const_iterator();
+}
+
+void encodeJournalRecord( std::string &buf, const journalRecord &rec )
+{
+    putLE<uint64_t>( buf, rec.time );
+    putLE<uint32_t>( buf, rec.handle );
+    putLE<uint8_t>( buf, static_cast<uint8_t>( rec.kind ) );
+    putLE<uint8_t>( buf, rec.from );
+    putLE<uint8_t>( buf, rec.to );
+    putLE<uint8_t>( buf, static_cast<uint8_t>( rec.cause ) );
+}
+
+void decodeJournalRecord( journalRecord &rec, const char *bytes )
+{
+    const unsigned char *b = reinterpret_cast<const unsigned char *>( bytes );
+
+    rec.time = 0;
+    for( size_t n = 0; n < 8; ++n )
+    {
+        rec.time |= static_cast<uint64_t>( b[n] ) << ( 8 * n );
+    }
+
+    rec.handle = 0;
+    for( size_t n = 0; n < 4; ++n )
+    {
+        rec.handle |= static_cast<uint32_t>( b[8 + n] ) << ( 8 * n );
+    }
+
+    rec.kind = static_cast<entityKind>( b[12] );
+    rec.from = b[13];
+    rec.to = b[14];
+    rec.cause = static_cast<journalCause>( b[15] );
+}
+
+static const char journalMagic[] = "INGRJNL1";
+
+int instJournal::dump( std::string &emsg, const std::string &fname ) const
+{
+    emsg = "";
+
+    std::vector<journalRecord> recs;
+    recs.reserve( capacity() );
+
+    for( auto &rec : *this )
+    {
+        recs.push_back( rec );
+    }
+
+    std::string buf( journalMagic, 8 );
+
+    putLE<uint32_t>( buf, m_names.size() );
+    for( auto &nm : m_names )
+    {
+        putLE<uint32_t>( buf, nm.size() );
+        buf += nm;
+    }
+
+    putLE<uint64_t>( buf, recs.size() );
+    for( auto &rec : recs )
+    {
+        encodeJournalRecord( buf, rec );
+    }
+
+    std::ofstream fout( fname, std::ios::binary );
+    fout.write( buf.data(), buf.size() );
+
+    if( !fout )
+    {
+        emsg = "error writing " + fname;
+        return -1;
+    }
+
+    return 0;
+}
+
+int instJournal::readDump( std::string &emsg,
+                           std::vector<std::string> &names,
+                           std::vector<journalRecord> &recs,
+                           const std::string &fname )
+{
+    emsg = "";
+    names.clear();
+    recs.clear();
+
+    std::ifstream fin( fname, std::ios::binary );
+
+    if( !fin )
+    {
+        emsg = "error opening " + fname;
+        return -1;
+    }
+
+    char magic[8];
+    if( !fin.read( magic, 8 ) || memcmp( magic, journalMagic, 8 ) != 0 )
+    {
+        emsg = fname + " is not a journal dump";
+        return -1;
+    }
+
+    // The name lengths are bounded by the size of the file, so a corrupt length can't cause a huge allocation
+    fin.seekg( 0, std::ios::end );
+    uint64_t fileSize = fin.tellg();
+    fin.seekg( 8 );
+
+    uint32_t nNames;
+    if( !getLE( fin, nNames ) )
+    {
+        emsg = fname + " is truncated";
+        return -1;
+    }
+
+    for( uint32_t n = 0; n < nNames; ++n )
+    {
+        uint32_t len;
+        std::string nm;
+
+        if( getLE( fin, len ) )
+        {
+            if( len > fileSize - static_cast<uint64_t>( fin.tellg() ) )
+            {
+                emsg = fname + " is truncated or has a corrupt name length";
+                return -1;
+            }
+
+            nm.resize( len );
+            fin.read( nm.data(), len );
+        }
+
+        if( !fin )
+        {
+            emsg = fname + " is truncated";
+            return -1;
+        }
+
+        names.push_back( std::move( nm ) );
+    }
+
+    uint64_t nRecs;
+    if( !getLE( fin, nRecs ) )
+    {
+        emsg = fname + " is truncated";
+        return -1;
+    }
+
+    for( uint64_t n = 0; n < nRecs; ++n )
+    {
+        char bytes[journalRecordSize];
+
+        if( !fin.read( bytes, journalRecordSize ) )
+        {
+            emsg = fname + " is truncated";
+            return -1;
+        }
+
+        journalRecord rec;
+        decodeJournalRecord( rec, bytes );
+        recs.push_back( rec );
+    }
+
+    return 0;
+}
+
+} // namespace ingr
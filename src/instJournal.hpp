@@ -0,0 +1,291 @@
+/** \file
+ *
+ * \brief A journal of state transitions in a preallocated ring buffer
+ */
+
+#ifndef instJournal_hpp
+#define instJournal_hpp
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "basicTypes.hpp"
+
+namespace ingr
+{
+
+/// What caused a transition
+/** \ingroup basic_types
+ */
+enum class journalCause : uint8_t
+{
+    external,   ///< A put's state was set by a caller outside the graph
+    beam,       ///< A put's state was set by its beam
+    outputLink, ///< An output's state was set by the inputs linked to it
+    propagation ///< A beam's state was recalculated from its puts
+};
+
+/// Get a string representation of a journal cause
+/**
+ * \returns a string with value "external", "beam", "outputLink", or "propagation"
+ */
+std::string journalCause2String( journalCause cause /**< [in] the cause */ );
+
+/// Get the current time as used in journal records
+/**
+ * \returns nanoseconds since the Unix epoch, from system_clock
+ */
+inline uint64_t journalTime()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::system_clock::now().time_since_epoch() )
+        .count();
+}
+
+/// A single transition
+/**
+ * \ingroup explainer
+ */
+struct journalRecord
+{
+    uint64_t time{ 0 };                  ///< Nanoseconds since the Unix epoch, from system_clock
+    uint32_t handle{ invalidHandle };    ///< The handle of the put or beam
+    entityKind kind{ entityKind::put };  ///< Whether handle refers to a put or a beam
+    uint8_t from{ 0 };                   ///< The old state, a putState or beamState according to kind
+    uint8_t to{ 0 };                     ///< The new state, a putState or beamState according to kind
+    journalCause cause{ journalCause::external }; ///< What caused the transition
+};
+
+/// The size of a record in the dump format
+constexpr size_t journalRecordSize = 16;
+
+/// Append a record to a buffer in the dump format
+void encodeJournalRecord( std::string &buf,          /**< [in/out] the buffer */
+                          const journalRecord &rec    /**< [in] the record */
+);
+
+/// Decode a record in the dump format
+void decodeJournalRecord( journalRecord &rec, /**< [out] the record */
+                          const char *bytes   /**< [in] \ref journalRecordSize bytes */
+);
+
+/// Append an unsigned integer to a buffer in little-endian order
+template <typename uintT>
+void putLE( std::string &buf, uintT val )
+{
+    for( size_t n = 0; n < sizeof( uintT ); ++n )
+    {
+        buf += static_cast<char>( ( val >> ( 8 * n ) ) & 0xFF );
+    }
+}
+
+/// Read a little-endian unsigned integer from a stream
+/**
+ * \returns true on success
+ * \returns false if the stream ended
+ */
+template <typename uintT>
+bool getLE( std::istream &in, uintT &val )
+{
+    unsigned char bytes[sizeof( uintT )];
+
+    if( !in.read( reinterpret_cast<char *>( bytes ), sizeof( uintT ) ) )
+    {
+        return false;
+    }
+
+    val = 0;
+    for( size_t n = 0; n < sizeof( uintT ); ++n )
+    {
+        val |= static_cast<uintT>( bytes[n] ) << ( 8 * n );
+    }
+
+    return true;
+}
+
+/// A journal of state transitions
+/** Records are appended to a ring buffer allocated on construction, overwriting the oldest records once it
+ * is full.  Appending takes a single atomic increment to claim a slot and never allocates or blocks.
+ * Iteration can run concurrently with appending, and skips records which are overwritten or incomplete.
+ *
+ * Attach the journal to a graph with instGraph::journal, which assigns handles to the puts and beams and
+ * sets the names used in dumps.
+ *
+ * The dump format is little-endian:
+ * - 8 bytes: the magic "INGRJNL1"
+ * - uint32: the number of names, followed by each name as a uint32 length and the characters.  Name n is
+ *   the name of handle n, as "i:node:put", "o:node:put", or "beam:name".
+ * - uint64: the number of records, followed by each record as uint64 time, uint32 handle, and uint8 kind,
+ *   from, to, and cause, for 16 bytes per record.
+ *
+ * \ingroup explainer
+ */
+class instJournal
+{
+  protected:
+    /// A record in the ring.  Every field is atomic so that readers racing a writer are well defined.
+    struct slot
+    {
+        std::atomic<uint64_t> sequence{ 0 }; ///< 2n+1 while record n is being written, 2n+2 once complete
+        std::atomic<uint64_t> time{ 0 };     ///< The record's time
+        std::atomic<uint64_t> word{ 0 };     ///< The record's handle, kind, from, to, and cause, packed
+    };
+
+    std::unique_ptr<slot[]> m_slots;      ///< The ring buffer
+
+    size_t m_mask{ 0 };                   ///< The capacity minus 1, the capacity being a power of 2
+
+    std::atomic<uint64_t> m_head{ 0 };    ///< The number of records appended
+
+    std::vector<std::string> m_names;     ///< The names of the handles, indexed by handle
+
+  public:
+    /// Construct with the capacity
+    explicit instJournal( size_t capacity /**< [in] the number of records, rounded up to a power of 2 */ );
+
+    /// Get the capacity
+    /**
+     * \returns the number of records retained
+     */
+    size_t capacity() const;
+
+    /// Get the number of records appended since construction or the last clear
+    /**
+     * \returns the current value of m_head
+     */
+    uint64_t appended() const;
+
+    /// Discard all records.  Must not be called while appending.
+    void clear();
+
+    /// Append a record
+    void append( const journalRecord &rec /**< [in] the record */ );
+
+    /// Read record \p n, the nth appended
+    /**
+     * \returns true if the record is complete and was read
+     * \returns false if it is not yet complete or has been overwritten
+     */
+    bool read( journalRecord &rec, /**< [out] the record */
+               uint64_t n          /**< [in] the record number */
+    ) const;
+
+    /// Get the names of the handles
+    /**
+     * \returns a reference to m_names
+     */
+    const std::vector<std::string> &names() const;
+
+    /// Set the names of the handles
+    void names( const std::vector<std::string> &nms /**< [in] the names, indexed by handle */ );
+
+    /// Iterates over the retained records, oldest first
+    class const_iterator
+    {
+      protected:
+        const instJournal *m_journal{ nullptr };
+        uint64_t m_pos{ 0 };
+        uint64_t m_end{ 0 };
+        journalRecord m_rec;
+
+        // Advance to the next record which can be read
+        void settle()
+        {
+            while( m_pos < m_end && !m_journal->read( m_rec, m_pos ) )
+            {
+                ++m_pos;
+            }
+        }
+
+      public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef journalRecord value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const journalRecord *pointer;
+        typedef const journalRecord &reference;
+
+        const_iterator()
+        {
+        }
+
+        const_iterator( const instJournal *journal, uint64_t pos, uint64_t end )
+            : m_journal{ journal }, m_pos{ pos }, m_end{ end }
+        {
+            settle();
+        }
+
+        reference operator*() const
+        {
+            return m_rec;
+        }
+
+        pointer operator->() const
+        {
+            return &m_rec;
+        }
+
+        const_iterator &operator++()
+        {
+            ++m_pos;
+            settle();
+            return *this;
+        }
+
+        const_iterator operator++( int )
+        {
+            const_iterator it = *this;
+            ++( *this );
+            return it;
+        }
+
+        bool operator==( const const_iterator &it ) const
+        {
+            bool done = ( m_pos >= m_end );
+            bool itDone = ( it.m_pos >= it.m_end );
+
+            return ( done && itDone ) || ( !done && !itDone && m_pos == it.m_pos );
+        }
+
+        bool operator!=( const const_iterator &it ) const
+        {
+            return !( *this == it );
+        }
+    };
+
+    /// Get an iterator to the oldest retained record
+    /** The iteration ends at the last record appended before this call.
+     */
+    const_iterator begin() const;
+
+    /// Get the end iterator
+    const_iterator end() const;
+
+    /// Write the names and retained records to a file
+    /**
+     * \returns 0 on success
+     * \returns -1 on error, with \p emsg set
+     */
+    int dump( std::string &emsg,        /**< [out] the error message */
+              const std::string &fname  /**< [in] the file to write */
+    ) const;
+
+    /// Read a file written by dump
+    /**
+     * \returns 0 on success
+     * \returns -1 on error, with \p emsg set
+     */
+    static int readDump( std::string &emsg,                 /**< [out] the error message */
+                         std::vector<std::string> &names,   /**< [out] the names of the handles */
+                         std::vector<journalRecord> &recs,  /**< [out] the records, oldest first */
+                         const std::string &fname           /**< [in] the file to read */
+    );
+};
+
+} // namespace ingr
+
+#endif // instJournal_hpp
@@ -0,0 +1,342 @@
+#include <algorithm>
+
+#include "instLazy.hpp"
+#include "instGraph.hpp"
+
+namespace ingr
+{
+
+instLazy::instLazy( instGraph &graph ) : m_graph{ &graph }, m_eval{ graph }
+{
+    compileCones();
+}
+
+void instLazy::compile()
+{
+    m_eval.compile();
+
+    compileCones();
+}
+
+void instLazy::compileCones()
+{
+    size_t nHandles = m_graph->nHandles();
+
+    m_puts.clear();
+    while( m_puts.size() < nHandles && m_graph->handlePut( m_puts.size() ) != nullptr )
+    {
+        m_puts.push_back( m_graph->handlePut( m_puts.size() ) );
+    }
+
+    m_downStart.assign( nHandles + 1, 0 );
+    m_down.clear();
+
+    for( uint32_t h = 0; h < nHandles; ++h )
+    {
+        m_downStart[h] = m_down.size();
+
+        if( h >= m_puts.size() )
+        {
+            // A beam changes its dest
+            instBeam *beam = m_graph->handleBeam( h );
+
+            if( beam->destValid() )
+            {
+                m_down.push_back( beam->dest()->handle() );
+            }
+
+            continue;
+        }
+
+        // A put changes its beam, whether it is the source or the dest
+        instIOPut *put = m_puts[h];
+
+        if( put->beamValid() )
+        {
+            m_down.push_back( put->beam()->handle() );
+        }
+
+        if( put->io() == ioDir::input && put->nodeValid() )
+        {
+            for( auto &&ol : put->outputLinks() )
+            {
+                if( put->node()->outputValid( ol ) )
+                {
+                    m_down.push_back( put->node()->output( ol )->handle() );
+                }
+            }
+        }
+    }
+    m_downStart[nHandles] = m_down.size();
+
+    m_writes.clear();
+    m_members.clear();
+    m_generation = 0;
+    m_base = 0;
+    m_pending = 0;
+    m_front = 0;
+    m_dirty.assign( nHandles, 0 );
+}
+
+void instLazy::load()
+{
+    m_eval.load();
+
+    m_writes.clear();
+    m_members.clear();
+    m_base = m_generation;
+    m_pending = 0;
+    m_front = 0;
+}
+
+putState instLazy::state( const instIOPut *put )
+{
+    evaluate( put->handle() );
+
+    return m_eval.state( put );
+}
+
+beamState instLazy::state( const instBeam *beam )
+{
+    evaluate( beam->handle() );
+
+    return m_eval.state( beam );
+}
+
+bool instLazy::enabled( const instIOPut *put )
+{
+    evaluate( put->handle() );
+
+    return m_eval.enabled( put );
+}
+
+void instLazy::state( const instIOPut *put, putState ns )
+{
+    write w;
+    w.handle = put->handle();
+    w.enable = false;
+    w.value = static_cast<uint8_t>( ns );
+
+    queue( w );
+}
+
+void instLazy::enabled( const instIOPut *put, bool en )
+{
+    write w;
+    w.handle = put->handle();
+    w.enable = true;
+    w.value = en;
+
+    queue( w );
+}
+
+void instLazy::flush()
+{
+    for( uint64_t gen = m_base + 1; gen <= m_generation; ++gen )
+    {
+        if( isPending( gen ) )
+        {
+            apply( gen );
+        }
+    }
+}
+
+void instLazy::maxQueued( size_t mq )
+{
+    m_maxQueued = std::max<size_t>( mq, 1 );
+}
+
+size_t instLazy::maxQueued() const
+{
+    return m_maxQueued;
+}
+
+uint64_t instLazy::generation() const
+{
+    return m_generation;
+}
+
+uint64_t instLazy::applied() const
+{
+    return m_applied;
+}
+
+uint64_t instLazy::generation( uint32_t h ) const
+{
+    return m_dirty[h];
+}
+
+bool instLazy::dirty( uint32_t h ) const
+{
+    return isPending( m_dirty[h] );
+}
+
+size_t instLazy::pending() const
+{
+    return m_pending;
+}
+
+void instLazy::queue( const write &w )
+{
+    uint64_t gen = ++m_generation;
+    ++m_pending;
+
+    m_writes.push_back( w );
+    m_writes.back().group = gen;
+    m_members.push_back( { gen } );
+
+    // A dirty put or beam has its cone dirty already, in the group which marked it
+    m_queue.clear();
+
+    if( isPending( m_dirty[w.handle] ) )
+    {
+        join( gen, m_dirty[w.handle] );
+    }
+    else
+    {
+        m_dirty[w.handle] = gen;
+        m_queue.push_back( w.handle );
+    }
+
+    for( size_t q = 0; q < m_queue.size(); ++q )
+    {
+        uint32_t v = m_queue[q];
+
+        for( uint32_t n = m_downStart[v]; n < m_downStart[v + 1]; ++n )
+        {
+            uint32_t d = m_down[n];
+
+            if( m_dirty[d] == gen )
+            {
+                continue;
+            }
+
+            if( isPending( m_dirty[d] ) )
+            {
+                join( gen, m_dirty[d] );
+                continue;
+            }
+
+            m_dirty[d] = gen;
+            m_queue.push_back( d );
+        }
+    }
+
+    // Apply the oldest groups to bound the queue, m_front being the oldest write not applied
+    while( m_writes.size() > m_maxQueued )
+    {
+        apply( m_base + m_front + 1 );
+    }
+}
+
+instLazy::write &instLazy::writeAt( uint64_t gen )
+{
+    return m_writes[gen - m_base - 1];
+}
+
+bool instLazy::isPending( uint64_t gen ) const
+{
+    return gen > m_base && !m_writes[gen - m_base - 1].applied;
+}
+
+uint64_t instLazy::group( uint64_t gen )
+{
+    while( writeAt( gen ).group != gen )
+    {
+        uint64_t parent = writeAt( gen ).group;
+        writeAt( gen ).group = writeAt( parent ).group;
+        gen = parent;
+    }
+
+    return gen;
+}
+
+void instLazy::join( uint64_t a, uint64_t b )
+{
+    a = group( a );
+    b = group( b );
+
+    if( a == b )
+    {
+        return;
+    }
+
+    // The smaller group joins the larger
+    if( m_members[a - m_base - 1].size() < m_members[b - m_base - 1].size() )
+    {
+        std::swap( a, b );
+    }
+
+    std::vector<uint64_t> &ma = m_members[a - m_base - 1];
+    std::vector<uint64_t> &mb = m_members[b - m_base - 1];
+
+    writeAt( b ).group = a;
+    ma.insert( ma.end(), mb.begin(), mb.end() );
+    std::vector<uint64_t>().swap( mb );
+}
+
+void instLazy::apply( uint64_t gen )
+{
+    std::vector<uint64_t> members;
+    members.swap( m_members[group( gen ) - m_base - 1] );
+
+    std::sort( members.begin(), members.end() );
+
+    for( auto &&g : members )
+    {
+        write &w = writeAt( g );
+
+        if( w.enable )
+        {
+            m_eval.enabled( m_puts[w.handle], w.value );
+        }
+        else
+        {
+            m_eval.state( m_puts[w.handle], static_cast<putState>( w.value ) );
+        }
+
+        w.applied = true;
+    }
+
+    m_applied += members.size();
+    m_pending -= members.size();
+
+    compact();
+}
+
+void instLazy::compact()
+{
+    while( m_front < m_writes.size() && m_writes[m_front].applied )
+    {
+        ++m_front;
+    }
+
+    // Once everything is applied the queue starts again
+    if( m_front == m_writes.size() )
+    {
+        m_writes.clear();
+        m_members.clear();
+        m_base = m_generation;
+        m_front = 0;
+        return;
+    }
+
+    // Erasing only once the applied writes are half the queue keeps the cost proportional to the writes
+    if( 2 * m_front >= m_writes.size() )
+    {
+        m_writes.erase( m_writes.begin(), m_writes.begin() + m_front );
+        m_members.erase( m_members.begin(), m_members.begin() + m_front );
+        m_base += m_front;
+        m_front = 0;
+    }
+}
+
+void instLazy::evaluate( uint32_t h )
+{
+    if( isPending( m_dirty[h] ) )
+    {
+        apply( m_dirty[h] );
+    }
+}
+
+} // namespace ingr
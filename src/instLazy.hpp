@@ -0,0 +1,208 @@
+/** \file
+ *
+ * \brief A lazy evaluation of a graph, which propagates changes only when a state is read
+ */
+
+#ifndef instLazy_hpp
+#define instLazy_hpp
+
+#include <cstdint>
+#include <vector>
+
+#include "basicTypes.hpp"
+#include "instCompiled.hpp"
+
+namespace ingr
+{
+
+class instGraph;
+class instIOPut;
+class instBeam;
+
+/// A pull-based evaluation of a graph's propagation, with memoized states and dirty invalidation
+/** Writes with state() and enabled() do not propagate.  Each is queued with the next generation, and the
+ * puts and beams it can change, its downstream cone, are marked dirty with that generation.  A put or beam
+ * which is read while dirty has its upstream writes evaluated: the queued writes which can change it are
+ * applied to an instCompiled evaluation, where the states are memoized for later reads.  A read of a put or
+ * beam which no queued write can change is a lookup.
+ *
+ * Propagation in the graph depends on the order of changes, for instance a disabled put keeps its state, so
+ * queued writes whose cones overlap are kept in one group, which is applied as a whole in the order the
+ * writes were made.  Writes in different groups can't affect each other, so the states read always match
+ * those of eager propagation of the same writes.  Marking a cone stops at a put or beam which is already
+ * dirty, joining the group which marked it, since everything downstream of it is already dirty in that
+ * group.  Writing the same part of the graph again is then cheap.
+ *
+ * The downstream cone of a put is its beam and, through the beam's dest and its output links, everything the
+ * light can reach from it.  Enabling or disabling a put changes no state, but it marks the same cone so
+ * that the cones of a group stay closed downstream.  The graph itself is not changed.
+ *
+ * Applied writes are dropped from the front of the queue once they are at least half of it.  A write which is
+ * never read stays queued, so to bound the memory, once more than maxQueued() writes are held the oldest
+ * groups are applied as they would be by flush().
+ *
+ * Call compile() again after changing the topology of the graph.
+ *
+ * \ingroup explainer
+ */
+class instLazy
+{
+  protected:
+    /// A queued write
+    struct write
+    {
+        uint32_t handle;       ///< The put
+        bool enable;           ///< Whether this sets the enabled flag rather than the state
+        uint8_t value;         ///< The new state, or the new enabled flag
+        bool applied{ false }; ///< Whether the write has been applied
+        uint64_t group{ 0 };   ///< The generation of the parent write in its group, itself for the root
+    };
+
+    instGraph *m_graph{ nullptr }; ///< The graph
+
+    instCompiled m_eval;           ///< The evaluation the writes are applied to, holding the memoized states
+
+    std::vector<instIOPut *> m_puts; ///< The puts, by handle
+
+    std::vector<uint32_t> m_downStart; ///< For each put and beam, the start of its successors in m_down
+    std::vector<uint32_t> m_down;      ///< The puts and beams each put or beam can change directly
+
+    std::vector<write> m_writes;                 ///< The writes since m_base, the first being generation m_base + 1
+    std::vector<std::vector<uint64_t>> m_members; ///< The generations of the writes in each group, by root
+
+    uint64_t m_generation{ 0 }; ///< The generation of the last write
+    uint64_t m_base{ 0 };       ///< The generation before the first write in m_writes
+    size_t m_pending{ 0 };      ///< The number of writes not yet applied
+    uint64_t m_applied{ 0 };    ///< The number of writes applied
+    size_t m_front{ 0 };        ///< The number of applied writes at the front of m_writes
+    size_t m_maxQueued{ 65536 }; ///< The number of writes held before the oldest groups are applied
+
+    std::vector<uint64_t> m_dirty; ///< For each put and beam, the generation of the last write which marked it
+
+    std::vector<uint32_t> m_queue; ///< Working space for marking a cone
+
+  public:
+    /// Construct for a graph, compiling it
+    explicit instLazy( instGraph &graph /**< [in] the graph, which must outlive the evaluation */ );
+
+    /// Compile the topology of the graph and load its states, discarding queued writes
+    /** Assigns handles in the graph.
+     */
+    void compile();
+
+    /// Load the states and enabled flags from the graph, discarding queued writes
+    void load();
+
+    /// Get the state of a put, evaluating the writes which can change it
+    /**
+     * \returns the state, as eager propagation of the writes would leave it
+     */
+    putState state( const instIOPut *put /**< [in] the put */ );
+
+    /// Get the state of a beam, evaluating the writes which can change it
+    /**
+     * \returns the state, as eager propagation of the writes would leave it
+     */
+    beamState state( const instBeam *beam /**< [in] the beam */ );
+
+    /// Get whether a put is enabled, evaluating the writes which can change it
+    /**
+     * \returns the enabled flag
+     */
+    bool enabled( const instIOPut *put /**< [in] the put */ );
+
+    /// Set the state of a put, marking its downstream cone dirty
+    void state( const instIOPut *put, /**< [in] the put */
+                putState ns           /**< [in] the new state */
+    );
+
+    /// Set whether a put is enabled, marking its downstream cone dirty
+    void enabled( const instIOPut *put, /**< [in] the put */
+                  bool en               /**< [in] the new enabled flag */
+    );
+
+    /// Apply all queued writes
+    void flush();
+
+    /// Set the number of writes held before the oldest groups are applied
+    void maxQueued( size_t mq /**< [in] the new maximum, at least 1 */ );
+
+    /// Get the number of writes held before the oldest groups are applied
+    /**
+     * \returns the current value of m_maxQueued
+     */
+    size_t maxQueued() const;
+
+    /// Get the generation of the last write
+    /**
+     * \returns the current value of m_generation
+     */
+    uint64_t generation() const;
+
+    /// Get the number of writes applied
+    /**
+     * \returns the current value of m_applied
+     */
+    uint64_t applied() const;
+
+    /// Get the generation of the last write which marked a put or beam dirty
+    /**
+     * \returns the generation, 0 if never marked
+     */
+    uint64_t generation( uint32_t h /**< [in] the handle of the put or beam */ ) const;
+
+    /// Check if a put or beam has writes to evaluate before it can be read
+    /**
+     * \returns true if a write which can change it has not been applied
+     */
+    bool dirty( uint32_t h /**< [in] the handle of the put or beam */ ) const;
+
+    /// Get the number of queued writes
+    /**
+     * \returns the number of writes not yet applied
+     */
+    size_t pending() const;
+
+  protected:
+    /// Compile the downstream cones from the handles assigned by m_eval, discarding queued writes
+    void compileCones();
+
+    /// Queue a write and mark the puts and beams it can change
+    void queue( const write &w /**< [in] the write */ );
+
+    /// Get a write by generation
+    /**
+     * \returns a reference to the write
+     */
+    write &writeAt( uint64_t gen /**< [in] the generation, greater than m_base */ );
+
+    /// Check if the write of a generation is still to be applied
+    /**
+     * \returns true if the write is queued and not applied
+     */
+    bool isPending( uint64_t gen /**< [in] the generation */ ) const;
+
+    /// Find the group of a queued write
+    /**
+     * \returns the generation of the root of the group
+     */
+    uint64_t group( uint64_t gen /**< [in] the generation */ );
+
+    /// Join the groups of two queued writes
+    void join( uint64_t a, /**< [in] the generation of one write */
+               uint64_t b  /**< [in] the generation of the other */
+    );
+
+    /// Apply the group of a write
+    void apply( uint64_t gen /**< [in] the generation of the write */ );
+
+    /// Drop the applied writes at the front of the queue, once they are at least half of it
+    void compact();
+
+    /// Apply the writes which can change a put or beam
+    void evaluate( uint32_t h /**< [in] the handle */ );
+};
+
+} // namespace ingr
+
+#endif // instLazy_hpp
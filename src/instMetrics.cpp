@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "instMetrics.hpp"
+
+namespace ingr
+{
+
+std::string metricCounter2String( metricCounter mc )
+{
+    switch( mc )
+    {
+    case metricCounter::putStateCalls:
+        return "put_state_calls";
+    case metricCounter::putTransitions:
+        return "put_transitions";
+    case metricCounter::beamStateChanges:
+        return "beam_state_changes";
+    case metricCounter::beamTransitions:
+        return "beam_transitions";
+    case metricCounter::outputLinkChecks:
+        return "output_link_checks";
+    case metricCounter::graphNotifications:
+        return "graph_notifications";
+    case metricCounter::saves:
+        return "saves";
+    }
+
+    return "unknown";
+}
+
+std::string metricHistogram2String( metricHistogram mh )
+{
+    switch( mh )
+    {
+    case metricHistogram::cascade:
+        return "cascade";
+    case metricHistogram::render:
+        return "render";
+    case metricHistogram::save:
+        return "save";
+    case metricHistogram::cascadeToRender:
+        return "cascade_to_render";
+    case metricHistogram::cascadeToSave:
+        return "cascade_to_save";
+    case metricHistogram::cascadeToPublish:
+        return "cascade_to_publish";
+    }
+
+    return "unknown";
+}
+
+double latencyHistogram::bucketUpper( size_t b )
+{
+    if( b < subBuckets )
+    {
+        return b + 1;
+    }
+
+    size_t g = b / subBuckets;
+    size_t s = b % subBuckets;
+
+    // bucket b covers [subBuckets + s, subBuckets + s + 1) * 2^(g-1)
+    return std::ldexp( static_cast<double>( subBuckets + s + 1 ), g - 1 );
+}
+
+double latencySnapshot::quantile( double q ) const
+{
+    uint64_t total = 0;
+    for( uint64_t c : buckets )
+    {
+        total += c;
+    }
+
+    if( total == 0 )
+    {
+        return 0;
+    }
+
+    double rank = std::clamp( q, 0.0, 1.0 ) * total;
+
+    uint64_t cum = 0;
+    for( size_t b = 0; b < buckets.size(); ++b )
+    {
+        if( buckets[b] == 0 )
+        {
+            continue;
+        }
+
+        if( cum + buckets[b] >= rank )
+        {
+            double lower = ( b == 0 ) ? 0 : latencyHistogram::bucketUpper( b - 1 );
+            double upper = latencyHistogram::bucketUpper( b );
+
+            double est = lower + ( upper - lower ) * ( rank - cum ) / buckets[b];
+
+            return std::min( est, static_cast<double>( max ) );
+        }
+
+        cum += buckets[b];
+    }
+
+    return max;
+}
+
+void latencyHistogram::snapshot( latencySnapshot &snap ) const
+{
+    snap.buckets.resize( nBuckets );
+
+    for( size_t b = 0; b < nBuckets; ++b )
+    {
+        snap.buckets[b] = m_buckets[b].load( std::memory_order_relaxed );
+    }
+
+    snap.count = m_count.load( std::memory_order_relaxed );
+    snap.sum = m_sum.load( std::memory_order_relaxed );
+    snap.max = m_max.load( std::memory_order_relaxed );
+}
+
+void latencyHistogram::reset()
+{
+    for( auto &b : m_buckets )
+    {
+        b.store( 0, std::memory_order_relaxed );
+    }
+
+    m_count.store( 0, std::memory_order_relaxed );
+    m_sum.store( 0, std::memory_order_relaxed );
+    m_max.store( 0, std::memory_order_relaxed );
+}
+
+uint64_t instMetrics::counter( metricCounter mc ) const
+{
+    return m_counters[static_cast<size_t>( mc )].load( std::memory_order_relaxed );
+}
+
+void instMetrics::beginCascade()
+{
+    count( metricCounter::putStateCalls );
+
+    if( m_cascadeDepth++ == 0 )
+    {
+        m_cascadeStart = now();
+    }
+}
+
+void instMetrics::endCascade()
+{
+    if( --m_cascadeDepth > 0 )
+    {
+        return;
+    }
+
+    record( metricHistogram::cascade, now() - m_cascadeStart );
+
+    for( metricHistogram mh :
+         { metricHistogram::cascadeToRender, metricHistogram::cascadeToSave, metricHistogram::cascadeToPublish } )
+    {
+        uint64_t &end = m_stageEnd[static_cast<size_t>( mh )];
+
+        if( end > 0 )
+        {
+            record( mh, end - m_cascadeStart );
+            end = 0;
+        }
+    }
+}
+
+void instMetrics::snapshot( latencySnapshot &snap, metricHistogram mh ) const
+{
+    m_histograms[static_cast<size_t>( mh )].snapshot( snap );
+}
+
+void instMetrics::snapshot( metricsSnapshot &snap ) const
+{
+    for( size_t n = 0; n < nMetricCounters; ++n )
+    {
+        snap.counters[n] = m_counters[n].load( std::memory_order_relaxed );
+    }
+
+    for( size_t n = 0; n < nMetricHistograms; ++n )
+    {
+        m_histograms[n].snapshot( snap.histograms[n] );
+    }
+}
+
+void instMetrics::reset()
+{
+    for( auto &c : m_counters )
+    {
+        c.store( 0, std::memory_order_relaxed );
+    }
+
+    for( auto &h : m_histograms )
+    {
+        h.reset();
+    }
+}
+
+std::string instMetrics::prometheus( const std::string &prefix ) const
+{
+    metricsSnapshot snap;
+    snapshot( snap );
+
+    std::string txt;
+    char num[64];
+
+    for( size_t n = 0; n < nMetricCounters; ++n )
+    {
+        std::string name = prefix + "_" + metricCounter2String( static_cast<metricCounter>( n ) ) + "_total";
+
+        txt += "# TYPE " + name + " counter\n";
+        txt += name + " " + std::to_string( snap.counters[n] ) + "\n";
+    }
+
+    for( size_t n = 0; n < nMetricHistograms; ++n )
+    {
+        const latencySnapshot &ls = snap.histograms[n];
+
+        std::string name = prefix + "_" + metricHistogram2String( static_cast<metricHistogram>( n ) ) + "_seconds";
+
+        txt += "# TYPE " + name + " histogram\n";
+
+        // Export the same bounds on every scrape, up to the highest bucket ever populated
+        size_t nb = 0;
+        for( size_t b = ls.buckets.size(); b > 0; --b )
+        {
+            if( ls.buckets[b - 1] > 0 )
+            {
+                nb = b;
+                break;
+            }
+        }
+
+        size_t exported = m_exportedBuckets[n].load( std::memory_order_relaxed );
+        while( nb > exported && !m_exportedBuckets[n].compare_exchange_weak( exported, nb, std::memory_order_relaxed ) )
+        {
+        }
+        nb = std::max( nb, exported );
+
+        uint64_t cum = 0;
+        for( size_t b = 0; b < nb; ++b )
+        {
+            cum += ls.buckets[b];
+
+            // A bucket holds whole ns below its upper bound, and le is inclusive
+            snprintf( num, sizeof( num ), "%.9g", ( latencyHistogram::bucketUpper( b ) - 1 ) * 1e-9 );
+            txt += name + "_bucket{le=\"" + num + "\"} " + std::to_string( cum ) + "\n";
+        }
+
+        // Use the bucket total, which may differ from ls.count if samples were recorded during the snapshot
+        txt += name + "_bucket{le=\"+Inf\"} " + std::to_string( cum ) + "\n";
+
+        snprintf( num, sizeof( num ), "%.9g", ls.sum * 1e-9 );
+        txt += name + "_sum " + num + "\n";
+        txt += name + "_count " + std::to_string( cum ) + "\n";
+
+        // The summary statistics are a separate family, so they do not extend the histogram's name
+        std::string gauge = prefix + "_" + metricHistogram2String( static_cast<metricHistogram>( n ) ) +
+                            "_latency_seconds";
+
+        txt += "# TYPE " + gauge + " gauge\n";
+
+        snprintf( num, sizeof( num ), "%.9g", ls.quantile( 0.5 ) * 1e-9 );
+        txt += gauge + "{stat=\"p50\"} " + num + "\n";
+
+        snprintf( num, sizeof( num ), "%.9g", ls.quantile( 0.99 ) * 1e-9 );
+        txt += gauge + "{stat=\"p99\"} " + num + "\n";
+
+        snprintf( num, sizeof( num ), "%.9g", ls.max * 1e-9 );
+        txt += gauge + "{stat=\"max\"} " + num + "\n";
+    }
+
+    return txt;
+}
+
+} // namespace ingr
@@ -0,0 +1,310 @@
+/** \file
+ *
+ * \brief Counters and latency histograms for propagation and rendering
+ */
+
+#ifndef instMetrics_hpp
+#define instMetrics_hpp
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ingr
+{
+
+/// The counted events
+/** \ingroup basic_types
+ */
+enum class metricCounter : uint8_t
+{
+    putStateCalls,      ///< Calls to instIOPut::state(putState, bool, bool)
+    putTransitions,     ///< Changes of a put's state
+    beamStateChanges,   ///< Calls to instBeam::stateChange
+    beamTransitions,    ///< Changes of a beam's state
+    outputLinkChecks,   ///< Calls to instNode::checkOutputLinks
+    graphNotifications, ///< Calls to instGraph::stateChange, including overrides
+    saves               ///< Calls to instGraphXML::save
+};
+
+/// The number of \ref metricCounter values
+constexpr size_t nMetricCounters = 7;
+
+/// Get the name of a counter, as used in exported metrics
+/**
+ * \returns a name such as "put_state_calls"
+ */
+std::string metricCounter2String( metricCounter mc /**< [in] the counter */ );
+
+/// The timed operations
+/** The cascadeTo* histograms are end-to-end latencies.  They are measured from the start of an externally
+ * initiated instIOPut::state call to the last time the stage completed during the propagation it caused.
+ * A cascade in which a stage did not complete, e.g. because the rendered document did not change, adds no
+ * sample for that stage.
+ *
+ * \ingroup basic_types
+ */
+enum class metricHistogram : uint8_t
+{
+    cascade,          ///< An externally initiated instIOPut::state, including all propagation it causes
+    render,           ///< Restyling the document in instGraphXML::stateChange
+    save,             ///< instGraphXML::save, including publishing to sinks
+    cascadeToRender,  ///< From the start of a cascade to the end of restyling
+    cascadeToSave,    ///< From the start of a cascade to the new document being rendered
+    cascadeToPublish  ///< From the start of a cascade to the new document being published to the sinks
+};
+
+/// The number of \ref metricHistogram values
+constexpr size_t nMetricHistograms = 6;
+
+/// Get the name of a histogram, as used in exported metrics
+/**
+ * \returns a name such as "cascade"
+ */
+std::string metricHistogram2String( metricHistogram mh /**< [in] the histogram */ );
+
+/// The contents of a latency histogram at one time
+struct latencySnapshot
+{
+    std::vector<uint64_t> buckets; ///< The count in each bucket, see \ref latencyHistogram
+    uint64_t count{ 0 };           ///< The number of samples
+    uint64_t sum{ 0 };             ///< The sum of the samples in ns
+    uint64_t max{ 0 };             ///< The largest sample in ns
+
+    /// Estimate a quantile by interpolating within the bucket holding it
+    /**
+     * \returns the estimated quantile in ns, never more than max
+     * \returns 0 if there are no samples
+     */
+    double quantile( double q /**< [in] the quantile, from 0 to 1, e.g. 0.99 */ ) const;
+};
+
+/// A log-linear histogram of latencies in nanoseconds
+/** Each power of 2 is split into \ref subBuckets linear buckets, so a sample is placed with a relative
+ * error below 1/\ref subBuckets over the whole 64-bit range.  Recording is a few relaxed atomic operations
+ * and is safe from any thread.
+ */
+class latencyHistogram
+{
+  public:
+    static constexpr unsigned subBits = 3;                    ///< log2 of the buckets per power of 2
+    static constexpr size_t subBuckets = 1 << subBits;        ///< The buckets per power of 2
+    static constexpr size_t nBuckets = ( 64 - subBits + 1 ) * subBuckets; ///< The total number of buckets
+
+  protected:
+    std::array<std::atomic<uint64_t>, nBuckets> m_buckets{}; ///< The count in each bucket
+
+    std::atomic<uint64_t> m_count{ 0 };                       ///< The number of samples
+
+    std::atomic<uint64_t> m_sum{ 0 };                         ///< The sum of the samples
+
+    std::atomic<uint64_t> m_max{ 0 };                         ///< The largest sample
+
+  public:
+    /// Get the bucket holding a value
+    /**
+     * \returns the bucket index
+     */
+    static size_t bucket( uint64_t ns /**< [in] the value */ )
+    {
+        if( ns < subBuckets )
+        {
+            return ns;
+        }
+
+        unsigned e = 63 - std::countl_zero( ns );
+
+        return ( e - subBits + 1 ) * subBuckets + ( ( ns >> ( e - subBits ) ) & ( subBuckets - 1 ) );
+    }
+
+    /// Get the upper bound of a bucket
+    /**
+     * \returns the smallest value greater than all values in bucket \p b, in ns
+     */
+    static double bucketUpper( size_t b /**< [in] the bucket index */ );
+
+    /// Record a sample
+    void record( uint64_t ns /**< [in] the sample, in ns */ )
+    {
+        m_buckets[bucket( ns )].fetch_add( 1, std::memory_order_relaxed );
+        m_count.fetch_add( 1, std::memory_order_relaxed );
+        m_sum.fetch_add( ns, std::memory_order_relaxed );
+
+        uint64_t mx = m_max.load( std::memory_order_relaxed );
+        while( ns > mx && !m_max.compare_exchange_weak( mx, ns, std::memory_order_relaxed ) )
+        {
+        }
+    }
+
+    /// Copy the current contents
+    void snapshot( latencySnapshot &snap /**< [out] the contents */ ) const;
+
+    /// Set all counts to zero
+    void reset();
+};
+
+/// The contents of a metrics registry at one time
+struct metricsSnapshot
+{
+    std::array<uint64_t, nMetricCounters> counters{};           ///< Indexed by \ref metricCounter
+
+    std::array<latencySnapshot, nMetricHistograms> histograms; ///< Indexed by \ref metricHistogram
+};
+
+/// Registry of counters and latency histograms for one graph
+/** Counting is a relaxed atomic increment, so snapshots can be taken from any thread while the graph is in
+ * use.  A snapshot is not taken atomically as a whole.
+ *
+ * \ingroup explainer
+ */
+class instMetrics
+{
+  protected:
+    std::array<std::atomic<uint64_t>, nMetricCounters> m_counters{}; ///< The counters
+
+    std::array<latencyHistogram, nMetricHistograms> m_histograms;    ///< The histograms
+
+    /// For each histogram, one past the highest bucket ever exported, so every scrape has the same bounds
+    mutable std::array<std::atomic<size_t>, nMetricHistograms> m_exportedBuckets{};
+
+    /// The nesting depth of instIOPut::state calls.  Only changed by the thread propagating in the graph.
+    int m_cascadeDepth{ 0 };
+
+    uint64_t m_cascadeStart{ 0 }; ///< When the outermost instIOPut::state call started
+
+    /// When each cascadeTo* stage last completed in the current cascade, 0 if it has not
+    std::array<uint64_t, nMetricHistograms> m_stageEnd{};
+
+    /// Start a call to instIOPut::state
+    void beginCascade();
+
+    /// End a call to instIOPut::state, recording the cascade latencies if it is the outermost
+    void endCascade();
+
+    friend class metricCascade;
+
+  public:
+    /// Increment a counter
+    void count( metricCounter mc, /**< [in] the counter */
+                uint64_t n = 1    /**< [in] [optional] the amount to add */
+    )
+    {
+        m_counters[static_cast<size_t>( mc )].fetch_add( n, std::memory_order_relaxed );
+    }
+
+    /// Get the current value of a counter
+    /**
+     * \returns the count
+     */
+    uint64_t counter( metricCounter mc /**< [in] the counter */ ) const;
+
+    /// Record a latency sample
+    void record( metricHistogram mh, /**< [in] the histogram */
+                 uint64_t ns         /**< [in] the sample, in ns */
+    )
+    {
+        m_histograms[static_cast<size_t>( mh )].record( ns );
+    }
+
+    /// Mark the completion of an end-to-end stage of the current cascade
+    /** Does nothing if no cascade is in progress.
+     */
+    void stage( metricHistogram mh /**< [in] one of the cascadeTo* histograms */ )
+    {
+        if( m_cascadeDepth > 0 )
+        {
+            m_stageEnd[static_cast<size_t>( mh )] = now();
+        }
+    }
+
+    /// Copy the current values of one histogram
+    void snapshot( latencySnapshot &snap, /**< [out] the values */
+                   metricHistogram mh     /**< [in] the histogram */
+    ) const;
+
+    /// Copy the current values of all counters and histograms
+    void snapshot( metricsSnapshot &snap /**< [out] the values */ ) const;
+
+    /// Set all counters and histograms to zero
+    void reset();
+
+    /// Format the current values in the Prometheus text exposition format
+    /** Counters are named `<prefix>_<counter>_total`.  Histograms are named `<prefix>_<name>_seconds`, with
+     * a bucket line for every bound up to that of the highest bucket ever populated, so the set of `le`
+     * labels only grows, including across reset().  Samples are whole ns, so the `le` bound of a bucket is its
+     * largest sample, one ns below bucketUpper(), as `le` is inclusive.  The estimated median and 99th
+     * percentile and the largest sample are in a separate gauge family `<prefix>_<name>_latency_seconds`,
+     * labeled by `stat` as "p50", "p99" and "max".
+     *
+     * \returns the exposition text
+     */
+    std::string prometheus( const std::string &prefix = "ingr" /**< [in] [optional] the metric name prefix */ ) const;
+
+    /// Get the current steady_clock time for latency measurements
+    /**
+     * \returns the time in ns
+     */
+    static uint64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch() )
+            .count();
+    }
+};
+
+/// Records the duration of its scope in a histogram
+class metricTimer
+{
+  protected:
+    instMetrics *m_metrics;
+    metricHistogram m_histogram;
+    uint64_t m_start;
+
+  public:
+    /// Start timing.  If \p metrics is nullptr nothing is recorded.
+    metricTimer( instMetrics *metrics, metricHistogram mh )
+        : m_metrics{ metrics }, m_histogram{ mh }, m_start{ metrics ? instMetrics::now() : 0 }
+    {
+    }
+
+    ~metricTimer()
+    {
+        if( m_metrics )
+        {
+            m_metrics->record( m_histogram, instMetrics::now() - m_start );
+        }
+    }
+};
+
+/// Counts a call to instIOPut::state, and times it if it is the outermost call
+class metricCascade
+{
+  protected:
+    instMetrics *m_metrics;
+
+  public:
+    /// Start the call.  If \p metrics is nullptr nothing is recorded.
+    explicit metricCascade( instMetrics *metrics ) : m_metrics{ metrics }
+    {
+        if( m_metrics )
+        {
+            m_metrics->beginCascade();
+        }
+    }
+
+    ~metricCascade()
+    {
+        if( m_metrics )
+        {
+            m_metrics->endCascade();
+        }
+    }
+};
+
+} // namespace ingr
+
+#endif // instMetrics_hpp
@@ -1,8 +1,10 @@
 #include "instNode.hpp"
 #include "instIOPut.hpp"
 #include "instBeam.hpp"
+#include "instDiagnostics.hpp"
+#include "instGraph.hpp"
+#include "instTrace.hpp"
 
-#include <iostream>
 #include <stdexcept>
 
 namespace ingr
@@ -58,7 +60,12 @@ std::string instNode::addIOPut( instIOPut *ip )
         {
             ///\todo test me
 
-            std::cerr << "input already exists\n";
+            globalDiagnostics()->report( severity::warning,
+                                         "instNode",
+                                         0,
+                                         0,
+                                         0,
+                                         [&] { return "input " + ip->key() + " already exists in node " + m_name; } );
             return res.first->first; // return the key
         }
 
@@ -77,7 +84,12 @@ std::string instNode::addIOPut( instIOPut *ip )
 
         if( res.second == false )
         {
-            std::cerr << "input already exists\n";
+            globalDiagnostics()->report( severity::warning,
+                                         "instNode",
+                                         0,
+                                         0,
+                                         0,
+                                         [&] { return "output " + ip->key() + " already exists in node " + m_name; } );
             return res.first->first; // return the key
         }
 
@@ -99,6 +111,12 @@ std::string instNode::addIOPut( instIOPut *ip )
     return "";
 }
 
+void instNode::reserve( size_t nInputs, size_t nOutputs )
+{
+    m_inputs.reserve( nInputs );
+    m_outputs.reserve( nOutputs );
+}
+
 const instNode::ioputMapT &instNode::inputs() const
 {
     return m_inputs;
@@ -233,11 +251,19 @@ void instNode::updateOutputLinks()
 
 void instNode::checkOutputLinks( const std::string op )
 {
+    INGR_TRACE_SCOPE( checkOutputLinks, this );
+
     if( !outputValid( op ) ) // don't bother if this output is bad
     {
         return;
     }
 
+    instGraph *graph = m_outputs.at( op )->parentGraph();
+    if( graph )
+    {
+        graph->metrics().count( metricCounter::outputLinkChecks );
+    }
+
     putState ps = putState::off;
 
     for( auto &&ip : m_inputs ) // Check the output links of each input
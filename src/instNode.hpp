@@ -72,6 +72,11 @@ struct instNode
     /// Add an input or output to this node
     std::string addIOPut( instIOPut *ip /**< [in] the input or output to add*/ );
 
+    /// Reserve space in the input and output maps
+    void reserve( size_t nInputs, /**< [in] the expected number of inputs */
+                  size_t nOutputs /**< [in] the expected number of outputs */
+    );
+
     /// Get a reference to the input map
     /**
      * \returns a reference to the input map (m_inputs)
@@ -0,0 +1,312 @@
+#include <stdexcept>
+
+#include "instOverlay.hpp"
+#include "instGraph.hpp"
+
+namespace ingr
+{
+
+instOverlay::instOverlay( instGraph &base ) : m_base{ &base }
+{
+}
+
+instGraph &instOverlay::base()
+{
+    return *m_base;
+}
+
+void instOverlay::clear()
+{
+    m_puts.clear();
+    m_beams.clear();
+    m_changes.clear();
+}
+
+putState instOverlay::state( instIOPut *put ) const
+{
+    auto it = m_puts.find( put );
+
+    if( it == m_puts.end() )
+    {
+        return put->state();
+    }
+
+    return it->second.state;
+}
+
+beamState instOverlay::state( instBeam *beam ) const
+{
+    auto it = m_beams.find( beam );
+
+    if( it == m_beams.end() )
+    {
+        return beam->state();
+    }
+
+    return it->second.state;
+}
+
+bool instOverlay::enabled( instIOPut *put ) const
+{
+    auto it = m_puts.find( put );
+
+    if( it == m_puts.end() )
+    {
+        return put->enabled();
+    }
+
+    return it->second.enabled;
+}
+
+void instOverlay::enabled( instIOPut *put, bool en )
+{
+    touch( put ).enabled = en;
+}
+
+instOverlay::putEntry &instOverlay::touch( instIOPut *put )
+{
+    auto it = m_puts.find( put );
+
+    if( it == m_puts.end() )
+    {
+        it = m_puts.emplace( put, putEntry{ put->state(), put->enabled() } ).first;
+    }
+
+    return it->second;
+}
+
+void instOverlay::set( instIOPut *put, putState ns, journalCause cause )
+{
+    putEntry &pe = touch( put );
+
+    pe.state = ns;
+    pe.last = m_changes.size();
+
+    m_changes.push_back( { put, nullptr, cause } );
+}
+
+void instOverlay::set( instBeam *beam, beamState bs )
+{
+    m_beams[beam] = { bs, m_changes.size() };
+
+    m_changes.push_back( { nullptr, beam, journalCause::propagation } );
+}
+
+bool instOverlay::netChange( size_t n ) const
+{
+    const change &c = m_changes[n];
+
+    if( c.put )
+    {
+        const putEntry &pe = m_puts.find( c.put )->second;
+        return pe.last == n && pe.state != c.put->state();
+    }
+
+    const beamEntry &be = m_beams.find( c.beam )->second;
+    return be.last == n && be.state != c.beam->state();
+}
+
+void instOverlay::state( instIOPut *put, putState ns, bool nobeam, bool byOutputLink )
+{
+    // If this put is not enabled we can't do anything but turn it off
+    if( !enabled( put ) && ns != putState::off )
+    {
+        return;
+    }
+
+    instBeam *beam = put->beamValid() ? put->beam() : nullptr;
+
+    // An input switching on waits for an off beam
+    if( put->io() == ioDir::input && ns == putState::on && beam && state( beam ) == beamState::off )
+    {
+        ns = putState::waiting;
+    }
+
+    // An enabled output-linked output is controlled by its linked inputs
+    if( put->io() == ioDir::output && put->outputLinked() && !byOutputLink && enabled( put ) )
+    {
+        checkOutputLinks( put );
+        return;
+    }
+
+    set( put, ns, byOutputLink ? journalCause::outputLink : ( nobeam ? journalCause::beam : journalCause::external ) );
+
+    if( put->io() == ioDir::input && put->nodeValid() )
+    {
+        for( auto &&ol : put->outputLinks() )
+        {
+            if( !put->node()->outputValid( ol ) )
+            {
+                throw std::logic_error( "instOverlay::state: outputLink is invalid" );
+            }
+
+            checkOutputLinks( put->node()->output( ol ) );
+        }
+    }
+
+    if( beam && !nobeam )
+    {
+        beamStateChange( beam );
+    }
+}
+
+void instOverlay::state( const std::string &node, const std::string &put, ioDir io, putState ns )
+{
+    instNode *nd = m_base->node( node );
+
+    state( io == ioDir::input ? nd->input( put ) : nd->output( put ), ns );
+}
+
+void instOverlay::checkOutputLinks( instIOPut *output )
+{
+    putState ps = putState::off;
+
+    for( auto &&ip : output->node()->inputs() )
+    {
+        if( ip.second == nullptr || ip.second->outputLinks().count( output->name() ) == 0 )
+        {
+            continue;
+        }
+
+        putState ips = state( ip.second );
+
+        if( ips == putState::on )
+        {
+            ps = putState::on;
+        }
+        else if( ps == putState::off && ips == putState::waiting )
+        {
+            ps = putState::waiting;
+        }
+    }
+
+    state( output, ps, false, true );
+}
+
+void instOverlay::beamStateChange( instBeam *beam )
+{
+    beamState bs = state( beam );
+
+    instIOPut *source = beam->sourceValid() ? beam->source() : nullptr;
+    instIOPut *dest = beam->destValid() ? beam->dest() : nullptr;
+
+    putState srcState = source ? state( source ) : putState::off;
+
+    if( source && srcState == putState::on )
+    {
+        if( dest == nullptr )
+        {
+            set( beam, beamState::intermediate );
+        }
+        else if( state( dest ) == putState::on || state( dest ) == putState::waiting )
+        {
+            if( bs == beamState::on )
+            {
+                return;
+            }
+
+            set( beam, beamState::on );
+            state( dest, putState::on, true );
+        }
+        else
+        {
+            set( beam, beamState::intermediate );
+        }
+
+        return;
+    }
+
+    // The source is missing, off, or waiting, so the beam is off
+    if( bs == beamState::off )
+    {
+        return;
+    }
+
+    set( beam, beamState::off );
+
+    if( dest && state( dest ) == putState::on )
+    {
+        state( dest, putState::waiting, true );
+    }
+}
+
+void instOverlay::diff( overlayDiff &d ) const
+{
+    d.puts.clear();
+    d.beams.clear();
+
+    for( size_t n = 0; n < m_changes.size(); ++n )
+    {
+        if( !netChange( n ) )
+        {
+            continue;
+        }
+
+        const change &c = m_changes[n];
+
+        if( c.put )
+        {
+            d.puts.push_back( { c.put, m_puts.find( c.put )->second.state } );
+        }
+        else
+        {
+            d.beams.push_back( { c.beam, m_beams.find( c.beam )->second.state } );
+        }
+    }
+}
+
+void instOverlay::commit( overlayDiff &d )
+{
+    d.puts.clear();
+    d.beams.clear();
+
+    for( auto &pe : m_puts )
+    {
+        pe.first->enabled( pe.second.enabled );
+    }
+
+    // Replay the net changes in the order they were last made, with the cause of that change
+    for( size_t n = 0; n < m_changes.size(); ++n )
+    {
+        if( !netChange( n ) )
+        {
+            continue;
+        }
+
+        const change &c = m_changes[n];
+
+        if( c.put )
+        {
+            putState from = c.put->m_state;
+            putState to = m_puts.find( c.put )->second.state;
+            c.put->m_state = to;
+
+            d.puts.push_back( { c.put, to } );
+
+            m_base->metrics().count( metricCounter::putTransitions );
+            m_base->recordTransition(
+                entityKind::put, c.put->handle(), static_cast<int>( from ), static_cast<int>( to ), c.cause );
+        }
+        else
+        {
+            beamState from = c.beam->m_state;
+            beamState to = m_beams.find( c.beam )->second.state;
+            c.beam->m_state = to;
+
+            d.beams.push_back( { c.beam, to } );
+
+            m_base->metrics().count( metricCounter::beamTransitions );
+            m_base->recordTransition(
+                entityKind::beam, c.beam->handle(), static_cast<int>( from ), static_cast<int>( to ), c.cause );
+        }
+    }
+
+    clear();
+
+    if( !d.empty() )
+    {
+        m_base->notifyStateChange();
+    }
+}
+
+} // namespace ingr
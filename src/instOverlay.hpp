@@ -0,0 +1,188 @@
+/** \file
+ *
+ * \brief Hypothetical changes layered over a graph, for what-if evaluation
+ */
+
+#ifndef instOverlay_hpp
+#define instOverlay_hpp
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "basicTypes.hpp"
+#include "instJournal.hpp"
+
+namespace ingr
+{
+
+class instGraph;
+class instIOPut;
+class instBeam;
+
+/// The puts and beams whose states differ between an overlay and its base graph
+/**
+ * \ingroup explainer
+ */
+struct overlayDiff
+{
+    std::vector<std::pair<instIOPut *, putState>> puts;  ///< The puts which changed, with their overlay states
+
+    std::vector<std::pair<instBeam *, beamState>> beams; ///< The beams which changed, with their overlay states
+
+    /// Check if nothing changed
+    /**
+     * \returns true if there are no changed puts or beams
+     */
+    bool empty() const
+    {
+        return puts.empty() && beams.empty();
+    }
+};
+
+/// Hypothetical put states and enabled flags layered over a graph
+/** Changes are made with enabled() and state(), which propagate through the overlay following the same
+ * rules as instIOPut::state and instBeam::stateChange.  The base graph is only read: it is not changed,
+ * and no notifications or saves happen.  Only the puts and beams touched by the propagation are stored,
+ * and clear() keeps the allocated storage, so an overlay can be reused for many queries.
+ *
+ * The base graph must not change while the overlay is in use.
+ *
+ * \ingroup explainer
+ */
+class instOverlay
+{
+  protected:
+    /// The overlay values of a put
+    struct putEntry
+    {
+        putState state;
+        bool enabled;
+        size_t last{ std::string::npos }; ///< The index in m_changes of the last change of the state
+    };
+
+    /// The overlay values of a beam
+    struct beamEntry
+    {
+        beamState state;
+        size_t last; ///< The index in m_changes of the last change of the state
+    };
+
+    /// A change of the state of a put or beam in the overlay
+    struct change
+    {
+        instIOPut *put;     ///< The put changed, or nullptr for a beam
+        instBeam *beam;     ///< The beam changed, or nullptr for a put
+        journalCause cause; ///< What changed it, as instIOPut::state and instBeam::stateChange record it
+    };
+
+    instGraph *m_base{ nullptr };                            ///< The base graph
+
+    std::unordered_map<instIOPut *, putEntry> m_puts;        ///< The touched puts
+
+    std::unordered_map<instBeam *, beamEntry> m_beams;       ///< The touched beams
+
+    std::vector<change> m_changes;                           ///< The state changes, in the order made
+
+  public:
+    /// Construct over a base graph
+    explicit instOverlay( instGraph &base /**< [in] the base graph, which must outlive the overlay */ );
+
+    /// Get the base graph
+    /**
+     * \returns a reference to the base graph
+     */
+    instGraph &base();
+
+    /// Discard all hypothetical changes
+    void clear();
+
+    /// Get the state of a put in the overlay
+    /**
+     * \returns the overlay state if touched, otherwise the base state
+     */
+    putState state( instIOPut *put /**< [in] the put */ ) const;
+
+    /// Get the state of a beam in the overlay
+    /**
+     * \returns the overlay state if touched, otherwise the base state
+     */
+    beamState state( instBeam *beam /**< [in] the beam */ ) const;
+
+    /// Get whether a put is enabled in the overlay
+    /**
+     * \returns the overlay flag if touched, otherwise the base flag
+     */
+    bool enabled( instIOPut *put /**< [in] the put */ ) const;
+
+    /// Set whether a put is enabled in the overlay
+    /** As with instIOPut::enabled, this does not change any state.
+     */
+    void enabled( instIOPut *put, /**< [in] the put */
+                  bool en         /**< [in] the hypothetical enabled flag */
+    );
+
+    /// Set the state of a put in the overlay, and propagate the change through the overlay
+    void state( instIOPut *put,            /**< [in] the put */
+                putState ns,               /**< [in] the hypothetical new state */
+                bool nobeam = false,       /**< [in] [optional] as for instIOPut::state */
+                bool byOutputLink = false  /**< [in] [optional] as for instIOPut::state */
+    );
+
+    /// Set the state of a put in the overlay, by name
+    /**
+     * \throws std::invalid_argument if the node or put does not exist
+     */
+    void state( const std::string &node, /**< [in] the name of the node */
+                const std::string &put,  /**< [in] the name of the put */
+                ioDir io,                /**< [in] whether the put is an input or output */
+                putState ns              /**< [in] the hypothetical new state */
+    );
+
+    /// Get the puts and beams whose overlay states differ from the base graph
+    /** Each is listed once, in the order of its last change in the overlay.
+     */
+    void diff( overlayDiff &d /**< [out] the differences, in the order last changed */ ) const;
+
+    /// Apply the overlay to the base graph as one change set, then clear the overlay
+    /** The enabled flags are set, then each put and beam whose overlay state differs is given that state
+     * without propagating again, since the overlay has already propagated.  The changes are made in the order
+     * of their last change in the overlay, so a cause comes before its effects.  Each transition is counted and
+     * recorded as by the graph, with the cause of that last change: external for a put set by the caller, beam
+     * or outputLink for a put set by propagation, and propagation for a beam.  The graph is notified once if
+     * anything changed.  The base graph ends as if the changes had been made to it directly.
+     */
+    void commit( overlayDiff &d /**< [out] the change set, in the order made */ );
+
+  protected:
+    /// Recalculate the state of a beam in the overlay, as instBeam::stateChange
+    void beamStateChange( instBeam *beam /**< [in] the beam */ );
+
+    /// Recalculate the state of an output from its linked inputs, as instNode::checkOutputLinks
+    void checkOutputLinks( instIOPut *output /**< [in] the output */ );
+
+    /// Get the overlay entry for a put, creating it from the base values if needed
+    putEntry &touch( instIOPut *put /**< [in] the put */ );
+
+    /// Set the overlay state of a put and log the change
+    void set( instIOPut *put,    /**< [in] the put */
+              putState ns,       /**< [in] the new overlay state */
+              journalCause cause /**< [in] what changed it */
+    );
+
+    /// Set the overlay state of a beam and log the change
+    void set( instBeam *beam, /**< [in] the beam */
+              beamState bs    /**< [in] the new overlay state */
+    );
+
+    /// Check if a logged change is the last change of its put or beam, and its state differs from the base
+    /**
+     * \returns true if the change is part of the net change set
+     */
+    bool netChange( size_t n /**< [in] the index of the change in m_changes */ ) const;
+};
+
+} // namespace ingr
+
+#endif // instOverlay_hpp
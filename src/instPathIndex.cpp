@@ -0,0 +1,333 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "instPathIndex.hpp"
+#include "instGraph.hpp"
+
+namespace ingr
+{
+
+// The value of putState::on and beamState::on
+static constexpr int stateOn = static_cast<int>( putState::on );
+
+instPathIndex::instPathIndex()
+{
+}
+
+instPathIndex::~instPathIndex()
+{
+    clear();
+}
+
+void instPathIndex::clear()
+{
+    if( m_graph && m_graph->paths() == this )
+    {
+        m_graph->paths( nullptr );
+    }
+
+    m_graph = nullptr;
+
+    m_sources.clear();
+    m_sinks.clear();
+    m_tree.clear();
+    m_pathNode.clear();
+    m_pathPair.clear();
+    m_unlit.clear();
+    m_litPos.clear();
+    m_pairPaths.clear();
+    m_pairLit.clear();
+    m_entityStart.clear();
+    m_entityNodes.clear();
+}
+
+int instPathIndex::build( std::string &emsg,
+                          instGraph &graph,
+                          const std::vector<std::string> &sources,
+                          const std::vector<std::string> &sinks,
+                          size_t maxPaths )
+{
+    emsg = "";
+
+    clear();
+
+    for( auto &&name : sources )
+    {
+        if( graph.nodes().count( name ) == 0 )
+        {
+            emsg = "unknown source node " + name;
+            return -1;
+        }
+    }
+
+    for( auto &&name : sinks )
+    {
+        if( graph.nodes().count( name ) == 0 )
+        {
+            emsg = "unknown sink node " + name;
+            return -1;
+        }
+    }
+
+    uint32_t nHandles = graph.assignHandles();
+
+    // The sink of each input of a sink node
+    std::vector<uint32_t> sinkOf( nHandles, invalidHandle );
+    for( uint32_t k = 0; k < sinks.size(); ++k )
+    {
+        for( auto &&ip : graph.node( sinks[k] )->inputs() )
+        {
+            sinkOf[ip.second->handle()] = k;
+        }
+    }
+
+    // The state of each entity, and the next entities along the light path
+    std::vector<uint8_t> isOn( nHandles );
+    std::vector<uint32_t> succStart( nHandles + 1, 0 );
+    std::vector<uint32_t> succ;
+
+    for( uint32_t h = 0; h < nHandles; ++h )
+    {
+        succStart[h] = succ.size();
+
+        if( instIOPut *put = graph.handlePut( h ) )
+        {
+            isOn[h] = ( put->state() == putState::on );
+
+            if( put->io() == ioDir::output )
+            {
+                if( put->beamValid() )
+                {
+                    succ.push_back( put->beam()->handle() );
+                }
+            }
+            else if( put->nodeValid() )
+            {
+                for( auto &&ol : put->outputLinks() )
+                {
+                    if( put->node()->outputValid( ol ) )
+                    {
+                        succ.push_back( put->node()->output( ol )->handle() );
+                    }
+                }
+            }
+        }
+        else
+        {
+            instBeam *beam = graph.handleBeam( h );
+
+            isOn[h] = ( beam->state() == beamState::on );
+
+            if( beam->destValid() )
+            {
+                succ.push_back( beam->dest()->handle() );
+            }
+        }
+    }
+    succStart[nHandles] = succ.size();
+
+    m_sources = sources;
+    m_sinks = sinks;
+    m_pairPaths.assign( sources.size() * sinks.size(), {} );
+    m_pairLit.assign( sources.size() * sinks.size(), {} );
+
+    // Depth first from each output of each source, pruning the subtrees which reach no sink
+    struct frame
+    {
+        uint32_t node;   // the tree node
+        uint32_t next;   // the next successor to try
+        uint32_t unlit;  // the number of entities not on from the root to here
+    };
+
+    std::vector<frame> stack;
+    std::vector<uint8_t> onPath( nHandles, 0 );
+
+    for( uint32_t s = 0; s < sources.size(); ++s )
+    {
+        for( auto &&op : graph.node( sources[s] )->outputs() )
+        {
+            auto enter = [&]( uint32_t h, uint32_t parent, uint32_t unlit )
+            {
+                unlit += isOn[h] ? 0 : 1;
+
+                m_tree.push_back( { h, parent, static_cast<uint32_t>( m_pathNode.size() ), 0 } );
+                onPath[h] = 1;
+
+                if( sinkOf[h] != invalidHandle )
+                {
+                    m_pathNode.push_back( m_tree.size() - 1 );
+                    m_pathPair.push_back( s * sinks.size() + sinkOf[h] );
+                    m_unlit.push_back( unlit );
+                }
+
+                stack.push_back( { static_cast<uint32_t>( m_tree.size() - 1 ), succStart[h], unlit } );
+            };
+
+            enter( op.second->handle(), invalidHandle, 0 );
+
+            while( !stack.empty() )
+            {
+                frame &top = stack.back();
+                uint32_t h = m_tree[top.node].handle;
+
+                if( top.next < succStart[h + 1] )
+                {
+                    uint32_t w = succ[top.next++];
+
+                    if( !onPath[w] )
+                    {
+                        enter( w, top.node, top.unlit );
+                    }
+
+                    if( m_pathNode.size() > maxPaths )
+                    {
+                        clear();
+                        emsg = "more than " + std::to_string( maxPaths ) + " paths";
+                        return -1;
+                    }
+
+                    continue;
+                }
+
+                onPath[h] = 0;
+
+                treeNode &tn = m_tree[top.node];
+                tn.endPath = m_pathNode.size();
+
+                // With no paths below, this node is the last in the tree, since its children were pruned
+                if( tn.firstPath == tn.endPath )
+                {
+                    m_tree.pop_back();
+                }
+
+                stack.pop_back();
+            }
+        }
+    }
+
+    // The tree nodes of each entity
+    m_entityStart.assign( nHandles + 1, 0 );
+    for( auto &&tn : m_tree )
+    {
+        ++m_entityStart[tn.handle + 1];
+    }
+
+    for( uint32_t h = 0; h < nHandles; ++h )
+    {
+        m_entityStart[h + 1] += m_entityStart[h];
+    }
+
+    m_entityNodes.resize( m_tree.size() );
+    std::vector<uint32_t> fill( m_entityStart.begin(), m_entityStart.end() - 1 );
+    for( uint32_t n = 0; n < m_tree.size(); ++n )
+    {
+        m_entityNodes[fill[m_tree[n].handle]++] = n;
+    }
+
+    m_litPos.assign( m_pathNode.size(), 0 );
+    for( uint32_t p = 0; p < m_pathNode.size(); ++p )
+    {
+        m_pairPaths[m_pathPair[p]].push_back( p );
+
+        if( m_unlit[p] == 0 )
+        {
+            m_litPos[p] = m_pairLit[m_pathPair[p]].size();
+            m_pairLit[m_pathPair[p]].push_back( p );
+        }
+    }
+
+    m_graph = &graph;
+    graph.paths( this );
+
+    return 0;
+}
+
+void instPathIndex::transition( uint32_t h, int from, int to )
+{
+    bool wasOn = ( from == stateOn );
+    bool nowOn = ( to == stateOn );
+
+    if( wasOn == nowOn || h + 1 >= m_entityStart.size() )
+    {
+        return;
+    }
+
+    for( uint32_t e = m_entityStart[h]; e < m_entityStart[h + 1]; ++e )
+    {
+        const treeNode &tn = m_tree[m_entityNodes[e]];
+
+        for( uint32_t p = tn.firstPath; p < tn.endPath; ++p )
+        {
+            std::vector<uint32_t> &lit = m_pairLit[m_pathPair[p]];
+
+            if( nowOn )
+            {
+                if( --m_unlit[p] == 0 )
+                {
+                    m_litPos[p] = lit.size();
+                    lit.push_back( p );
+                }
+            }
+            else if( m_unlit[p]++ == 0 )
+            {
+                // Swap the last lit path into this one's place
+                uint32_t last = lit.back();
+                lit[m_litPos[p]] = last;
+                m_litPos[last] = m_litPos[p];
+                lit.pop_back();
+            }
+        }
+    }
+}
+
+size_t instPathIndex::nPaths() const
+{
+    return m_pathNode.size();
+}
+
+size_t instPathIndex::pair( const std::string &source, const std::string &sink ) const
+{
+    auto s = std::find( m_sources.begin(), m_sources.end(), source );
+    auto k = std::find( m_sinks.begin(), m_sinks.end(), sink );
+
+    if( s == m_sources.end() || k == m_sinks.end() )
+    {
+        throw std::invalid_argument( "instPathIndex: " + source + " to " + sink + " is not indexed" );
+    }
+
+    return ( s - m_sources.begin() ) * m_sinks.size() + ( k - m_sinks.begin() );
+}
+
+const std::vector<uint32_t> &instPathIndex::paths( const std::string &source, const std::string &sink ) const
+{
+    return m_pairPaths[pair( source, sink )];
+}
+
+const std::vector<uint32_t> &instPathIndex::lit( const std::string &source, const std::string &sink ) const
+{
+    return m_pairLit[pair( source, sink )];
+}
+
+bool instPathIndex::isLit( uint32_t p ) const
+{
+    return p < m_unlit.size() && m_unlit[p] == 0;
+}
+
+void instPathIndex::path( std::vector<uint32_t> &handles, uint32_t p ) const
+{
+    handles.clear();
+
+    if( p >= m_pathNode.size() )
+    {
+        return;
+    }
+
+    for( uint32_t n = m_pathNode[p]; n != invalidHandle; n = m_tree[n].parent )
+    {
+        handles.push_back( m_tree[n].handle );
+    }
+
+    std::reverse( handles.begin(), handles.end() );
+}
+
+} // namespace ingr
@@ -0,0 +1,146 @@
+/** \file
+ *
+ * \brief An index of the light paths between source and sink nodes, with their lit status
+ */
+
+#ifndef instPathIndex_hpp
+#define instPathIndex_hpp
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "basicTypes.hpp"
+
+namespace ingr
+{
+
+class instGraph;
+
+/// All simple light paths between designated source and sink nodes, kept as prefix trees
+/** Built once with build(), which enumerates every simple path from an output of a source node, through
+ * beams and output links, to an input of a sink node.  Paths from the same output share their common
+ * prefix as a tree node, and a path is identified by the tree node of its last input.  A path does not end
+ * at a sink: it continues to any sink further along.
+ *
+ * A path is lit when every put and beam on it is on.  Each path keeps the number of its entities which are
+ * not on, and the graph reports each transition with transition(), which updates the counts of the paths
+ * through that entity.  The lit paths of each source and sink pair are kept in a list as the counts reach
+ * and leave zero, so lit() does no traversal.
+ *
+ * Call build() again after changing the topology.  Must only be used from the thread which changes the
+ * graph.
+ *
+ * \ingroup explainer
+ */
+class instPathIndex
+{
+  protected:
+    /// A node of a prefix tree
+    struct treeNode
+    {
+        uint32_t handle;     ///< The put or beam
+        uint32_t parent;     ///< The parent tree node, invalidHandle for a root
+        uint32_t firstPath;  ///< The first path in this subtree
+        uint32_t endPath;    ///< One past the last path in this subtree
+    };
+
+    instGraph *m_graph{ nullptr }; ///< The graph, while registered
+
+    std::vector<std::string> m_sources; ///< The source node names
+    std::vector<std::string> m_sinks;   ///< The sink node names
+
+    std::vector<treeNode> m_tree;         ///< The tree nodes, in depth-first order
+
+    std::vector<uint32_t> m_pathNode;     ///< The last tree node of each path
+    std::vector<uint32_t> m_pathPair;     ///< The source and sink pair of each path, as source * nSinks + sink
+    std::vector<uint32_t> m_unlit;        ///< The number of entities on each path which are not on
+    std::vector<uint32_t> m_litPos;       ///< The position of each lit path in its pair's lit list
+
+    std::vector<std::vector<uint32_t>> m_pairPaths; ///< The paths of each pair
+    std::vector<std::vector<uint32_t>> m_pairLit;   ///< The lit paths of each pair
+
+    std::vector<uint32_t> m_entityStart;  ///< The start of each handle's tree nodes in m_entityNodes
+    std::vector<uint32_t> m_entityNodes;  ///< The tree nodes of each handle
+
+  public:
+    /// Default c'tor
+    instPathIndex();
+
+    /// D'tor, unregisters from the graph
+    ~instPathIndex();
+
+    /// Build the index and register it with the graph
+    /** Assigns handles in the graph.
+     *
+     * \returns 0 on success
+     * \returns -1 on error, such as an unknown node or too many paths, with \p emsg set
+     */
+    int build( std::string &emsg,                       /**< [out] the error message, if any */
+               instGraph &graph,                        /**< [in] the graph */
+               const std::vector<std::string> &sources, /**< [in] the names of the source nodes */
+               const std::vector<std::string> &sinks,   /**< [in] the names of the sink nodes */
+               size_t maxPaths = 1000000                /**< [in] [optional] the most paths to index */
+    );
+
+    /// Clear the index and unregister from the graph
+    void clear();
+
+    /// Account for a transition.  Called by the graph.
+    void transition( uint32_t h,  /**< [in] the handle of the entity */
+                     int from,    /**< [in] the old state */
+                     int to       /**< [in] the new state */
+    );
+
+    /// Get the number of paths
+    /**
+     * \returns the size of m_pathNode
+     */
+    size_t nPaths() const;
+
+    /// Get the paths from a source node to a sink node
+    /**
+     * \returns a reference to the paths
+     *
+     * \throws std::invalid_argument if \p source or \p sink was not given to build()
+     */
+    const std::vector<uint32_t> &paths( const std::string &source, /**< [in] the source node */
+                                        const std::string &sink    /**< [in] the sink node */
+    ) const;
+
+    /// Get the lit paths from a source node to a sink node
+    /**
+     * \returns a reference to the lit paths, in no particular order
+     *
+     * \throws std::invalid_argument if \p source or \p sink was not given to build()
+     */
+    const std::vector<uint32_t> &lit( const std::string &source, /**< [in] the source node */
+                                      const std::string &sink    /**< [in] the sink node */
+    ) const;
+
+    /// Check if a path is lit
+    /**
+     * \returns true if every entity on the path is on
+     */
+    bool isLit( uint32_t p /**< [in] the path */ ) const;
+
+    /// Get the entities on a path
+    void path( std::vector<uint32_t> &handles, /**< [out] the handles, from the source output to the sink input */
+               uint32_t p                      /**< [in] the path */
+    ) const;
+
+  protected:
+    /// Get the index of a source and sink pair
+    /**
+     * \returns the pair index
+     *
+     * \throws std::invalid_argument if \p source or \p sink was not given to build()
+     */
+    size_t pair( const std::string &source, /**< [in] the source node */
+                 const std::string &sink    /**< [in] the sink node */
+    ) const;
+};
+
+} // namespace ingr
+
+#endif // instPathIndex_hpp
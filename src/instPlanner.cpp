@@ -0,0 +1,377 @@
+#include <algorithm>
+
+#include "instPlanner.hpp"
+#include "instGraph.hpp"
+#include "instOverlay.hpp"
+
+namespace ingr
+{
+
+// The cost of a put which can not be turned on
+static constexpr uint32_t infCost = 0xFFFFFFFF;
+
+// No cycle was cut in a search
+static constexpr uint32_t noCut = 0xFFFFFFFF;
+
+static uint32_t addCost( uint32_t a, uint32_t b )
+{
+    return ( a == infCost || b == infCost ) ? infCost : a + b;
+}
+
+static bool testBit( const std::vector<uint64_t> &bits, uint32_t h )
+{
+    return ( bits[h / 64] >> ( h % 64 ) ) & 1;
+}
+
+static void setBit( std::vector<uint64_t> &bits, uint32_t h )
+{
+    bits[h / 64] |= uint64_t( 1 ) << ( h % 64 );
+}
+
+static void clearBit( std::vector<uint64_t> &bits, uint32_t h )
+{
+    bits[h / 64] &= ~( uint64_t( 1 ) << ( h % 64 ) );
+}
+
+std::string planCommand2String( const planCommand &cmd )
+{
+    std::string str = ( cmd.action == planAction::enable ) ? "enable " : "on ";
+
+    str += ( cmd.put->io() == ioDir::input ) ? "i:" : "o:";
+    str += cmd.put->node()->name() + ":" + cmd.put->name();
+
+    return str;
+}
+
+instPlanner::instPlanner( instGraph &graph ) : m_graph{ &graph }
+{
+    compile();
+}
+
+void instPlanner::compile()
+{
+    size_t nHandles = m_graph->assignHandles();
+
+    // The puts come first
+    uint32_t nPuts = 0;
+    while( nPuts < nHandles && m_graph->handlePut( nPuts ) != nullptr )
+    {
+        ++nPuts;
+    }
+
+    m_puts.resize( nPuts );
+    m_beamSource.assign( nPuts, invalidHandle );
+    m_hasBeam.assign( nPuts, 0 );
+    m_linkStart.assign( nPuts + 1, 0 );
+    m_links.clear();
+    m_cost.assign( nPuts, 0 );
+    m_depth.assign( nPuts, 0 );
+    m_choice.assign( nPuts, invalidHandle );
+
+    for( uint32_t h = 0; h < nPuts; ++h )
+    {
+        instIOPut *put = m_graph->handlePut( h );
+        m_puts[h] = put;
+
+        if( put->io() == ioDir::input && put->beamValid() )
+        {
+            m_hasBeam[h] = 1;
+
+            if( put->beam()->sourceValid() )
+            {
+                m_beamSource[h] = put->beam()->source()->handle();
+            }
+        }
+
+        m_linkStart[h] = m_links.size();
+
+        if( put->io() == ioDir::output && put->outputLinked() && put->nodeValid() )
+        {
+            for( auto &&ip : put->node()->inputs() )
+            {
+                if( ip.second != nullptr && ip.second->outputLinks().count( put->name() ) > 0 )
+                {
+                    m_links.push_back( ip.second->handle() );
+                }
+            }
+        }
+    }
+
+    m_linkStart[nPuts] = m_links.size();
+}
+
+uint32_t instPlanner::beamTarget( instBeam *beam )
+{
+    if( beam->destValid() )
+    {
+        return beam->dest()->handle();
+    }
+
+    if( beam->sourceValid() )
+    {
+        return beam->source()->handle();
+    }
+
+    return invalidHandle;
+}
+
+int instPlanner::plan( std::string &emsg,
+                       std::vector<planCommand> &cmds,
+                       const std::vector<instBeam *> &beams,
+                       const std::vector<instIOPut *> &puts )
+{
+    emsg = "";
+    cmds.clear();
+
+    std::vector<uint32_t> targets;
+
+    for( auto &&beam : beams )
+    {
+        // A beam which is already on needs nothing, even if its dest is waiting
+        if( beam->state() == beamState::on )
+        {
+            continue;
+        }
+
+        uint32_t h = beamTarget( beam );
+
+        if( h == invalidHandle )
+        {
+            emsg = "beam " + beam->name() + " has no source or dest";
+            return -1;
+        }
+
+        targets.push_back( h );
+    }
+
+    for( auto &&put : puts )
+    {
+        targets.push_back( put->handle() );
+    }
+
+    for( auto &&h : targets )
+    {
+        if( h >= m_puts.size() )
+        {
+            emsg = "instPlanner::plan: target is not in the compiled graph";
+            return -1;
+        }
+    }
+
+    size_t nWords = ( m_puts.size() + 63 ) / 64;
+    m_visiting.assign( nWords, 0 );
+    m_done.assign( nWords, 0 );
+    m_emitted.assign( nWords, 0 );
+    m_stackDepth = 0;
+    m_lowCut = noCut;
+
+    // Costs found through a cycle cut are searched again from each path, changing the choices made, so each
+    // target is emitted right after its search
+    for( auto &&h : targets )
+    {
+        if( cost( h ) == infCost )
+        {
+            emsg = "can not turn on " + m_graph->handleName( h );
+            cmds.clear();
+            return -1;
+        }
+
+        emit( cmds, h );
+    }
+
+    // Check the plan without touching the graph
+    instOverlay ov( *m_graph );
+
+    for( auto &&cmd : cmds )
+    {
+        if( cmd.action == planAction::enable )
+        {
+            ov.enabled( cmd.put, true );
+        }
+        else
+        {
+            ov.state( cmd.put, putState::on );
+        }
+    }
+
+    for( auto &&h : targets )
+    {
+        if( ov.state( m_puts[h] ) != putState::on )
+        {
+            emsg = "plan does not turn on " + m_graph->handleName( h );
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void instPlanner::apply( const std::vector<planCommand> &cmds )
+{
+    for( auto &&cmd : cmds )
+    {
+        if( cmd.action == planAction::enable )
+        {
+            cmd.put->enabled( true );
+        }
+        else
+        {
+            cmd.put->state( putState::on );
+        }
+    }
+}
+
+uint32_t instPlanner::cost( uint32_t h )
+{
+    instIOPut *put = m_puts[h];
+
+    if( put->state() == putState::on )
+    {
+        return 0;
+    }
+
+    if( testBit( m_done, h ) )
+    {
+        return m_cost[h];
+    }
+
+    // A cycle back to a put being searched can't help turn it on
+    if( testBit( m_visiting, h ) )
+    {
+        m_lowCut = std::min( m_lowCut, m_depth[h] );
+        return infCost;
+    }
+
+    setBit( m_visiting, h );
+    m_depth[h] = m_stackDepth++;
+
+    uint32_t outerCut = m_lowCut;
+    m_lowCut = noCut;
+
+    uint32_t c = put->enabled() ? 0 : 1;
+
+    if( put->io() == ioDir::output )
+    {
+        if( put->outputLinked() )
+        {
+            uint32_t best = infCost;
+
+            for( uint32_t n = m_linkStart[h]; n < m_linkStart[h + 1]; ++n )
+            {
+                uint32_t ic = cost( m_links[n] );
+                if( ic < best )
+                {
+                    best = ic;
+                    m_choice[h] = m_links[n];
+                }
+            }
+
+            c = addCost( c, best );
+
+            // An output only follows its inputs when one of them changes, so it must be set on if it is disabled
+            // or if the input chosen is already on
+            if( best != infCost && outputNeedsOn( h ) )
+            {
+                c = addCost( c, 1 );
+            }
+        }
+        else
+        {
+            c = addCost( c, 1 );
+        }
+    }
+    else
+    {
+        if( inputNeedsOn( h ) )
+        {
+            c = addCost( c, 1 );
+        }
+
+        if( m_hasBeam[h] )
+        {
+            c = addCost( c, m_beamSource[h] == invalidHandle ? infCost : cost( m_beamSource[h] ) );
+        }
+    }
+
+    clearBit( m_visiting, h );
+    --m_stackDepth;
+
+    // A cycle cut at a put further up the stack makes the cost depend on the path taken to h, so it is only
+    // kept if every cut was back to h itself
+    if( m_lowCut >= m_depth[h] )
+    {
+        setBit( m_done, h );
+        m_cost[h] = c;
+        m_lowCut = outerCut;
+    }
+    else
+    {
+        m_lowCut = std::min( m_lowCut, outerCut );
+    }
+
+    return c;
+}
+
+bool instPlanner::outputNeedsOn( uint32_t h )
+{
+    return !m_puts[h]->enabled() || m_puts[m_choice[h]]->state() == putState::on;
+}
+
+bool instPlanner::inputNeedsOn( uint32_t h )
+{
+    instIOPut *put = m_puts[h];
+
+    // An input must be set on unless it is already waiting for a beam which is not yet on
+    return !put->enabled() || put->state() == putState::off || !m_hasBeam[h] ||
+           put->beam()->state() == beamState::on;
+}
+
+void instPlanner::emit( std::vector<planCommand> &cmds, uint32_t h )
+{
+    instIOPut *put = m_puts[h];
+
+    if( put->state() == putState::on || testBit( m_emitted, h ) )
+    {
+        return;
+    }
+
+    setBit( m_emitted, h );
+
+    if( !put->enabled() )
+    {
+        cmds.push_back( { planAction::enable, put } );
+    }
+
+    if( put->io() == ioDir::output )
+    {
+        if( put->outputLinked() )
+        {
+            bool needsOn = outputNeedsOn( h );
+
+            emit( cmds, m_choice[h] );
+
+            if( needsOn )
+            {
+                cmds.push_back( { planAction::on, put } );
+            }
+        }
+        else
+        {
+            cmds.push_back( { planAction::on, put } );
+        }
+    }
+    else
+    {
+        if( m_hasBeam[h] )
+        {
+            emit( cmds, m_beamSource[h] );
+        }
+
+        if( inputNeedsOn( h ) )
+        {
+            cmds.push_back( { planAction::on, put } );
+        }
+    }
+}
+
+} // namespace ingr
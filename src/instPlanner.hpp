@@ -0,0 +1,144 @@
+/** \file
+ *
+ * \brief Planning the put changes which achieve target beam and put states
+ */
+
+#ifndef instPlanner_hpp
+#define instPlanner_hpp
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "basicTypes.hpp"
+
+namespace ingr
+{
+
+class instGraph;
+class instIOPut;
+class instBeam;
+
+/// The actions a plan can take on a put
+/**
+ * \ingroup explainer
+ */
+enum class planAction : uint8_t
+{
+    enable, ///< Enable the put
+    on      ///< Set the put on
+};
+
+/// One step of a plan
+/**
+ * \ingroup explainer
+ */
+struct planCommand
+{
+    planAction action; ///< The action
+    instIOPut *put;    ///< The put acted on
+};
+
+/// Plans the put changes which get light to target beams and puts
+/** The graph's topology is compiled to arrays indexed by handle, and each plan is a backward search from
+ * the targets: a beam is on if its source is on and its dest is on or waiting, an input is on if it is set on
+ * and its beam is on, and an output-linked output is on if any of its linked inputs is on.  Each put costs
+ * one command to enable it if it is disabled and one to set it on if that is needed, and where an
+ * output-linked output can be lit through more than one input the cheapest is chosen.  Puts which are
+ * already on cost nothing, so a plan only ever enables puts and sets them on.
+ *
+ * Shared dependencies are counted once per use when choosing, so a plan is minimal for tree-shaped light
+ * paths but may not be where branches share puts.  A cycle back to a put on the search stack is cut, and a
+ * cost found through a cut is not memoized, since it depends on the path the search took to reach the put.
+ * Every plan is checked by running it in an instOverlay before it is returned.
+ *
+ * Call compile() again after changing the topology.
+ *
+ * \ingroup explainer
+ */
+class instPlanner
+{
+  protected:
+    instGraph *m_graph{ nullptr }; ///< The graph
+
+    std::vector<instIOPut *> m_puts;          ///< The puts, indexed by handle
+    std::vector<uint32_t> m_beamSource;       ///< For inputs, the handle of the source of the beam, or invalidHandle
+    std::vector<uint8_t> m_hasBeam;           ///< For inputs, whether there is a beam
+    std::vector<uint32_t> m_linkStart;        ///< For outputs, the start of the linked inputs in m_links
+    std::vector<uint32_t> m_links;            ///< The handles of the inputs linked to each output-linked output
+
+    std::vector<uint64_t> m_visiting;         ///< Bitset of the puts on the search stack
+    std::vector<uint64_t> m_done;             ///< Bitset of the puts with a cost
+    std::vector<uint64_t> m_emitted;          ///< Bitset of the puts added to the plan
+    std::vector<uint32_t> m_cost;             ///< The cost of turning each put on
+    std::vector<uint32_t> m_depth;            ///< The depth of each put on the search stack, while on it
+    uint32_t m_stackDepth{ 0 };               ///< The depth of the search stack
+    uint32_t m_lowCut{ 0 };                   ///< The shallowest depth a cycle was cut at in the current search
+    std::vector<uint32_t> m_choice;           ///< For output-linked outputs, the linked input chosen
+
+  public:
+    /// Construct for a graph, compiling its topology
+    explicit instPlanner( instGraph &graph /**< [in] the graph, which must outlive the planner */ );
+
+    /// Compile the topology of the graph
+    /** Assigns handles in the graph.
+     */
+    void compile();
+
+    /// Plan the changes which turn the targets on
+    /** A beam is turned on by turning its dest on.  A beam without a dest can not be on, so for such a beam
+     * the target is its source being on.
+     *
+     * \returns 0 on success, with the commands in the order they should be applied
+     * \returns -1 if the targets can not be reached, with the reason in \p emsg
+     */
+    int plan( std::string &emsg,                         /**< [out] the error message, if any */
+              std::vector<planCommand> &cmds,            /**< [out] the commands */
+              const std::vector<instBeam *> &beams,      /**< [in] the beams to turn on */
+              const std::vector<instIOPut *> &puts = {}  /**< [in] [optional] the puts to turn on */
+    );
+
+    /// Apply a plan to the graph
+    static void apply( const std::vector<planCommand> &cmds /**< [in] the commands */ );
+
+  protected:
+    /// Find the cost of turning a put on
+    uint32_t cost( uint32_t h /**< [in] the handle of the put */ );
+
+    /// Add the commands which turn a put on to the plan, dependencies first
+    void emit( std::vector<planCommand> &cmds, /**< [in.out] the commands */
+               uint32_t h                      /**< [in] the handle of the put */
+    );
+
+    /// Check if an output-linked output must be set on, rather than following its chosen input
+    /** An output only follows its linked inputs when one of them changes, so one which is disabled, or whose
+     * chosen input is already on, must be set on.
+     *
+     * \returns true if the output needs an on command
+     */
+    bool outputNeedsOn( uint32_t h /**< [in] the handle of the output, with m_choice set */ );
+
+    /// Check if an input must be set on, rather than waiting for its beam to turn it on
+    /** A waiting input only turns on by itself when its beam turns on, so one whose beam is already on must
+     * be set on.
+     *
+     * \returns true if the input needs an on command
+     */
+    bool inputNeedsOn( uint32_t h /**< [in] the handle of the input */ );
+
+    /// Get the handle of the put which is turned on for a beam target
+    /**
+     * \returns the handle of the dest, or of the source if there is no dest, or invalidHandle if there is neither
+     */
+    uint32_t beamTarget( instBeam *beam /**< [in] the beam */ );
+};
+
+/// Get the string representation of a plan command
+/**
+ * \returns a string such as "enable i:node:put" or "on o:node:put"
+ */
+std::string planCommand2String( const planCommand &cmd /**< [in] the command */ );
+
+} // namespace ingr
+
+#endif // instPlanner_hpp
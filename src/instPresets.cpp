@@ -0,0 +1,320 @@
+#include <stdexcept>
+
+#include "toml++/toml.h"
+
+#include "instPresets.hpp"
+#include "instGraph.hpp"
+
+namespace ingr
+{
+
+// Report a diagnostic at the source position of a TOML node
+template <typename formatT>
+static void reportPresetTOML( instDiagnostics *diag, severity sev, const toml::node &tn, formatT &&format )
+{
+    diag->report( sev,
+                  "instPresets",
+                  tn.source().begin.line,
+                  tn.source().begin.column,
+                  0,
+                  std::forward<formatT>( format ) );
+}
+
+instPresets::instPresets( instGraph &graph ) : m_graph{ &graph }, m_overlay{ graph }
+{
+}
+
+int instPresets::parseTOMLTable( toml::table &tbl )
+{
+    instDiagnostics *diag = m_graph->diagnostics();
+
+    toml::array *configPresets = tbl["presets"].as_array();
+
+    if( configPresets == nullptr )
+    {
+        diag->report( severity::error, "instPresets", 0, 0, 0, [] { return std::string( "no presets array" ); } );
+        return -1;
+    }
+
+    // Presets are only added once all are parsed, so nothing is added on error
+    std::map<std::string, std::vector<presetSetting>> presets;
+
+    for( auto &&tab : *configPresets )
+    {
+        toml::table *presetTbl = tab.as_table();
+
+        if( presetTbl == nullptr )
+        {
+            reportPresetTOML( diag, severity::error, tab, [] { return std::string( "preset is not a table" ); } );
+            return -1;
+        }
+
+        const std::string *name = nullptr;
+        toml::array *puts = nullptr;
+
+        for( auto &&[key, val] : *presetTbl )
+        {
+            if( key == "name" )
+            {
+                if( !val.is_string() )
+                {
+                    reportPresetTOML( diag,
+                                      severity::error,
+                                      val,
+                                      [] { return std::string( "preset name is not a string" ); } );
+                    return -1;
+                }
+
+                name = &val.as_string()->get();
+            }
+            else if( key == "puts" )
+            {
+                if( !val.is_array() )
+                {
+                    reportPresetTOML( diag,
+                                      severity::error,
+                                      val,
+                                      [] { return std::string( "preset puts is not an array" ); } );
+                    return -1;
+                }
+
+                puts = val.as_array();
+            }
+            else
+            {
+                reportPresetTOML( diag,
+                                  severity::warning,
+                                  val,
+                                  [&] { return "ignoring unknown preset key \"" + std::string( key.str() ) + "\""; } );
+            }
+        }
+
+        if( name == nullptr )
+        {
+            reportPresetTOML( diag,
+                              severity::warning,
+                              tab,
+                              [] { return std::string( "ignoring preset without name" ); } );
+            continue;
+        }
+
+        std::vector<presetSetting> &settings = presets[*name];
+        settings.clear();
+
+        if( puts )
+        {
+            for( auto &&put : *puts )
+            {
+                if( parseTOMLPut( settings, *name, put ) < 0 )
+                {
+                    return -1;
+                }
+            }
+        }
+    }
+
+    for( auto &&preset : presets )
+    {
+        m_presets[preset.first] = std::move( preset.second );
+    }
+
+    diag->report( severity::info, "instPresets", 0, 0, presets.size(), [] { return std::string( "presets loaded" ); } );
+
+    return 0;
+}
+
+int instPresets::parseTOMLPut( std::vector<presetSetting> &settings, const std::string &preset, toml::node &put )
+{
+    instDiagnostics *diag = m_graph->diagnostics();
+
+    toml::table *putTbl = put.as_table();
+
+    if( putTbl == nullptr )
+    {
+        reportPresetTOML( diag,
+                          severity::error,
+                          put,
+                          [&] { return "put of preset " + preset + " is not a table"; } );
+        return -1;
+    }
+
+    auto badValue = [&]( const toml::key &key, const toml::node &val )
+    {
+        reportPresetTOML( diag,
+                          severity::error,
+                          val,
+                          [&] { return "invalid " + std::string( key.str() ) + " in preset " + preset; } );
+        return -1;
+    };
+
+    presetSetting ps;
+    bool hasNode = false;
+    bool hasPut = false;
+
+    for( auto &&[key, val] : *putTbl )
+    {
+        if( key == "node" )
+        {
+            if( !val.is_string() )
+            {
+                return badValue( key, val );
+            }
+
+            ps.node = val.as_string()->get();
+            hasNode = true;
+        }
+        else if( key == "input" || key == "output" )
+        {
+            if( !val.is_string() || hasPut )
+            {
+                return badValue( key, val );
+            }
+
+            ps.io = ( key == "input" ) ? ioDir::input : ioDir::output;
+            ps.put = val.as_string()->get();
+            hasPut = true;
+        }
+        else if( key == "state" )
+        {
+            if( !val.is_string() || string2PutState( ps.state, val.as_string()->get() ) < 0 )
+            {
+                return badValue( key, val );
+            }
+
+            ps.setState = true;
+        }
+        else if( key == "enabled" )
+        {
+            if( !val.is_boolean() )
+            {
+                return badValue( key, val );
+            }
+
+            ps.enabled = val.as_boolean()->get();
+            ps.setEnabled = true;
+        }
+        else
+        {
+            reportPresetTOML( diag,
+                              severity::warning,
+                              val,
+                              [&] { return "ignoring unknown put key \"" + std::string( key.str() ) + "\""; } );
+        }
+    }
+
+    if( !hasNode || !hasPut )
+    {
+        reportPresetTOML( diag,
+                          severity::error,
+                          put,
+                          [&] { return "put of preset " + preset + " needs a node and an input or output"; } );
+        return -1;
+    }
+
+    bool valid = m_graph->nodeValid( ps.node );
+    if( valid )
+    {
+        instNode *nd = m_graph->node( ps.node );
+        valid = ( ps.io == ioDir::input ) ? nd->inputValid( ps.put ) : nd->outputValid( ps.put );
+    }
+
+    if( !valid )
+    {
+        reportPresetTOML( diag,
+                          severity::error,
+                          put,
+                          [&] { return "unknown " + ioDir2String( ps.io ) + " " + ps.node + ":" + ps.put; } );
+        return -1;
+    }
+
+    if( !ps.setState && !ps.setEnabled )
+    {
+        reportPresetTOML( diag,
+                          severity::warning,
+                          put,
+                          [&] { return "ignoring put " + ps.node + ":" + ps.put + " with no state or enabled"; } );
+        return 0;
+    }
+
+    settings.push_back( std::move( ps ) );
+
+    return 0;
+}
+
+int instPresets::loadTOMLFile( const std::string &fname )
+{
+    toml::table tbl;
+    try
+    {
+        tbl = toml::parse_file( fname );
+        return parseTOMLTable( tbl );
+    }
+    catch( const toml::parse_error &err )
+    {
+        m_graph->diagnostics()->report(
+            severity::error,
+            "instPresets",
+            err.source().begin.line,
+            err.source().begin.column,
+            0,
+            [&] { return "parsing " + fname + " failed: " + std::string( err.description() ); } );
+        return -1;
+    }
+}
+
+const std::map<std::string, std::vector<presetSetting>> &instPresets::presets() const
+{
+    return m_presets;
+}
+
+bool instPresets::presetValid( const std::string &name ) const
+{
+    return m_presets.count( name ) > 0;
+}
+
+void instPresets::stagePreset( const std::string &name )
+{
+    auto it = m_presets.find( name );
+
+    if( it == m_presets.end() )
+    {
+        throw std::invalid_argument( "instPresets::stagePreset: unknown preset " + name );
+    }
+
+    m_overlay.clear();
+
+    // Enabled flags first, so that a put enabled by the preset can be turned on by it
+    for( auto &&ps : it->second )
+    {
+        if( ps.setEnabled )
+        {
+            instNode *nd = m_graph->node( ps.node );
+            m_overlay.enabled( ps.io == ioDir::input ? nd->input( ps.put ) : nd->output( ps.put ), ps.enabled );
+        }
+    }
+
+    for( auto &&ps : it->second )
+    {
+        if( ps.setState )
+        {
+            m_overlay.state( ps.node, ps.put, ps.io, ps.state );
+        }
+    }
+}
+
+void instPresets::stage( overlayDiff &d, const std::string &name )
+{
+    stagePreset( name );
+
+    m_overlay.diff( d );
+    m_overlay.clear();
+}
+
+void instPresets::apply( overlayDiff &d, const std::string &name )
+{
+    stagePreset( name );
+
+    m_overlay.commit( d );
+}
+
+} // namespace ingr
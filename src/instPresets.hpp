@@ -0,0 +1,155 @@
+/** \file
+ *
+ * \brief Named sets of put states and enabled flags, applied to a graph in one change set
+ */
+
+#ifndef instPresets_hpp
+#define instPresets_hpp
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "basicTypes.hpp"
+#include "instOverlay.hpp"
+
+// forward decl
+namespace toml
+{
+namespace v3
+{
+class table;
+class node;
+} // namespace v3
+} // namespace toml
+
+namespace ingr
+{
+
+class instGraph;
+
+/// The setting of one put in a preset
+/**
+ * \ingroup explainer
+ */
+struct presetSetting
+{
+    std::string node;                ///< The name of the node
+    ioDir io{ ioDir::input };        ///< Whether the put is an input or output
+    std::string put;                 ///< The name of the put
+
+    bool setState{ false };          ///< Whether the preset sets the state
+    putState state{ putState::off }; ///< The state, if set
+
+    bool setEnabled{ false };        ///< Whether the preset sets the enabled flag
+    bool enabled{ true };            ///< The enabled flag, if set
+};
+
+/// Named presets of put states and enabled flags, such as observing modes, applied atomically
+/** Presets are loaded from TOML as an array of tables named `presets`.  Each preset has a `name` and an
+ * array of tables named `puts`.  Each put has a `node`, either an `input` or an `output` naming the put,
+ * and at least one of:
+ * - `state`: one of "off", "waiting", or "on"
+ * - `enabled`: true or false
+ *
+ * For example:
+ * \code
+ * [[presets]]
+ *     name="telescope"
+ *     [[presets.puts]]
+ *         node="source"
+ *         output="out"
+ *         state="off"
+ *     [[presets.puts]]
+ *         node="telescope"
+ *         output="out"
+ *         state="on"
+ * \endcode
+ *
+ * The nodes and puts are checked against the graph when loaded.  Errors and warnings are reported with their
+ * source positions to the graph's diagnostics().
+ *
+ * A preset is applied by staging all of its settings in an instOverlay, the enabled flags first and then the
+ * states in the order given, so one propagation pass covers the union of their downstream cones without
+ * changing the graph.  The net change set is then committed to the graph with instOverlay::commit, so each
+ * put and beam changes at most once and the graph is notified once.
+ *
+ * \ingroup explainer
+ */
+class instPresets
+{
+  protected:
+    instGraph *m_graph{ nullptr }; ///< The graph
+
+    std::map<std::string, std::vector<presetSetting>> m_presets; ///< The settings of each preset, by name
+
+    instOverlay m_overlay; ///< The overlay the settings are staged in
+
+  public:
+    /// Construct for a graph
+    explicit instPresets( instGraph &graph /**< [in] the graph, which must outlive the presets */ );
+
+    /// Add the presets specified in a parsed TOML table
+    /** Nothing is added if there is an error.  A preset with the name of one already loaded replaces it.
+     *
+     * \returns 0 on success
+     * \returns -1 on error
+     */
+    int parseTOMLTable( toml::v3::table &tbl /**< [in] the parsed table */ );
+
+    /// Load a TOML file and add its presets
+    /**
+     * \returns 0 on success
+     * \returns -1 on error
+     */
+    int loadTOMLFile( const std::string &fname /**< [in] the path of the file */ );
+
+    /// Get the presets
+    /**
+     * \returns a reference to m_presets
+     */
+    const std::map<std::string, std::vector<presetSetting>> &presets() const;
+
+    /// Check if a preset exists
+    /**
+     * \returns true if a preset named \p name is loaded
+     */
+    bool presetValid( const std::string &name /**< [in] the name of the preset */ ) const;
+
+    /// Get the change set a preset would make, without applying it
+    /**
+     * \throws std::invalid_argument if the preset does not exist
+     */
+    void stage( overlayDiff &d,           /**< [out] the change set, in the order made */
+                const std::string &name   /**< [in] the name of the preset */
+    );
+
+    /// Apply a preset to the graph as one change set with a single notification
+    /**
+     * \throws std::invalid_argument if the preset does not exist
+     */
+    void apply( overlayDiff &d,           /**< [out] the change set, in the order made */
+                const std::string &name   /**< [in] the name of the preset */
+    );
+
+  protected:
+    /// Parse one put table of a preset
+    /**
+     * \returns 0 on success
+     * \returns -1 on error
+     */
+    int parseTOMLPut( std::vector<presetSetting> &settings, /**< [in/out] the settings to add the put to */
+                      const std::string &preset,             /**< [in] the name of the preset */
+                      toml::v3::node &put                    /**< [in] the put table */
+    );
+
+    /// Stage the settings of a preset in the overlay
+    /**
+     * \throws std::invalid_argument if the preset does not exist
+     */
+    void stagePreset( const std::string &name /**< [in] the name of the preset */ );
+};
+
+} // namespace ingr
+
+#endif // instPresets_hpp
@@ -0,0 +1,323 @@
+#include <algorithm>
+
+#include "instReachability.hpp"
+#include "instGraph.hpp"
+
+namespace ingr
+{
+
+instReachability::instReachability()
+{
+}
+
+instReachability::~instReachability()
+{
+    clear();
+}
+
+void instReachability::clear()
+{
+    if( m_graph && m_graph->reachability() == this )
+    {
+        m_graph->reachability( nullptr );
+    }
+
+    m_graph = nullptr;
+
+    m_nPuts = 0;
+    m_words = 0;
+    m_puts.clear();
+    m_succStart.clear();
+    m_succ.clear();
+    m_predStart.clear();
+    m_pred.clear();
+    m_comp.clear();
+    m_compStart.clear();
+    m_order.clear();
+    m_rows.clear();
+    m_rows.shrink_to_fit();
+    m_affected.clear();
+    m_updatedRows = 0;
+}
+
+void instReachability::build( instGraph &graph )
+{
+    clear();
+
+    size_t nHandles = graph.assignHandles();
+
+    while( m_nPuts < nHandles && graph.handlePut( m_nPuts ) != nullptr )
+    {
+        ++m_nPuts;
+    }
+
+    m_words = ( m_nPuts + 63 ) / 64;
+
+    m_puts.resize( m_nPuts );
+    for( uint32_t h = 0; h < m_nPuts; ++h )
+    {
+        m_puts[h] = graph.handlePut( h );
+    }
+
+    // Edges from outputs to the dests of their beams, and from inputs to their linked outputs
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+
+    for( uint32_t h = 0; h < m_nPuts; ++h )
+    {
+        instIOPut *put = m_puts[h];
+
+        if( put->io() == ioDir::output )
+        {
+            if( put->beamValid() && put->beam()->destValid() )
+            {
+                edges.push_back( { h, put->beam()->dest()->handle() } );
+            }
+        }
+        else if( put->nodeValid() )
+        {
+            for( auto &&ol : put->outputLinks() )
+            {
+                if( put->node()->outputValid( ol ) )
+                {
+                    edges.push_back( { h, put->node()->output( ol )->handle() } );
+                }
+            }
+        }
+    }
+
+    m_succStart.assign( m_nPuts + 1, 0 );
+    m_predStart.assign( m_nPuts + 1, 0 );
+
+    for( auto &&e : edges )
+    {
+        ++m_succStart[e.first + 1];
+        ++m_predStart[e.second + 1];
+    }
+
+    for( uint32_t h = 0; h < m_nPuts; ++h )
+    {
+        m_succStart[h + 1] += m_succStart[h];
+        m_predStart[h + 1] += m_predStart[h];
+    }
+
+    m_succ.resize( edges.size() );
+    m_pred.resize( edges.size() );
+
+    std::vector<uint32_t> sfill( m_succStart.begin(), m_succStart.end() - 1 );
+    std::vector<uint32_t> pfill( m_predStart.begin(), m_predStart.end() - 1 );
+
+    for( auto &&e : edges )
+    {
+        m_succ[sfill[e.first]++] = e.second;
+        m_pred[pfill[e.second]++] = e.first;
+    }
+
+    components();
+
+    m_rows.assign( m_nPuts * m_words, 0 );
+    m_row.assign( m_words, 0 );
+
+    for( uint32_t c = 0; c + 1 < m_compStart.size(); ++c )
+    {
+        computeComponent( c );
+    }
+
+    m_updatedRows = m_nPuts;
+
+    m_graph = &graph;
+    graph.reachability( this );
+}
+
+void instReachability::components()
+{
+    // Tarjan's algorithm, which completes components sinks first
+    const uint32_t unvisited = invalidHandle;
+
+    std::vector<uint32_t> index( m_nPuts, unvisited );
+    std::vector<uint32_t> low( m_nPuts, 0 );
+    std::vector<uint8_t> onStack( m_nPuts, 0 );
+    std::vector<uint32_t> stack;
+    std::vector<std::pair<uint32_t, uint32_t>> calls; // the put and its next successor
+
+    m_comp.assign( m_nPuts, 0 );
+    m_compStart.clear();
+    m_order.clear();
+
+    uint32_t next = 0;
+
+    for( uint32_t r = 0; r < m_nPuts; ++r )
+    {
+        if( index[r] != unvisited )
+        {
+            continue;
+        }
+
+        index[r] = low[r] = next++;
+        stack.push_back( r );
+        onStack[r] = 1;
+        calls.push_back( { r, m_succStart[r] } );
+
+        while( !calls.empty() )
+        {
+            uint32_t v = calls.back().first;
+
+            if( calls.back().second < m_succStart[v + 1] )
+            {
+                uint32_t w = m_succ[calls.back().second++];
+
+                if( index[w] == unvisited )
+                {
+                    index[w] = low[w] = next++;
+                    stack.push_back( w );
+                    onStack[w] = 1;
+                    calls.push_back( { w, m_succStart[w] } );
+                }
+                else if( onStack[w] )
+                {
+                    low[v] = std::min( low[v], index[w] );
+                }
+
+                continue;
+            }
+
+            calls.pop_back();
+
+            if( !calls.empty() )
+            {
+                uint32_t u = calls.back().first;
+                low[u] = std::min( low[u], low[v] );
+            }
+
+            if( low[v] == index[v] )
+            {
+                m_compStart.push_back( m_order.size() );
+
+                uint32_t x;
+                do
+                {
+                    x = stack.back();
+                    stack.pop_back();
+                    onStack[x] = 0;
+                    m_comp[x] = m_compStart.size() - 1;
+                    m_order.push_back( x );
+                } while( x != v );
+            }
+        }
+    }
+
+    m_compStart.push_back( m_order.size() );
+}
+
+void instReachability::computeComponent( uint32_t c )
+{
+    // The rows of a cycle grow from empty, so bits from before a put was disabled are dropped
+    if( m_compStart[c + 1] - m_compStart[c] > 1 )
+    {
+        for( uint32_t n = m_compStart[c]; n < m_compStart[c + 1]; ++n )
+        {
+            std::fill_n( &m_rows[m_order[n] * m_words], m_words, 0 );
+        }
+    }
+
+    bool changed = true;
+
+    // A single put is done in one pass, a cycle is iterated until its rows stop growing
+    while( changed )
+    {
+        changed = false;
+
+        for( uint32_t n = m_compStart[c]; n < m_compStart[c + 1]; ++n )
+        {
+            uint32_t v = m_order[n];
+
+            std::fill( m_row.begin(), m_row.end(), 0 );
+
+            // Disabled puts have empty rows, so they block the light
+            if( m_puts[v]->enabled() )
+            {
+                m_row[v / 64] |= uint64_t( 1 ) << ( v % 64 );
+
+                for( uint32_t s = m_succStart[v]; s < m_succStart[v + 1]; ++s )
+                {
+                    const uint64_t *srow = &m_rows[m_succ[s] * m_words];
+
+                    for( size_t w = 0; w < m_words; ++w )
+                    {
+                        m_row[w] |= srow[w];
+                    }
+                }
+            }
+
+            uint64_t *row = &m_rows[v * m_words];
+
+            if( !std::equal( m_row.begin(), m_row.end(), row ) )
+            {
+                std::copy( m_row.begin(), m_row.end(), row );
+                changed = ( m_compStart[c + 1] - m_compStart[c] > 1 );
+            }
+        }
+    }
+}
+
+bool instReachability::reaches( const instIOPut *a, const instIOPut *b ) const
+{
+    return reaches( a->handle(), b->handle() );
+}
+
+void instReachability::enabledChange( uint32_t h )
+{
+    if( h >= m_nPuts )
+    {
+        return;
+    }
+
+    // The rows which change are those of the put and of the puts which reach it through enabled puts
+    m_affected.assign( m_compStart.size() - 1, 0 );
+    m_affected[m_comp[h]] = 1;
+
+    std::vector<uint8_t> seen( m_nPuts, 0 );
+    seen[h] = 1;
+
+    m_queue.clear();
+    m_queue.push_back( h );
+
+    for( size_t q = 0; q < m_queue.size(); ++q )
+    {
+        uint32_t v = m_queue[q];
+
+        for( uint32_t p = m_predStart[v]; p < m_predStart[v + 1]; ++p )
+        {
+            uint32_t u = m_pred[p];
+
+            if( !seen[u] && m_puts[u]->enabled() )
+            {
+                seen[u] = 1;
+                m_affected[m_comp[u]] = 1;
+                m_queue.push_back( u );
+            }
+        }
+    }
+
+    m_updatedRows = 0;
+
+    for( uint32_t c = 0; c < m_affected.size(); ++c )
+    {
+        if( m_affected[c] )
+        {
+            computeComponent( c );
+            m_updatedRows += m_compStart[c + 1] - m_compStart[c];
+        }
+    }
+}
+
+size_t instReachability::memoryBytes() const
+{
+    return m_rows.size() * sizeof( uint64_t );
+}
+
+size_t instReachability::updatedRows() const
+{
+    return m_updatedRows;
+}
+
+} // namespace ingr
@@ -0,0 +1,118 @@
+/** \file
+ *
+ * \brief Reachability between puts, as bitsets maintained under enabled changes
+ */
+
+#ifndef instReachability_hpp
+#define instReachability_hpp
+
+#include <cstdint>
+#include <vector>
+
+#include "basicTypes.hpp"
+
+namespace ingr
+{
+
+class instGraph;
+class instIOPut;
+
+/// The transitive closure of the put graph, as one bitset per put
+/** Puts are connected by beams, from an output to the dest of its beam, and by output links, from an input
+ * to its linked outputs.  The row of put A has the bit of put B set if light from A can reach B through
+ * enabled puts, so a query is a single bit test.  A disabled put reaches nothing and is reached by nothing.
+ *
+ * Rows are computed from the strongly connected components of the put graph, sinks first, so each row is
+ * the union of the rows of its successors.  When a put is enabled or disabled, the graph calls
+ * enabledChange(), which recomputes only the rows of the puts which reach it through enabled puts.
+ *
+ * Memory is one bit per pair of puts.  Call build() again after changing the topology.
+ *
+ * \ingroup explainer
+ */
+class instReachability
+{
+  protected:
+    instGraph *m_graph{ nullptr }; ///< The graph, while registered
+
+    uint32_t m_nPuts{ 0 };         ///< The number of puts
+    size_t m_words{ 0 };           ///< The number of 64 bit words in a row
+
+    std::vector<instIOPut *> m_puts;  ///< The puts, indexed by handle
+
+    std::vector<uint32_t> m_succStart, m_succ; ///< Successors of each put, compressed
+    std::vector<uint32_t> m_predStart, m_pred; ///< Predecessors of each put, compressed
+
+    std::vector<uint32_t> m_comp;      ///< The component of each put, numbered sinks first
+    std::vector<uint32_t> m_compStart; ///< The start of each component's puts in m_order
+    std::vector<uint32_t> m_order;     ///< The puts, grouped by component
+
+    std::vector<uint64_t> m_rows;      ///< The rows, m_words per put
+
+    std::vector<uint8_t> m_affected;   ///< The components to recompute in an update
+    std::vector<uint32_t> m_queue;     ///< The queue of the search for affected puts
+    std::vector<uint64_t> m_row;       ///< Working space for a row
+
+    size_t m_updatedRows{ 0 };         ///< The number of rows recomputed by the last update
+
+  public:
+    /// Default c'tor
+    instReachability();
+
+    /// D'tor, unregisters from the graph
+    ~instReachability();
+
+    /// Build the closure and register with the graph
+    /** Assigns handles in the graph.
+     */
+    void build( instGraph &graph /**< [in] the graph */ );
+
+    /// Clear the closure and unregister from the graph
+    void clear();
+
+    /// Check if light from one put can reach another
+    /** Both handles must be puts of the graph as built.
+     *
+     * \returns true if \p b is reachable from \p a through enabled puts
+     */
+    bool reaches( uint32_t a, /**< [in] the handle of the put the light starts at */
+                  uint32_t b  /**< [in] the handle of the put the light ends at */
+    ) const
+    {
+        return ( m_rows[a * m_words + b / 64] >> ( b % 64 ) ) & 1;
+    }
+
+    /// Check if light from one put can reach another
+    /**
+     * \returns true if \p b is reachable from \p a through enabled puts
+     */
+    bool reaches( const instIOPut *a, /**< [in] the put the light starts at */
+                  const instIOPut *b  /**< [in] the put the light ends at */
+    ) const;
+
+    /// Update the rows after a put was enabled or disabled.  Called by the graph.
+    void enabledChange( uint32_t h /**< [in] the handle of the put */ );
+
+    /// Get the memory used by the rows
+    /**
+     * \returns the size of the rows in bytes
+     */
+    size_t memoryBytes() const;
+
+    /// Get the number of rows recomputed by the last update
+    /**
+     * \returns the current value of m_updatedRows
+     */
+    size_t updatedRows() const;
+
+  protected:
+    /// Find the strongly connected components, numbered sinks first
+    void components();
+
+    /// Recompute the rows of the puts of a component
+    void computeComponent( uint32_t c /**< [in] the component */ );
+};
+
+} // namespace ingr
+
+#endif // instReachability_hpp
@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "instTrace.hpp"
+#include "instGraph.hpp"
+
+namespace ingr
+{
+
+thread_local traceBuffer *t_traceBuffer{ nullptr };
+
+// All thread buffers ever created.  They are kept after their thread exits so the events can be exported.
+std::mutex g_traceMutex;
+std::vector<std::unique_ptr<traceBuffer>> g_traceBuffers;
+std::atomic<size_t> g_traceCapacity{ 65536 };
+
+std::string tracePoint2String( tracePoint pt )
+{
+    switch( pt )
+    {
+    case tracePoint::putState:
+        return "instIOPut::state";
+    case tracePoint::beamStateChange:
+        return "instBeam::stateChange";
+    case tracePoint::checkOutputLinks:
+        return "instNode::checkOutputLinks";
+    case tracePoint::graphStateChange:
+        return "instGraph::stateChange";
+    case tracePoint::xmlSave:
+        return "instGraphXML::save";
+    case tracePoint::xmlPublish:
+        return "instGraphXMLSink::publish";
+    }
+
+    return "unknown";
+}
+
+traceBuffer *traceThreadBuffer()
+{
+    size_t cap = 1;
+    while( cap < g_traceCapacity.load( std::memory_order_relaxed ) )
+    {
+        cap <<= 1;
+    }
+
+    std::unique_ptr<traceBuffer> tb( new traceBuffer );
+    tb->events.resize( cap );
+
+    std::lock_guard<std::mutex> lock( g_traceMutex );
+
+    tb->thread = g_traceBuffers.size();
+    t_traceBuffer = tb.get();
+    g_traceBuffers.push_back( std::move( tb ) );
+
+    return t_traceBuffer;
+}
+
+void traceCapacity( size_t cap )
+{
+    g_traceCapacity.store( std::max<size_t>( cap, 1 ), std::memory_order_relaxed );
+}
+
+void traceClear()
+{
+    std::lock_guard<std::mutex> lock( g_traceMutex );
+
+    for( auto &tb : g_traceBuffers )
+    {
+        tb->head = 0;
+    }
+}
+
+std::vector<std::pair<size_t, traceEvent>> traceEvents()
+{
+    std::vector<std::pair<size_t, traceEvent>> evs;
+
+    {
+        std::lock_guard<std::mutex> lock( g_traceMutex );
+
+        for( auto &tb : g_traceBuffers )
+        {
+            uint64_t n = std::min<uint64_t>( tb->head, tb->events.size() );
+
+            for( uint64_t e = tb->head - n; e < tb->head; ++e )
+            {
+                evs.push_back( { tb->thread, tb->events[e & ( tb->events.size() - 1 )] } );
+            }
+        }
+    }
+
+    std::stable_sort( evs.begin(),
+                      evs.end(),
+                      []( const std::pair<size_t, traceEvent> &a, const std::pair<size_t, traceEvent> &b )
+                      { return a.second.time < b.second.time; } );
+
+    return evs;
+}
+
+// Append s to json as a quoted and escaped string
+void jsonString( std::string &json, const std::string &s )
+{
+    json += '"';
+
+    for( char c : s )
+    {
+        if( c == '"' || c == '\\' )
+        {
+            json += '\\';
+            json += c;
+        }
+        else if( static_cast<unsigned char>( c ) < 0x20 )
+        {
+            char esc[8];
+            snprintf( esc, sizeof( esc ), "\\u%04x", c );
+            json += esc;
+        }
+        else
+        {
+            json += c;
+        }
+    }
+
+    json += '"';
+}
+
+// The string representation of a state recorded at a trace point
+std::string traceState( tracePoint pt, int st )
+{
+    if( pt == tracePoint::beamStateChange )
+    {
+        return beamState2String( static_cast<beamState>( st ) );
+    }
+
+    return putState2String( static_cast<putState>( st ) );
+}
+
+std::string traceChromeJSON( instGraph *graph )
+{
+    std::unordered_map<const void *, std::string> names;
+
+    if( graph )
+    {
+        names[graph] = "graph";
+
+        for( auto &node : graph->nodes() )
+        {
+            names[node.second] = "node:" + node.first;
+
+            for( auto &ip : node.second->inputs() )
+            {
+                names[ip.second] = "i:" + node.first + ":" + ip.second->name();
+            }
+
+            for( auto &op : node.second->outputs() )
+            {
+                names[op.second] = "o:" + node.first + ":" + op.second->name();
+            }
+        }
+
+        for( auto &beam : graph->beams() )
+        {
+            names[beam.second] = "beam:" + beam.first;
+        }
+    }
+
+    auto name = [&names]( const void *entity )
+    {
+        auto it = names.find( entity );
+        if( it != names.end() )
+        {
+            return it->second;
+        }
+
+        char addr[32];
+        snprintf( addr, sizeof( addr ), "%p", entity );
+        return std::string( addr );
+    };
+
+    std::vector<std::pair<size_t, traceEvent>> evs = traceEvents();
+
+    uint64_t t0 = evs.empty() ? 0 : evs.front().second.time;
+
+    std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+    bool first = true;
+
+    auto event = [&]( const char *ph, const std::string &evName, size_t tid, uint64_t time, const std::string &args )
+    {
+        if( !first )
+        {
+            json += ",\n";
+        }
+        first = false;
+
+        char ts[32];
+        snprintf( ts, sizeof( ts ), "%.3f", ( time - t0 ) / 1000.0 );
+
+        json += "{\"name\":";
+        jsonString( json, evName );
+        json += ",\"cat\":\"ingr\",\"ph\":\"";
+        json += ph;
+        json += "\",\"ts\":";
+        json += ts;
+        json += ",\"pid\":1,\"tid\":" + std::to_string( tid );
+        if( ph[0] == 'i' )
+        {
+            json += ",\"s\":\"t\"";
+        }
+        json += ",\"args\":{" + args + "}}";
+    };
+
+    for( auto &tev : evs )
+    {
+        const traceEvent &ev = tev.second;
+
+        std::string args = "\"entity\":";
+        jsonString( args, name( ev.entity ) );
+
+        if( ev.phase == tracePhase::begin )
+        {
+            if( ev.from >= 0 )
+            {
+                args += ",\"from\":";
+                jsonString( args, traceState( ev.point, ev.from ) );
+            }
+
+            event( "B", tracePoint2String( ev.point ), tev.first, ev.time, args );
+        }
+        else
+        {
+            if( ev.to >= 0 )
+            {
+                args += ",\"to\":";
+                jsonString( args, traceState( ev.point, ev.to ) );
+            }
+
+            event( "E", tracePoint2String( ev.point ), tev.first, ev.time, args );
+
+            if( ev.from != ev.to )
+            {
+                std::string targs = "\"entity\":";
+                jsonString( targs, name( ev.entity ) );
+                targs += ",\"from\":";
+                jsonString( targs, traceState( ev.point, ev.from ) );
+                targs += ",\"to\":";
+                jsonString( targs, traceState( ev.point, ev.to ) );
+
+                event( "i", "transition", tev.first, ev.time, targs );
+            }
+        }
+    }
+
+    json += "]}\n";
+
+    return json;
+}
+
+int traceWriteChrome( const std::string &path, instGraph *graph )
+{
+    std::ofstream fout( path );
+
+    if( !fout )
+    {
+        return -1;
+    }
+
+    std::string json = traceChromeJSON( graph );
+    fout.write( json.data(), json.size() );
+
+    return fout.good() ? 0 : -1;
+}
+
+} // namespace ingr
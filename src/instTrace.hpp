@@ -0,0 +1,189 @@
+/** \file
+ *
+ * \brief Trace points on the propagation path
+ *
+ * Trace points are compiled in only if the library is built with the CMake option INGR_TRACE=ON, which
+ * defines INGR_TRACE.  Otherwise the INGR_TRACE_* macros expand to nothing.  The export functions are
+ * always available, and return an empty trace if tracing is not compiled in.
+ */
+
+#ifndef instTrace_hpp
+#define instTrace_hpp
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace ingr
+{
+
+class instGraph;
+
+/// The instrumented locations
+/** \ingroup explainer
+ */
+enum class tracePoint : uint8_t
+{
+    putState,         ///< instIOPut::state
+    beamStateChange,  ///< instBeam::stateChange
+    checkOutputLinks, ///< instNode::checkOutputLinks
+    graphStateChange, ///< instGraph::stateChange and its overrides
+    xmlSave,          ///< instGraphXML::save
+    xmlPublish        ///< instGraphXMLSink::publish, over the sinks of instGraphXML::save
+};
+
+/// Get a string representation of a trace point
+/**
+ * \returns the name of the instrumented function
+ */
+std::string tracePoint2String( tracePoint pt /**< [in] the trace point */ );
+
+/// The phase of a trace event
+enum class tracePhase : uint8_t
+{
+    begin, ///< Entry to the trace point
+    end    ///< Exit from the trace point
+};
+
+/// A single trace event
+/**
+ * \ingroup explainer
+ */
+struct traceEvent
+{
+    uint64_t time;      ///< Nanoseconds since the steady_clock epoch
+    const void *entity; ///< The put, beam, node, or graph
+    tracePoint point;   ///< Where the event was recorded
+    tracePhase phase;   ///< Whether this is entry or exit
+    int8_t from;        ///< The entity's state on entry, -1 if it has none
+    int8_t to;          ///< The entity's state when the event was recorded, -1 if it has none
+};
+
+/// The events recorded by one thread
+/** Written only by its own thread, as a ring buffer which overwrites the oldest events.
+ */
+struct traceBuffer
+{
+    std::vector<traceEvent> events; ///< The ring, with a power of 2 size
+
+    uint64_t head{ 0 };             ///< The number of events recorded
+
+    size_t thread{ 0 };             ///< The index of the thread, in order of first event
+};
+
+/// Get the buffer for the calling thread, creating and registering it on first use
+traceBuffer *traceThreadBuffer();
+
+/// The calling thread's buffer, or nullptr before its first event
+extern thread_local traceBuffer *t_traceBuffer;
+
+/// Record an event
+inline void traceRecord( tracePoint pt, tracePhase ph, const void *entity, int from, int to )
+{
+    traceBuffer *tb = t_traceBuffer;
+    if( tb == nullptr )
+    {
+        tb = traceThreadBuffer();
+    }
+
+    traceEvent &ev = tb->events[tb->head & ( tb->events.size() - 1 )];
+
+    ev.time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now().time_since_epoch() )
+                  .count();
+    ev.entity = entity;
+    ev.point = pt;
+    ev.phase = ph;
+    ev.from = from;
+    ev.to = to;
+
+    ++tb->head;
+}
+
+/// Records a begin event on construction and an end event on destruction
+/** If given a pointer to the entity's state, the state on entry and exit are recorded.
+ */
+template <typename stateT = int>
+class traceScope
+{
+  protected:
+    tracePoint m_point;
+    const void *m_entity;
+    const stateT *m_state;
+    int m_from;
+
+  public:
+    traceScope( tracePoint pt, const void *entity, const stateT *state = nullptr )
+        : m_point{ pt }, m_entity{ entity }, m_state{ state }, m_from{ state ? static_cast<int>( *state ) : -1 }
+    {
+        traceRecord( m_point, tracePhase::begin, m_entity, m_from, m_from );
+    }
+
+    ~traceScope()
+    {
+        traceRecord( m_point, tracePhase::end, m_entity, m_from, m_state ? static_cast<int>( *m_state ) : -1 );
+    }
+};
+
+/// Set the number of events in each thread's ring buffer
+/** Applies to buffers created after the call.  Rounded up to a power of 2.  The default is 65536.
+ */
+void traceCapacity( size_t cap /**< [in] the number of events */ );
+
+/// Discard all recorded events
+/** Must not be called while other threads are recording.
+ */
+void traceClear();
+
+/// Get a copy of all retained events, from all threads, sorted by time
+/** Should be called while no thread is recording.
+ *
+ * \returns the events, with the thread index of each
+ */
+std::vector<std::pair<size_t, traceEvent>> traceEvents();
+
+/// Format all retained events as Chrome trace event JSON
+/** The result can be loaded in chrome://tracing or Perfetto.  Entities are named by looking them up in
+ * \p graph: puts as "i:node:name" or "o:node:name", beams as "beam:name", and nodes as "node:name".
+ * Entities not found are named by address.  Should be called while no thread is recording.
+ *
+ * \returns the JSON document
+ */
+std::string traceChromeJSON( instGraph *graph /**< [in] [optional] the graph used to name entities */ );
+
+/// Write all retained events as Chrome trace event JSON to a file
+/**
+ * \returns 0 on success
+ * \returns -1 on error
+ */
+int traceWriteChrome( const std::string &path, /**< [in] the file to write */
+                      instGraph *graph         /**< [in] [optional] the graph used to name entities */
+);
+
+} // namespace ingr
+
+#ifdef INGR_TRACE
+
+#define INGR_TRACE_CONCAT_( a, b ) a##b
+#define INGR_TRACE_CONCAT( a, b ) INGR_TRACE_CONCAT_( a, b )
+
+/// Trace the enclosing scope
+#define INGR_TRACE_SCOPE( point, entity )                                                                            \
+    ::ingr::traceScope<> INGR_TRACE_CONCAT( ingrTraceScope, __LINE__ )( ::ingr::tracePoint::point, entity )
+
+/// Trace the enclosing scope, recording the state of the entity on entry and exit
+#define INGR_TRACE_STATE_SCOPE( point, entity, state )                                                               \
+    ::ingr::traceScope<std::remove_cvref_t<decltype( state )>> INGR_TRACE_CONCAT( ingrTraceScope, __LINE__ )(         \
+        ::ingr::tracePoint::point, entity, &( state ) )
+
+#else
+
+#define INGR_TRACE_SCOPE( point, entity )
+
+#define INGR_TRACE_STATE_SCOPE( point, entity, state )
+
+#endif // INGR_TRACE
+
+#endif // instTrace_hpp